@@ -0,0 +1,149 @@
+/**
+* This file is part of Menderer.
+*
+* Copyright 2019 Robert Maier, Technical University of Munich.
+* For more information see <https://github.com/robmaier/menderer>.
+*
+* Menderer is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* Menderer is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with Menderer. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <vector>
+#include <menderer/mat.h>
+#include <menderer/mesh.h>
+
+
+namespace menderer
+{
+namespace cpu
+{
+
+    /**
+     * @brief   Bounding volume hierarchy (binned SAH) over the triangles of a mesh,
+     *          with SIMD traversal of ray packets.
+     * @author  Robert Maier
+     */
+    class BVH
+    {
+    public:
+
+        /// Number of rays per packet.
+        static const int PacketSize = 8;
+
+        typedef Eigen::Array<float, PacketSize, 1> PacketF;
+        typedef Eigen::Array<int, PacketSize, 1> PacketI;
+
+        /**
+         * @brief   Packet of coherent rays with a common origin
+         *          (e.g. primary rays of a pinhole camera).
+         * @author  Robert Maier
+         */
+        struct RayPacket
+        {
+        public:
+
+            Vec3f origin;
+            PacketF dir_x;
+            PacketF dir_y;
+            PacketF dir_z;
+            PacketF t_min;
+            PacketF t_max;      // t_max < t_min: inactive ray
+        };
+
+        /**
+         * @brief   Closest hits of a ray packet.
+         * @author  Robert Maier
+         */
+        struct HitPacket
+        {
+        public:
+
+            PacketF t;
+            PacketF u;          // barycentric coordinate of the second triangle vertex
+            PacketF v;          // barycentric coordinate of the third triangle vertex
+            PacketI face;       // -1: no hit
+        };
+
+        /// Constructor for creating an empty BVH.
+        BVH();
+
+        /// Destructor.
+        ~BVH();
+
+        /**
+         * @brief   Build the BVH over the triangles of a mesh (in parallel).
+         * @param   mesh            Input mesh arrays.
+         * @param   max_leaf_size   Maximum number of triangles per leaf.
+         */
+        void build(const MeshView &mesh, size_t max_leaf_size = 4);
+
+        /// Clear the BVH.
+        void clear();
+
+        /// Checks if the BVH is empty.
+        bool empty() const;
+
+        /// Returns the number of nodes.
+        size_t numNodes() const;
+
+        /**
+         * @brief   Find the closest hits of a packet of rays.
+         * @param   rays            Ray packet.
+         * @param   hits            Closest hits within [t_min, t_max] of each ray.
+         * @param   cull_backfaces  Ignore triangles facing away from the rays
+         *                          (counter-clockwise front faces).
+         */
+        void intersect(const RayPacket &rays, HitPacket &hits, bool cull_backfaces = false) const;
+
+    private:
+        /// BVH node (inner node: children at offset and offset + 1, leaf: triangles at offset).
+        struct Node
+        {
+            Vec3f bbox_min;
+            unsigned int offset;
+            Vec3f bbox_max;
+            unsigned short count;   // number of triangles (0: inner node)
+            unsigned short axis;    // split axis of inner node
+        };
+
+        /// Precomputed triangle for ray intersection.
+        struct Triangle
+        {
+            Vec3f v0;
+            Vec3f e1;
+            Vec3f e2;
+            unsigned int face;
+        };
+
+        struct BuildData;
+
+        /**
+         * @brief   Compute the bounds of a node and split it with the binned SAH
+         *          (or at the median below a maximum depth, which bounds the tree depth).
+         * @return  False if the node becomes a leaf, true if its triangles were
+         *          partitioned into [begin, mid) and [mid, end).
+         */
+        bool splitNode(BuildData &data, size_t begin, size_t end, size_t depth, Node &node, size_t &mid) const;
+
+        /// Build the subtree of a node into a node array (children are appended).
+        void buildSubtree(BuildData &data, std::vector<Node> &nodes, size_t begin, size_t end, size_t depth) const;
+
+        size_t max_leaf_size_;
+        std::vector<Node> nodes_;
+        std::vector<Triangle> triangles_;
+    };
+
+} // namespace cpu
+} // namespace menderer
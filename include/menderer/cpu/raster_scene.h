@@ -0,0 +1,130 @@
+/**
+* This file is part of Menderer.
+*
+* Copyright 2019 Robert Maier, Technical University of Munich.
+* For more information see <https://github.com/robmaier/menderer>.
+*
+* Menderer is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* Menderer is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with Menderer. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <vector>
+#include <menderer/mat.h>
+
+#include <opencv2/core/core.hpp>
+
+#include <menderer/camera.h>
+#include <menderer/mesh.h>
+#include <menderer/renderer.h>
+#include <menderer/cpu/shading.h>
+#include <menderer/ogl/mesh_renderer.h>
+
+
+namespace menderer
+{
+namespace cpu
+{
+
+    /**
+     * @brief   Scene for rendering on the CPU with a tile-based software rasterizer,
+     *          without an OpenGL context. Triangles are set up and binned into
+     *          screen tiles in parallel, the tiles are then rasterized in parallel
+     *          into a float depth buffer holding metric depth.
+     * @author  Robert Maier
+     */
+    class RasterScene : public Renderer
+    {
+    public:
+
+        /// Width and height of the screen tiles in pixels.
+        static const int TileSize = 32;
+
+        /// Number of pixels rasterized at once.
+        static const int PacketSize = 8;
+
+        typedef Eigen::Array<float, PacketSize, 1> PacketF;
+
+        /**
+         * @brief   Constructor for creating a scene for rasterization.
+         * @param   camera          Pinhole camera model.
+         * @param   renderer_cfg    Mesh renderer configuration (shading modes).
+         */
+        RasterScene(const Camera& camera, const ogl::MeshRenderer::Config &renderer_cfg);
+
+        /// Destructor.
+        virtual ~RasterScene();
+
+        /// Copy a mesh for rasterization.
+        virtual bool upload(const Mesh& mesh);
+
+        /// Copy mesh arrays (e.g. from a mesh cache) for rasterization.
+        virtual bool upload(const MeshView& mesh);
+
+        /**
+         * @brief   Renders the uploaded mesh into a synthetic color image and depth image
+         *          from a specified pose.
+         * @param   pose_world_to_cam   Target pose for rendering.
+         * @param   color_out   Rendered color image.
+         * @param   depth_out   Rendered metric depth map.
+         */
+        virtual bool render(const Mat4& pose_world_to_cam, cv::Mat& color_out, cv::Mat &depth_out);
+
+    private:
+        RasterScene(const RasterScene&);
+        RasterScene& operator=(const RasterScene&);
+
+        /**
+         * @brief   Set up triangle for rasterization. The edge functions are
+         *          E_i(x, y) = a_i * x + b_i * y + c_i in pixel coordinates,
+         *          oriented such that a pixel is covered if all E_i >= 0.
+         *          The inverse depth is a linear function of the pixel coordinates.
+         * @author  Robert Maier
+         */
+        struct TriangleSetup
+        {
+            float a[3];
+            float b[3];
+            float c[3];
+            float inv_depth[3];     // inverse depth (x, y and constant coefficient)
+            int x_min;
+            int y_min;
+            int x_max;
+            int y_max;
+        };
+
+        /// Set up a triangle and compute its pixel bounding box, returns false if it is culled.
+        bool setupTriangle(unsigned int face, TriangleSetup &tri) const;
+
+        /// Rasterize all triangles binned into a tile and shade the tile pixels.
+        void rasterizeTile(int tile_x, int tile_y, cv::Mat& color_out, cv::Mat &depth_out) const;
+
+        Camera camera_;
+        ogl::MeshRenderer::Config cfg_;
+        Mesh mesh_;
+        Shading shading_;
+        double near_;
+        double far_;
+
+        // per frame data (kept to avoid reallocations)
+        std::vector<Vec3f> vertices_cam_;
+        std::vector<TriangleSetup> triangles_;
+        std::vector<std::vector<unsigned int> > bins_;  // triangles per binning block and tile
+        size_t num_bin_blocks_;
+        int tiles_x_;
+        int tiles_y_;
+    };
+
+} // namespace cpu
+} // namespace menderer
@@ -0,0 +1,88 @@
+/**
+* This file is part of Menderer.
+*
+* Copyright 2019 Robert Maier, Technical University of Munich.
+* For more information see <https://github.com/robmaier/menderer>.
+*
+* Menderer is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* Menderer is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with Menderer. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <menderer/mat.h>
+
+#include <opencv2/core/core.hpp>
+
+#include <menderer/camera.h>
+#include <menderer/mesh.h>
+#include <menderer/renderer.h>
+#include <menderer/cpu/bvh.h>
+#include <menderer/cpu/shading.h>
+#include <menderer/ogl/mesh_renderer.h>
+
+
+namespace menderer
+{
+namespace cpu
+{
+
+    /**
+     * @brief   Scene for rendering on the CPU by ray casting a BVH,
+     *          without an OpenGL context.
+     * @author  Robert Maier
+     */
+    class RaycastScene : public Renderer
+    {
+    public:
+
+        /**
+         * @brief   Constructor for creating a scene for ray casting.
+         * @param   camera          Pinhole camera model.
+         * @param   renderer_cfg    Mesh renderer configuration (shading modes).
+         */
+        RaycastScene(const Camera& camera, const ogl::MeshRenderer::Config &renderer_cfg);
+
+        /// Destructor.
+        virtual ~RaycastScene();
+
+        /// Copy a mesh and build its BVH.
+        virtual bool upload(const Mesh& mesh);
+
+        /// Copy mesh arrays (e.g. from a mesh cache) and build their BVH.
+        virtual bool upload(const MeshView& mesh);
+
+        /**
+         * @brief   Renders the uploaded mesh into a synthetic color image and depth image
+         *          from a specified pose, using packets of 4x2 rays in parallel image tiles.
+         * @param   pose_world_to_cam   Target pose for rendering.
+         * @param   color_out   Rendered color image.
+         * @param   depth_out   Rendered metric depth map.
+         */
+        virtual bool render(const Mat4& pose_world_to_cam, cv::Mat& color_out, cv::Mat &depth_out);
+
+    private:
+        RaycastScene(const RaycastScene&);
+        RaycastScene& operator=(const RaycastScene&);
+
+        Camera camera_;
+        ogl::MeshRenderer::Config cfg_;
+        Mesh mesh_;
+        BVH bvh_;
+        Shading shading_;
+        double near_;
+        double far_;
+    };
+
+} // namespace cpu
+} // namespace menderer
@@ -0,0 +1,99 @@
+/**
+* This file is part of Menderer.
+*
+* Copyright 2019 Robert Maier, Technical University of Munich.
+* For more information see <https://github.com/robmaier/menderer>.
+*
+* Menderer is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* Menderer is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with Menderer. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <menderer/mat.h>
+#include <menderer/mesh.h>
+#include <menderer/ogl/mesh_renderer.h>
+
+
+namespace menderer
+{
+namespace cpu
+{
+
+    /**
+     * @brief   CPU shading of mesh surface points. Reproduces the shading modes
+     *          of the OpenGL mesh renderer: the shaders "normals", "normals_phong"
+     *          and "phong" as well as fixed-function colors and lighting.
+     * @author  Robert Maier
+     */
+    class Shading
+    {
+    public:
+
+        /// Constructor for creating the shading from the mesh renderer configuration.
+        Shading(const ogl::MeshRenderer::Config &cfg);
+
+        /// Destructor.
+        ~Shading();
+
+        /// Set the mesh whose vertex normals and colors are shaded (not owned).
+        void setMesh(const Mesh* mesh);
+
+        /// Set the view pose (mesh to camera coordinates).
+        void setPose(const Mat4 &pose_mesh_to_cam);
+
+        /// Returns the background color (BGR).
+        Vec3b background() const;
+
+        /**
+         * @brief   Shade a surface point of a triangle.
+         * @param   face    Triangle index.
+         * @param   b1      Barycentric coordinate of the second triangle vertex.
+         * @param   b2      Barycentric coordinate of the third triangle vertex.
+         * @param   pt      Surface point in camera coordinates.
+         * @return  Shaded color (BGR).
+         */
+        Vec3b shade(unsigned int face, float b1, float b2, const Vec3f &pt) const;
+
+    private:
+        /// Shading modes corresponding to the OpenGL shaders.
+        enum Mode
+        {
+            FixedFunction = 0,
+            Normals,
+            NormalsPhong,
+            Phong
+        };
+
+        /// Normal of a mesh vertex in eye coordinates (OpenGL camera with y and z axis flipped).
+        Vec3f eyeNormal(unsigned int v) const;
+
+        /// Fixed-function color of a mesh vertex (optionally lit per vertex).
+        Vec4f vertexColor(unsigned int v) const;
+
+        /// Converts an RGB(A) color to 8 bit BGR.
+        static Vec3b toBGR(const Vec4f &color);
+
+        ogl::MeshRenderer::Config cfg_;
+        Mode mode_;
+        Vec4f light_ambient_;
+        Vec4f light_diffuse_;
+        Vec4f light_specular_;
+        const Mesh* mesh_;
+        bool has_normals_;
+        bool has_colors_;
+        Mat3f rot_eye_;
+    };
+
+} // namespace cpu
+} // namespace menderer
@@ -27,6 +27,7 @@
 #include <opencv2/core.hpp>
 
 #include <menderer/camera.h>
+#include <menderer/encoder.h>
 #include <menderer/trajectory.h>
 
 namespace menderer
@@ -85,6 +86,9 @@ namespace menderer
         /// Save a depth map as binary file.
         static bool saveDepthBinary(const std::string &filename, const cv::Mat& depth);
 
+        /// Save an image with the specified encoder (e.g. PNG, PNM, raw or depth codec).
+        static bool save(const std::string &filename, const cv::Mat& img, const Encoder &encoder);
+
         /// Compute a 3D vertex map from a depth map using the camera intrinsics.
         bool depthToVertexMap(const cv::Mat &depth, cv::Mat &vertexMap) const;
 
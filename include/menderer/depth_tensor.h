@@ -0,0 +1,84 @@
+/**
+* This file is part of Menderer.
+*
+* Copyright 2019 Robert Maier, Technical University of Munich.
+* For more information see <https://github.com/robmaier/menderer>.
+*
+* Menderer is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* Menderer is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with Menderer. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <opencv2/core.hpp>
+
+
+namespace menderer
+{
+
+    /**
+     * @brief   Depth maps of all frames as a single contiguous N x H x W float32 array in a
+     *          NumPy .npy file. The file is preallocated and memory-mapped for writing, so
+     *          that rendered depth is read back directly into the slice of its frame
+     *          without intermediate copies or write calls per frame.
+     *          Uses mmap on POSIX systems and falls back to writing the array from memory
+     *          when closing on other platforms.
+     * @author  Robert Maier
+     */
+    class DepthTensor
+    {
+    public:
+
+        /// Constructor.
+        DepthTensor();
+
+        /// Destructor (closes the file).
+        ~DepthTensor();
+
+        /**
+         * @brief   Creates and maps the tensor file (an existing file is overwritten).
+         *          Slices of frames that are not rendered remain zero.
+         * @param   filename    Output filename (.npy).
+         * @param   num_frames  Number of frames N.
+         * @param   width       Depth map width W.
+         * @param   height      Depth map height H.
+         */
+        bool create(const std::string &filename, size_t num_frames, int width, int height);
+
+        /// Returns the depth map of a frame (CV_32FC1 header of the mapped slice, empty if out of range).
+        cv::Mat frame(size_t i);
+
+        /// Unmaps (or writes) and closes the file.
+        bool close();
+
+        /// Returns the number of frames.
+        size_t frames() const;
+
+    private:
+        DepthTensor(const DepthTensor&);
+        DepthTensor& operator=(const DepthTensor&);
+
+        std::string filename_;
+        char* data_;
+        size_t size_;
+        size_t header_size_;
+        size_t num_frames_;
+        int width_;
+        int height_;
+        bool mapped_;
+        std::vector<char> buffer_;
+    };
+
+} // namespace menderer
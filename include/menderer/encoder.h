@@ -0,0 +1,221 @@
+/**
+* This file is part of Menderer.
+*
+* Copyright 2019 Robert Maier, Technical University of Munich.
+* For more information see <https://github.com/robmaier/menderer>.
+*
+* Menderer is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* Menderer is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with Menderer. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <opencv2/core.hpp>
+
+
+namespace menderer
+{
+
+    /**
+     * @brief   Interface of encoders writing rendered images (color images, depth maps
+     *          and geometry buffers) to files.
+     *          Float depth maps are stored as 16 bit images scaled by a depth scale
+     *          by the image formats (PNG, PNM), other encoders store them losslessly.
+     *          Encoders are stateless and can be used from multiple threads.
+     * @author  Robert Maier
+     */
+    class Encoder
+    {
+    public:
+
+        /// Destructor.
+        virtual ~Encoder() {}
+
+        /// Returns the file extension (including the dot) for images of the given OpenCV type.
+        virtual std::string extension(int type) const = 0;
+
+        /**
+         * @brief   Encodes an image into a byte stream (e.g. for writing into an archive).
+         * @param   img         Image to be encoded.
+         * @param   data        Encoded data (file contents).
+         * @return  True if the image was encoded successfully.
+         */
+        virtual bool encode(const cv::Mat &img, std::vector<unsigned char> &data) const = 0;
+
+        /**
+         * @brief   Encodes an image and writes it to a file.
+         * @param   filename    Output filename (including the extension).
+         * @param   img         Image to be written.
+         * @return  True if the image was written successfully.
+         */
+        virtual bool save(const std::string &filename, const cv::Mat &img) const;
+
+        /**
+         * @brief   Creates an encoder from its name.
+         * @param   format      Encoder name ("png", "pnm", "raw", "codec" or "bin").
+         * @param   png_compression PNG compression level (0-9, -1: OpenCV default).
+         * @return  Encoder, or empty pointer for unknown formats.
+         */
+        static std::unique_ptr<Encoder> create(const std::string &format, int png_compression = -1);
+
+        /**
+         * @brief   Decodes an image from a byte stream written by an encoder.
+         * @param   extension   File extension of the encoded data (".png", ".ppm", ".pgm",
+         *                      ".npy" or ".mdc", headerless .bin data cannot be decoded).
+         * @param   data        Encoded data.
+         * @param   img         Decoded image (depth from .png/.pgm as scaled 16 bit values).
+         * @return  True if the image was decoded successfully.
+         */
+        static bool decode(const std::string &extension, const std::vector<unsigned char> &data, cv::Mat &img);
+    };
+
+
+    /**
+     * @brief   PNG encoder with configurable compression level (lower levels are faster).
+     * @author  Robert Maier
+     */
+    class PngEncoder : public Encoder
+    {
+    public:
+        /**
+         * @brief   Constructor.
+         * @param   compression Compression level (0-9, -1: OpenCV default).
+         * @param   depth_scale Scale factor for storing float depth as 16 bit values.
+         */
+        PngEncoder(int compression = -1, double depth_scale = 5000.0);
+
+        virtual std::string extension(int type) const;
+
+        virtual bool encode(const cv::Mat &img, std::vector<unsigned char> &data) const;
+
+        virtual bool save(const std::string &filename, const cv::Mat &img) const;
+
+    private:
+        /// Returns the OpenCV PNG writer parameters (compression level).
+        std::vector<int> params() const;
+
+        /// Returns the image to be written, float depth converted into a 16 bit image (reused per thread).
+        const cv::Mat& convert(const cv::Mat &img) const;
+
+        int compression_;
+        double depth_scale_;
+    };
+
+
+    /**
+     * @brief   Uncompressed binary PPM (color) and PGM (grayscale, depth) encoder.
+     * @author  Robert Maier
+     */
+    class PnmEncoder : public Encoder
+    {
+    public:
+        /**
+         * @brief   Constructor.
+         * @param   depth_scale Scale factor for storing float depth as 16 bit values.
+         */
+        PnmEncoder(double depth_scale = 5000.0);
+
+        virtual std::string extension(int type) const;
+
+        virtual bool encode(const cv::Mat &img, std::vector<unsigned char> &data) const;
+
+    private:
+        double depth_scale_;
+    };
+
+
+    /**
+     * @brief   Raw encoder writing the uncompressed (row-major, interleaved) pixel data,
+     *          either with a self-describing NumPy .npy header (type and shape) or as
+     *          headerless .bin file.
+     * @author  Robert Maier
+     */
+    class RawEncoder : public Encoder
+    {
+    public:
+        /**
+         * @brief   Constructor.
+         * @param   header  Write .npy header (otherwise headerless .bin file).
+         */
+        RawEncoder(bool header = true);
+
+        virtual std::string extension(int type) const;
+
+        virtual bool encode(const cv::Mat &img, std::vector<unsigned char> &data) const;
+
+        virtual bool save(const std::string &filename, const cv::Mat &img) const;
+
+        /**
+         * @brief   Creates the NumPy .npy (version 1.0) header for an array of the given
+         *          shape and OpenCV element type (padded to a multiple of 64 bytes).
+         * @param   shape   Array dimensions (e.g. rows, cols and channels).
+         * @param   type    OpenCV type of the elements (channels are ignored).
+         * @param   header  Output header.
+         * @return  False if the element type is not supported.
+         */
+        static bool npyHeader(const std::vector<size_t> &shape, int type, std::string &header);
+
+        /**
+         * @brief   Parses a NumPy .npy header (little endian, C order).
+         * @param   data        Beginning of the .npy data.
+         * @param   size        Size of the data in bytes.
+         * @param   shape       Array dimensions.
+         * @param   type        OpenCV type of the elements (single channel).
+         * @param   header_size Size of the header (offset of the array data).
+         * @return  False if the header is invalid or the element type is not supported.
+         */
+        static bool parseNpyHeader(const char* data, size_t size, std::vector<size_t> &shape,
+                                   int &type, size_t &header_size);
+
+    private:
+        /// Create the .npy header for an image (empty without header).
+        bool createHeader(const cv::Mat &img, std::string &header) const;
+
+        bool header_;
+    };
+
+
+    /**
+     * @brief   Fast lossless codec for float depth maps (.mdc files).
+     *          The float bit patterns of each pixel are predicted from their left, upper
+     *          and upper left neighbors (median edge detector), and the prediction
+     *          residuals are entropy coded with adaptive Golomb-Rice codes per block
+     *          of pixels. Horizontal strips of rows are coded independently in parallel.
+     * @author  Robert Maier
+     */
+    class DepthCodecEncoder : public Encoder
+    {
+    public:
+
+        /// Number of image rows per independently coded strip.
+        static const int StripRows = 16;
+
+        /// Number of residuals sharing a Golomb-Rice parameter.
+        static const int BlockSize = 32;
+
+        virtual std::string extension(int type) const;
+
+        /// Encodes a float depth map (CV_32FC1) into a byte stream.
+        virtual bool encode(const cv::Mat &img, std::vector<unsigned char> &data) const;
+
+        /// Decodes a float depth map from a byte stream.
+        static bool decode(const std::vector<unsigned char> &data, cv::Mat &depth);
+
+        /// Loads and decodes a float depth map from a .mdc file.
+        static bool load(const std::string &filename, cv::Mat &depth);
+    };
+
+} // namespace menderer
@@ -0,0 +1,153 @@
+/**
+* This file is part of Menderer.
+*
+* Copyright 2019 Robert Maier, Technical University of Munich.
+* For more information see <https://github.com/robmaier/menderer>.
+*
+* Menderer is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* Menderer is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with Menderer. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include <opencv2/core.hpp>
+
+#include <menderer/mapped_file.h>
+
+
+namespace menderer
+{
+
+    /**
+     * @brief   Index entry of an encoded chunk (one output channel of a frame) in a frame archive.
+     * @author  Robert Maier
+     */
+    struct FrameArchiveEntry
+    {
+        uint64_t frame;         // frame id
+        std::string channel;    // channel name with file extension (e.g. "color.png", "depth.mdc")
+        uint64_t offset;        // offset of the chunk data in the archive
+        uint64_t size;          // size of the chunk data in bytes
+    };
+
+
+    /**
+     * @brief   Writer of frame archives (.mfa files), which store the encoded output channels of
+     *          all rendered frames in a single file instead of one file per frame and channel.
+     *          Chunks are appended with a small self-describing header and flushed, a trailing
+     *          index of all chunks is written when the archive is closed. Archives of
+     *          interrupted runs have no index but can still be read by scanning the chunks.
+     * @author  Robert Maier
+     */
+    class FrameArchiveWriter
+    {
+    public:
+
+        /// Constructor.
+        FrameArchiveWriter();
+
+        /// Destructor (closes the archive).
+        ~FrameArchiveWriter();
+
+        /// Create a new archive file (an existing file is overwritten).
+        bool open(const std::string &filename);
+
+        /**
+         * @brief   Appends a chunk to the archive (thread-safe).
+         * @param   frame       Frame id.
+         * @param   channel     Channel name with file extension (e.g. "color.png").
+         * @param   data        Encoded data of the channel.
+         */
+        bool write(size_t frame, const std::string &channel, const std::vector<unsigned char> &data);
+
+        /// Writes the index and closes the archive.
+        bool close();
+
+        /// Checks whether an archive is open for writing.
+        bool isOpen() const;
+
+    private:
+        FrameArchiveWriter(const FrameArchiveWriter&);
+        FrameArchiveWriter& operator=(const FrameArchiveWriter&);
+
+        std::mutex mutex_;
+        std::ofstream file_;
+        uint64_t offset_;
+        std::vector<FrameArchiveEntry> entries_;
+    };
+
+
+    /**
+     * @brief   Random access reader of frame archives (.mfa files).
+     *          The archive is memory-mapped, the chunks are located through the trailing
+     *          index or, for archives of interrupted runs, by scanning the chunk headers.
+     * @author  Robert Maier
+     */
+    class FrameArchiveReader
+    {
+    public:
+
+        /// Constructor.
+        FrameArchiveReader();
+
+        /// Destructor.
+        ~FrameArchiveReader();
+
+        /// Open an archive and read its index.
+        bool open(const std::string &filename);
+
+        /// Close the archive.
+        void close();
+
+        /// Returns the index entries of all chunks in the archive (in file order).
+        const std::vector<FrameArchiveEntry>& entries() const;
+
+        /// Checks whether the archive was closed properly (otherwise the index was recovered by scanning).
+        bool complete() const;
+
+        /// Returns the index entry of a frame's channel, or nullptr if it is not in the archive.
+        const FrameArchiveEntry* find(size_t frame, const std::string &channel) const;
+
+        /// Returns a pointer to the encoded data of a chunk (valid while the archive is open).
+        const unsigned char* data(const FrameArchiveEntry &entry) const;
+
+        /// Reads the encoded data of a frame's channel.
+        bool read(size_t frame, const std::string &channel, std::vector<unsigned char> &data) const;
+
+        /// Reads and decodes an image channel of a frame (decoder selected by the channel extension).
+        bool read(size_t frame, const std::string &channel, cv::Mat &img) const;
+
+    private:
+        FrameArchiveReader(const FrameArchiveReader&);
+        FrameArchiveReader& operator=(const FrameArchiveReader&);
+
+        /// Read the trailing index, returns false if the archive has no valid index.
+        bool readIndex();
+
+        /// Recover the index by scanning the chunk headers (up to the first incomplete chunk).
+        void scanChunks();
+
+        MappedFile file_;
+        std::vector<FrameArchiveEntry> entries_;
+        std::map<std::pair<uint64_t, std::string>, size_t> lookup_;
+        bool complete_;
+    };
+
+} // namespace menderer
@@ -0,0 +1,84 @@
+/**
+* This file is part of Menderer.
+*
+* Copyright 2019 Robert Maier, Technical University of Munich.
+* For more information see <https://github.com/robmaier/menderer>.
+*
+* Menderer is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* Menderer is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with Menderer. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <vector>
+#include <opencv2/core/core.hpp>
+
+
+namespace menderer
+{
+
+    /**
+     * @brief   Pool of preallocated output frames (color image and depth map) that are
+     *          reused across rendered frames. The images are allocated page-aligned and
+     *          touched once up front, so that a steady-state render loop writes into the
+     *          same memory without heap allocations or page faults.
+     * @author  Robert Maier
+     */
+    class FramePool
+    {
+    public:
+
+        /**
+         * @brief   Output images of a frame (headers of the pooled memory, the pool must
+         *          outlive them).
+         * @author  Robert Maier
+         */
+        struct Frame
+        {
+            cv::Mat color;      // BGR color image (CV_8UC3, empty without color)
+            cv::Mat depth;      // metric depth map (CV_32FC1)
+        };
+
+        /**
+         * @brief   Constructor for allocating a pool of frames.
+         * @param   width       Image width.
+         * @param   height      Image height.
+         * @param   num_frames  Number of frames (e.g. the number of frames in flight).
+         * @param   color       Allocate color images (not needed for depth-only rendering).
+         */
+        FramePool(int width, int height, size_t num_frames = 1, bool color = true);
+
+        /// Destructor.
+        ~FramePool();
+
+        /// Returns the next frame (in round-robin order).
+        Frame& next();
+
+        /// Returns the number of frames.
+        size_t size() const;
+
+    private:
+        FramePool(const FramePool&);
+        FramePool& operator=(const FramePool&);
+
+        /// Allocate a page-aligned image (not owned by the returned cv::Mat).
+        cv::Mat allocate(int type);
+
+        int width_;
+        int height_;
+        std::vector<Frame> frames_;
+        std::vector<void*> blocks_;
+        size_t next_;
+    };
+
+} // namespace menderer
@@ -0,0 +1,71 @@
+/**
+* This file is part of Menderer.
+*
+* Copyright 2019 Robert Maier, Technical University of Munich.
+* For more information see <https://github.com/robmaier/menderer>.
+*
+* Menderer is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* Menderer is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with Menderer. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+
+namespace menderer
+{
+
+    /**
+     * @brief   Read-only memory mapping of a file.
+     *          Uses mmap on POSIX systems and falls back to reading
+     *          the whole file into memory on other platforms.
+     * @author  Robert Maier
+     */
+    class MappedFile
+    {
+    public:
+
+        /// Constructor for creating an empty (unmapped) file.
+        MappedFile();
+
+        /// Destructor.
+        ~MappedFile();
+
+        /// Map a file into memory (read-only).
+        bool open(const std::string &filename);
+
+        /// Unmap the file.
+        void close();
+
+        /// Returns the pointer to the first byte of the mapped file.
+        const char* data() const;
+
+        /// Returns the size of the mapped file in bytes.
+        size_t size() const;
+
+        /// Checks if no file is mapped.
+        bool empty() const;
+
+    private:
+        MappedFile(const MappedFile&);
+        MappedFile& operator=(const MappedFile&);
+
+        const char* data_;
+        size_t size_;
+        bool mapped_;
+        std::vector<char> buffer_;
+    };
+
+} // namespace menderer
@@ -29,8 +29,32 @@
 namespace menderer
 {
 
+    /**
+     * @brief   Non-owning view onto the arrays of a 3D triangle mesh
+     *          (e.g. memory-mapped from a mesh cache).
+     * @author  Robert Maier
+     */
+    struct MeshView
+    {
+    public:
+
+        Vec3 origin = Vec3::Zero();
+        const Vec3f* vertices = nullptr;
+        size_t num_vertices = 0;
+        const Vec3f* normals = nullptr;
+        size_t num_normals = 0;
+        const Vec3b* colors = nullptr;
+        size_t num_colors = 0;
+        const Vec3ui* face_vertices = nullptr;
+        size_t num_faces = 0;
+    };
+
+
     /**
      * @brief   Struct for representing a 3D triangle mesh.
+     *          Vertex positions are stored in single precision relative to
+     *          a double precision origin (world position = origin + vertex),
+     *          which keeps georeferenced meshes precise.
      * @author  Robert Maier
      */
     struct Mesh
@@ -46,8 +70,12 @@ namespace menderer
         /// Print mesh information.
         void print() const;
 
-        std::vector<Vec3> vertices;
-        std::vector<Vec3> normals;
+        /// Returns a view onto the mesh arrays.
+        MeshView view() const;
+
+        Vec3 origin = Vec3::Zero();
+        std::vector<Vec3f> vertices;
+        std::vector<Vec3f> normals;
         std::vector<Vec3b> colors;
         std::vector<Vec3ui> face_vertices;
     };
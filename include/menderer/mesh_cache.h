@@ -0,0 +1,113 @@
+/**
+* This file is part of Menderer.
+*
+* Copyright 2019 Robert Maier, Technical University of Munich.
+* For more information see <https://github.com/robmaier/menderer>.
+*
+* Menderer is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* Menderer is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with Menderer. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <menderer/mat.h>
+
+#include <cstdint>
+#include <string>
+#include <menderer/mapped_file.h>
+#include <menderer/mesh.h>
+
+
+namespace menderer
+{
+
+    /**
+     * @brief   Persistent cache of a preprocessed (welded and normal-equipped)
+     *          mesh, stored as binary .mmesh file next to the source mesh.
+     *          The cache is keyed by size, modification time and content hash
+     *          of the source mesh file and is memory-mapped when loaded.
+     * @author  Robert Maier
+     */
+    class MeshCache
+    {
+    public:
+
+        /// Preprocessing steps applied to the cached mesh.
+        enum Flags
+        {
+            None = 0,
+            Optimized = 1
+        };
+
+        /// Constructor for creating an empty mesh cache.
+        MeshCache();
+
+        /// Destructor.
+        ~MeshCache();
+
+        /// Returns the cache filename for a source mesh file.
+        static std::string filename(const std::string &mesh_file);
+
+        /// Map the cache of a source mesh file (fails if missing, outdated or preprocessed differently).
+        bool open(const std::string &mesh_file, unsigned int flags = None);
+
+        /// Write the preprocessed mesh into the cache of a source mesh file.
+        static bool save(const std::string &mesh_file, const Mesh &mesh, unsigned int flags = None);
+
+        /// Unmap the cache.
+        void close();
+
+        /// Checks if no cache is mapped.
+        bool empty() const;
+
+        /// Returns a view onto the cached mesh arrays.
+        const MeshView& view() const;
+
+    private:
+        MeshCache(const MeshCache&);
+        MeshCache& operator=(const MeshCache&);
+
+        /// Cache file header.
+        struct Header
+        {
+            char magic[8];
+            uint32_t version;
+            uint32_t flags;
+            uint64_t source_size;
+            int64_t source_mtime;
+            uint64_t source_hash;
+            double origin[3];
+            uint64_t num_vertices;
+            uint64_t num_normals;
+            uint64_t num_colors;
+            uint64_t num_faces;
+            uint64_t offset_vertices;
+            uint64_t offset_normals;
+            uint64_t offset_colors;
+            uint64_t offset_faces;
+        };
+
+        /// Computes the cache key (size, modification time, content hash) of a file.
+        static bool computeKey(const std::string &filename, Header &header);
+
+        /// Computes a 64 bit hash of the file content.
+        static uint64_t computeHash(const char* data, size_t size);
+
+        /// Creates a new, uniquely named temporary file next to a file (permissions subject to the umask).
+        static bool createTempFile(const std::string &filename, std::string &tmp_file);
+
+        MappedFile file_;
+        MeshView view_;
+    };
+
+} // namespace menderer
@@ -24,6 +24,9 @@
 #include <menderer/mat.h>
 #include <menderer/mesh.h>
 
+#include <limits>
+#include <vector>
+
 
 namespace menderer
 {
@@ -36,25 +39,183 @@ namespace menderer
     {
     public:
 
-        /// Compute the per-vertex normals of a mesh.
-        static void computeVertexNormals(Mesh &mesh);
+        /**
+         * @brief   Vertex-to-face adjacency in compressed sparse row (CSR) format:
+         *          the faces incident to vertex v are stored (in ascending order)
+         *          in faces[offsets[v]] ... faces[offsets[v + 1] - 1].
+         * @author  Robert Maier
+         */
+        struct VertexFaceAdjacency
+        {
+        public:
+
+            /// Number of faces incident to a vertex.
+            unsigned int size(unsigned int v) const { return offsets[v + 1] - offsets[v]; }
+
+            /// First incident face of a vertex.
+            const unsigned int* begin(unsigned int v) const { return faces.data() + offsets[v]; }
+
+            /// End of incident faces of a vertex.
+            const unsigned int* end(unsigned int v) const { return faces.data() + offsets[v + 1]; }
+
+            std::vector<unsigned int> offsets;
+            std::vector<unsigned int> faces;
+        };
+
+        /**
+         * @brief   Level of detail of a mesh, with simplified triangles
+         *          referencing the vertices of the original mesh.
+         * @author  Robert Maier
+         */
+        struct LevelOfDetail
+        {
+        public:
+
+            std::vector<Vec3ui> face_vertices;
+            float error = 0.0f;     // maximum geometric error (in mesh units)
+        };
+
+        /**
+         * @brief   Spatially coherent cluster of triangles (meshlet) with
+         *          bounds for view frustum and backface culling.
+         *          A cluster is entirely backfacing for a camera center c if
+         *          dot(normalize(cone_apex - c), cone_axis) >= cone_cutoff.
+         * @author  Robert Maier
+         */
+        struct Cluster
+        {
+        public:
+
+            size_t first_face = 0;
+            size_t num_faces = 0;
+            Vec3f bbox_min = Vec3f::Zero();
+            Vec3f bbox_max = Vec3f::Zero();
+            Vec3f cone_apex = Vec3f::Zero();
+            Vec3f cone_axis = Vec3f::Zero();
+            float cone_cutoff = 2.0f;   // > 1: never backfacing
+        };
+
+        /// Weighting of face normals for computing vertex normals.
+        enum NormalWeighting
+        {
+            Uniform = 0,
+            Area,
+            Angle
+        };
+
+        /// Build the vertex-to-face adjacency of a mesh (in parallel).
+        static void computeVertexFaceAdjacency(const Mesh &mesh, VertexFaceAdjacency &adjacency);
+
+        /// Build the vertex-to-face adjacency of mesh arrays (in parallel).
+        static void computeVertexFaceAdjacency(const MeshView &mesh, VertexFaceAdjacency &adjacency);
+
+        /// Compute the per-vertex normals of a mesh (in parallel).
+        static void computeVertexNormals(Mesh &mesh, NormalWeighting weighting = Uniform);
 
-        /// Compress mesh vertices by removing redundant/duplicate vertices.
-        static void compressVertices(Mesh &mesh);
+        /// Compute the per-vertex normals of a mesh using a precomputed adjacency.
+        static void computeVertexNormals(Mesh &mesh, const VertexFaceAdjacency &adjacency,
+                                         NormalWeighting weighting = Uniform);
+
+        /**
+         * @brief   Compress mesh vertices by removing redundant/duplicate vertices
+         *          (deterministic parallel hash-based welding).
+         * @param   mesh        Mesh to be compressed.
+         * @param   epsilon     Grid cell size for merging near-duplicate vertices
+         *                      (0: merge exact duplicates only).
+         */
+        static void compressVertices(Mesh &mesh, double epsilon = 0.0);
+
+        /**
+         * @brief   Reorder triangles and vertices for efficient rendering:
+         *          vertex cache optimization, overdraw-aware cluster ordering
+         *          and vertex fetch optimization.
+         * @param   mesh                Mesh to be optimized.
+         * @param   cache_size          Simulated post-transform vertex cache size.
+         * @param   overdraw_threshold  Maximum allowed vertex cache degradation
+         *                              (ACMR ratio) for splitting clusters.
+         */
+        static void optimizeForRendering(Mesh &mesh, unsigned int cache_size = 16,
+                                         float overdraw_threshold = 1.05f);
+
+        /**
+         * @brief   Reorder triangles for post-transform vertex cache locality (Tipsify).
+         * @param   mesh        Mesh to be optimized.
+         * @param   cache_size  Simulated post-transform vertex cache size.
+         * @param   clusters    Optional output of the first triangle of each cluster
+         *                      (hard boundaries of the triangle order).
+         */
+        static void optimizeVertexCache(Mesh &mesh, unsigned int cache_size = 16,
+                                        std::vector<unsigned int>* clusters = nullptr);
+
+        /**
+         * @brief   Reorder triangle clusters to reduce overdraw (view-independent),
+         *          with clusters split where the vertex cache efficiency allows.
+         * @param   mesh                Mesh to be optimized.
+         * @param   clusters            First triangle of each (hard) cluster.
+         * @param   cache_size          Simulated post-transform vertex cache size.
+         * @param   overdraw_threshold  Maximum allowed vertex cache degradation (ACMR ratio).
+         */
+        static void optimizeOverdraw(Mesh &mesh, const std::vector<unsigned int> &clusters,
+                                     unsigned int cache_size = 16, float overdraw_threshold = 1.05f);
+
+        /// Reorder vertices in the order of their first use by the triangles.
+        static void optimizeVertexFetch(Mesh &mesh);
+
+        /**
+         * @brief   Build a chain of increasingly coarse levels of detail by quadric
+         *          error half-edge collapses (boundaries are preserved). All levels
+         *          share the original vertices, so colors and normals are kept.
+         * @param   mesh        Input mesh arrays.
+         * @param   lods        Levels of detail (excluding the full resolution mesh).
+         * @param   reduction   Ratio of face counts between successive levels.
+         * @param   min_faces   Minimum number of faces of the coarsest level.
+         */
+        static void buildLODs(const MeshView &mesh, std::vector<LevelOfDetail> &lods,
+                              float reduction = 0.25f, size_t min_faces = 1024);
+
+        /**
+         * @brief   Partition the triangles into spatially coherent clusters
+         *          by sorting them along a Morton curve of their centroids.
+         *          The relative triangle order within each cluster is kept.
+         * @param   mesh        Input mesh arrays.
+         * @param   faces       Output triangles, reordered by cluster.
+         * @param   face_ids    Output input triangle index of each reordered triangle.
+         * @param   clusters    Output clusters (ranges within the reordered triangles).
+         * @param   max_faces   Maximum number of triangles per cluster.
+         */
+        static void buildClusters(const MeshView &mesh, std::vector<Vec3ui> &faces, std::vector<unsigned int> &face_ids,
+                                  std::vector<Cluster> &clusters, size_t max_faces = 256);
+
+        /// Compute the average cache miss ratio (ACMR) of triangles [begin, end) for a FIFO vertex cache.
+        static float computeACMR(const Mesh &mesh, unsigned int cache_size = 16,
+                                 size_t begin = 0, size_t end = std::numeric_limits<size_t>::max());
 
         /// Create mesh from RGB-D frame.
         static bool createFromRGBD(const cv::Mat &vertex_map, const cv::Mat &color,
                                    const Mat4 &pose_cam_to_world, Mesh &mesh);
 
     private:
-        /// Compute the per-triangle face normals for all faces of a mesh.
-        static void computeFaceNormals(const Mesh &mesh, std::vector<Vec3> &faceNormals);
+        /// Symmetric 4x4 error quadric (upper triangle).
+        typedef Eigen::Matrix<double, 10, 1, Eigen::DontAlign> Quadric;
+
+        /// Compute the error quadric of the plane of a triangle.
+        static Quadric computePlaneQuadric(const Vec3f &v0, const Vec3f &v1, const Vec3f &v2);
+
+        /// Evaluate the error quadric (squared plane distances) at a point.
+        static double evaluateQuadric(const Quadric &q, const Vec3f &p);
+
+        /// Compute the 30 bit Morton code of a point within the unit cube.
+        static unsigned int computeMortonCode(const Vec3f &p);
+
+        /// Compute the per-triangle face normals (unit length or scaled by twice the area).
+        static void computeFaceNormals(const Mesh &mesh, std::vector<Vec3f> &faceNormals,
+                                       bool normalize = true);
 
         /// Remove degenerate triangles of a mesh.
         static void removeDegenerateFaces(Mesh &mesh);
 
         /// Compute the area of a single triangle.
-        static double computeFaceArea(const Vec3 &v0, const Vec3 &v1, const Vec3 &v2);
+        static double computeFaceArea(const Vec3f &v0, const Vec3f &v1, const Vec3f &v2);
 
     };
 
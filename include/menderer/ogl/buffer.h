@@ -41,7 +41,8 @@ namespace ogl
 
         /**
          * @brief   Constructor for creating a buffer.
-         * @param   target          GL_ARRAY_BUFFER or GL_ELEMENT_ARRAY_BUFFER.
+         * @param   target          GL_ARRAY_BUFFER, GL_ELEMENT_ARRAY_BUFFER, GL_UNIFORM_BUFFER
+         *                          GL_PIXEL_PACK_BUFFER or GL_TEXTURE_BUFFER.
          */
         Buffer(GLenum target);
 
@@ -54,13 +55,32 @@ namespace ogl
         /// Unbind the buffer.
         void unbind();
 
+        /// Bind the buffer to an indexed binding point (e.g. of a uniform block).
+        void bindBase(GLuint index);
+
         /// Upload data (from std::vector) onto the buffer on the GPU.
         template<typename T>
         bool upload(const std::vector<T> &data, GLenum usage = GL_STATIC_DRAW);
 
+        /// Upload data (from array with size elements) onto the buffer on the GPU.
+        template<typename T>
+        bool upload(const T* data, size_t size, GLenum usage = GL_STATIC_DRAW);
+
+        /// Allocate the buffer on the GPU without uploading data (e.g. as pixel pack buffer for readbacks).
+        bool allocate(size_t byte_size, GLenum usage = GL_STREAM_READ);
+
+        /// Map the buffer for reading its data on the CPU (returns nullptr on failure).
+        const void* mapRead();
+
+        /// Unmap the mapped buffer.
+        void unmap();
+
         /// Clear the buffer.
         void clear();
 
+        /// Returns the OpenGL buffer id.
+        GLuint id() const;
+
         /// Returns the size (number of elements) in the buffer.
         size_t size() const;
 
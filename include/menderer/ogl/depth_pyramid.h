@@ -0,0 +1,83 @@
+/**
+* This file is part of Menderer.
+*
+* Copyright 2019 Robert Maier, Technical University of Munich.
+* For more information see <https://github.com/robmaier/menderer>.
+*
+* Menderer is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* Menderer is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with Menderer. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <menderer/mat.h>
+#include <menderer/ogl/framebuffer.h>
+#include <menderer/ogl/program.h>
+#include <menderer/ogl/texture.h>
+
+
+namespace menderer
+{
+namespace ogl
+{
+
+    /**
+     * @brief   Hierarchical depth buffer (maximum depth pyramid) for occlusion culling.
+     *          The pyramid is reduced on the GPU into the mipmap levels of a single
+     *          texture (level 0 has half the depth resolution), which is sampled by the
+     *          cluster occlusion test without downloading it.
+     * @author  Robert Maier
+     */
+    class DepthPyramid
+    {
+    public:
+
+        /// Constructor for creating an empty depth pyramid.
+        DepthPyramid();
+
+        /// Destructor.
+        ~DepthPyramid();
+
+        /// Build the pyramid from a depth texture (the bound framebuffer is restored).
+        bool build(Texture &depth);
+
+        /// Reset/clear the pyramid.
+        void reset();
+
+        /// Checks if the pyramid is empty (not built yet).
+        bool empty() const;
+
+        /// Returns the pyramid texture (maximum depth of level l texels covering 2^(l+1) x 2^(l+1) pixels).
+        Texture& texture();
+
+    private:
+        DepthPyramid(const DepthPyramid&);
+        DepthPyramid& operator=(const DepthPyramid&);
+
+        /// Allocate the pyramid levels for a depth texture size.
+        bool allocate(int width, int height);
+
+        int width_;
+        int height_;
+        bool built_;
+        Texture tex_;
+        std::vector<std::unique_ptr<Framebuffer> > fbs_;
+        Program program_;
+        bool core_profile_;
+        GLuint vao_;
+    };
+
+} // namespace ogl
+} // namespace menderer
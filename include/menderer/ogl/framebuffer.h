@@ -55,8 +55,8 @@ namespace ogl
         /// Set draw buffers list.
         bool drawBuffers();
 
-        /// Attach target output textures used for frame buffer drawing.
-        void attach(const Texture& tex);
+        /// Attach target output textures used for frame buffer drawing (array textures as layered attachments, optionally a mipmap level).
+        void attach(const Texture& tex, int level = 0);
 
         /// Clear draw buffers and detach attached textures.
         void clear();
@@ -23,8 +23,12 @@
 #include <vector>
 #include <menderer/mat.h>
 #include <menderer/mesh.h>
+#include <menderer/mesh_util.h>
 #include <menderer/ogl/buffer.h>
+#include <menderer/ogl/depth_pyramid.h>
 #include <menderer/ogl/program.h>
+#include <menderer/ogl/render_context.h>
+#include <menderer/ogl/texture.h>
 
 
 namespace menderer
@@ -40,6 +44,25 @@ namespace ogl
     {
     public:
 
+        /// Maximum number of views per instanced draw call (size of the view uniform block of the batch shaders).
+        static const int MaxBatchViews = 64;
+
+        /**
+         * @brief   Draw buffers (fragment shader outputs) written by the shaders,
+         *          i.e. the color attachments of the bound framebuffer in this order.
+         * @author  Robert Maier
+         */
+        enum DrawBuffer
+        {
+            ColorBuffer = 0,
+            LinearDepthBuffer = 1,
+            VertexMapBuffer = 2,    // camera space vertices (RGB32F)
+            NormalMapBuffer = 3,    // camera space normals (RGB32F)
+            FaceIdBuffer = 4,       // triangle indices of the input mesh (R32I)
+            BarycentricBuffer = 5,  // barycentric coordinates within the triangle (RGB32F)
+            NumDrawBuffers = 6
+        };
+
         /**
          * @brief   Mesh renderer configuration struct
          * @author  Robert Maier
@@ -55,6 +78,13 @@ namespace ogl
             bool colored = true;
             bool smooth = true;
             bool cull_backfaces = false;
+            float lod_pixel_error = 0.0f;   // max. screen-space error of levels of detail (0: disabled)
+            bool cull_clusters = false;     // view frustum (and backface) culling of triangle clusters
+            bool cull_occlusion = false;    // occlusion culling of triangle clusters (implies cull_clusters)
+            size_t cluster_size = 256;      // max. number of triangles per cluster
+            bool core_profile = false;      // render with a vertex array object and GLSL 3.30 shaders (core profile context)
+            bool geometry_buffers = false;  // also write vertex/normal maps, triangle ids and barycentrics (draw buffers 2-5)
+            bool depth_only = false;        // write only metric depth (into the single draw buffer), no shading or blending
 
             /// Print out renderer configuration.
             void print() const;
@@ -79,27 +109,194 @@ namespace ogl
         /// Upload the mesh onto the buffers on the GPU.
         void update(const Mesh &mesh);
 
-        /// Render the mesh.
-        void draw();
+        /// Upload the mesh arrays (e.g. from a mesh cache) as interleaved vertices onto the GPU.
+        void update(const MeshView &mesh);
+
+        /// Select the level of detail and the visible clusters for the view (pose and projection) of a render context.
+        void setView(const RenderContext &render_ctx);
+
+        /// Returns the currently selected level of detail (0: full resolution).
+        size_t lod() const;
+
+        /// Returns the number of clusters drawn (or to be drawn) for the current view (before occlusion culling on the GPU).
+        size_t numVisibleClusters() const;
+
+        /**
+         * @brief   Render the mesh.
+         * @param   depth   Depth texture of the bound framebuffer, used for occlusion
+         *                  culling (it holds the previous frame's depth when called).
+         *                  Clusters are tested on the GPU, which writes indirect draw
+         *                  commands, so that the CPU never waits for the depth buffer.
+         */
+        void draw(Texture* depth = nullptr);
+
+        /// Checks if the shader writes linear (metric) depth (second draw buffer, first one if depth-only; not fixed-function).
+        bool writesLinearDepth() const;
+
+        /**
+         * @brief   Checks if geometry buffers are enabled and supported, i.e. if the draw call also writes
+         *          vertex and normal maps, triangle ids and barycentric coordinates into the draw buffers
+         *          VertexMapBuffer to BarycentricBuffer (using the GLSL 3.30 shaders with a geometry shader,
+         *          which is created on the first call).
+         */
+        bool writesGeometryBuffers();
+
+        /// Checks if the context supports occlusion culling on the GPU (OpenGL 4.3 compute shaders and indirect draws).
+        bool supportsOcclusionCulling();
+
+        /// Checks if the context supports rendering batches of views (GLSL 3.30 and layer selection in the vertex shader).
+        bool supportsBatch();
+
+        /**
+         * @brief   Render the full resolution mesh from multiple views in one pass into the layers
+         *          of the bound layered framebuffer, with one draw instance per view.
+         * @param   render_ctx  Render context with the projection (and viewport) shared by all views.
+         * @param   modelviews  Model view matrices of the views (view i is rendered into layer i).
+         */
+        bool drawBatch(const RenderContext &render_ctx, const std::vector<Mat4> &modelviews);
 
         /// Create shader for rendering from shader name.
         void createShader(const std::string &shader_name = "");
 
     private:
+        /// Level of detail as range within the index buffer.
+        struct LevelOfDetail
+        {
+            size_t first_face;
+            size_t num_faces;
+            float error;
+        };
+
+        /// Indirect draw command (layout of glDrawElementsIndirect, written by the occlusion test shader).
+        struct DrawCommand
+        {
+            GLuint count;
+            GLuint instance_count;
+            GLuint first_index;
+            GLint base_vertex;
+            GLuint base_instance;
+        };
+
+        typedef Eigen::Array<bool, Eigen::Dynamic, 1> ArrayXb;
+
+        /// Cull clusters against the view frustum (and normal cones) of a render context.
+        void cullClusters(const RenderContext &render_ctx);
+
+        /// Merge consecutive clusters into index ranges for a multi-draw call.
+        void setDrawRanges(const ArrayXb &clusters);
+
+        /// Clear the bound framebuffer (background color, depth and optionally linear depth and geometry buffers).
+        void clear(bool linear_depth, bool geometry);
+
+        /// Draw the index ranges of the clusters (with one draw call per range for the triangle ids of geometry buffers).
+        void drawRanges(bool geometry);
+
+        /// Test the candidate clusters (flags buffer) against the depth pyramid on the GPU and write the draw commands.
+        void testOcclusion(Buffer &commands);
+
+        /// Draw the clusters with indirect draw commands (one draw call per frustum-visible cluster for geometry buffers).
+        void drawIndirect(Buffer &commands, bool geometry);
+
+        /// Light colors for the current shader (and lighting configuration).
+        void lightColors(Vec4f &ambient, Vec4f &diffuse, Vec4f &specular) const;
+
         /// Set up the lighting for rendering.
         void setupLighting();
 
         /// Set up the material for rendering.
         void setupMaterial();
 
+        /// Set up the fixed-function rendering state (compatibility profile).
+        void beginDraw();
+
+        /// Restore the fixed-function rendering state (compatibility profile).
+        void endDraw();
+
+        /**
+         * @brief   Uniform locations of the core profile shaders.
+         * @author  Robert Maier
+         */
+        struct Uniforms
+        {
+            int projection = -1;
+            int modelview = -1;
+            int normal_matrix = -1;
+            int first_view = -1;
+            int first_face = -1;
+        };
+
+        /// Set up the core profile rendering state and matrix uniforms.
+        void beginDrawCore(Program &program, const Uniforms &uniforms);
+
+        /// Reset the core profile rendering state.
+        void endDrawCore(Program &program);
+
+        /// Create the vertex array object for the core profile (attribute arrays and index buffer).
+        void createVertexArray();
+
+        /// Look up the uniform locations and set the constant uniforms of a core profile shader.
+        void setupUniforms(Program &program, Uniforms &uniforms);
+
+        /// Create the shader for rendering batches of views (from the configured shader name).
+        bool createBatchShader();
+
+        /// Create the shader for rendering with geometry buffers (from the configured shader name).
+        bool createGeometryShader();
+
+        /// Name of the GLSL 3.30 shaders for a shader name ("color" for fixed-function shading, "depth" for depth-only rendering).
+        std::string coreShaderName(const std::string &shader_name) const;
+
         Config cfg_;
 
         size_t num_triangles_;
+        std::vector<LevelOfDetail> lods_;
+        size_t lod_;
+        Vec3f bbox_min_;
+        Vec3f bbox_max_;
+        std::vector<MeshUtil::Cluster> clusters_;
+        Eigen::Array<float, Eigen::Dynamic, 3> cluster_center_;
+        Eigen::Array<float, Eigen::Dynamic, 3> cluster_extent_;
+        Eigen::Array<float, Eigen::Dynamic, 3> cone_apex_;
+        Eigen::Array<float, Eigen::Dynamic, 3> cone_axis_;
+        Eigen::ArrayXf cone_cutoff_;
+        ArrayXb cluster_visible_;
+        bool culling_;
+        size_t num_visible_clusters_;
+        Mat4 clip_;
+        Vec4i viewport_;
+        double near_;
+        DepthPyramid depth_pyramid_;
+        bool has_prev_depth_;
+        int occlusion_supported_;   // (-1: not checked yet)
+        Program program_occlusion_;
+        Buffer buf_cluster_bounds_;
+        Buffer buf_cluster_ranges_;
+        Buffer buf_cluster_flags_;
+        Buffer buf_commands_;           // clusters passing the test against the previous frame's depth
+        Buffer buf_commands_retest_;    // rejected clusters passing the test against the current frame's depth
+        std::vector<GLuint> cluster_flags_;
+        std::vector<GLsizei> draw_counts_;
+        std::vector<const GLvoid*> draw_offsets_;
+        bool front_face_cw_;
+        bool has_normals_;
+        bool has_colors_;
         Buffer buf_verts_;
-        Buffer buf_colors_;
-        Buffer buf_normals_;
         Buffer buf_indices_;
         Program program_;
+        GLuint vao_;
+        Uniforms uniforms_;
+        Mat4f projection_;
+        Mat4f modelview_;
+        Mat3f normal_matrix_;
+        int batch_supported_;       // (-1: not checked yet)
+        Program program_batch_;
+        Uniforms uniforms_batch_;
+        Buffer buf_views_;
+        int geometry_supported_;    // (-1: not checked yet)
+        Program program_geometry_;
+        Uniforms uniforms_geometry_;
+        Buffer buf_face_ids_;
+        Texture tex_face_ids_;
     };
 
 } // namespace ogl
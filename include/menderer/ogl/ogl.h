@@ -35,8 +35,8 @@ namespace menderer
 namespace ogl
 {
 
-    /// Creates OpenGL context using GLFW
-    static inline bool createContext()
+    /// Creates OpenGL context using GLFW (optionally an OpenGL 3.3 core profile context)
+    static inline bool createContext(bool core_profile = false)
     {
         // create OpenGL context
 
@@ -48,6 +48,13 @@ namespace ogl
         }
         // create GLFW offscreen context
         glfwWindowHint(GLFW_VISIBLE, false);
+        if (core_profile)
+        {
+            glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+            glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+            glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+            glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+        }
         GLFWwindow* ogl_context = glfwCreateWindow(1, 1, "", nullptr, nullptr);
         if (!ogl_context)
         {
@@ -49,7 +49,8 @@ namespace ogl
         {
             VertexShader = 0,
             FragmentShader = 1,
-            GeometryShader = 2
+            GeometryShader = 2,
+            ComputeShader = 3
         };
 
 
@@ -59,8 +60,12 @@ namespace ogl
         /// Destructor.
         ~Program();
 
-        /// Create a program from files for vertex/fragment/geometry shader.
-        bool create(const std::string &vert_shader = "", const std::string &frag_shader = "", const std::string &geom_shader = "");
+        /// Create a program from files for vertex/fragment/geometry shader (with optional preprocessor definitions, e.g. "#define X\n").
+        bool create(const std::string &vert_shader = "", const std::string &frag_shader = "", const std::string &geom_shader = "",
+                    const std::string &defines = "");
+
+        /// Create a compute program from a compute shader file (with optional preprocessor definitions).
+        bool createCompute(const std::string &comp_shader, const std::string &defines = "");
 
         /// Checks if program is valid and shaders are set up correctly.
         bool valid() const;
@@ -107,6 +112,21 @@ namespace ogl
         /// Add 4x4 float matrix as uniform.
         void add(const std::string &name, const Mat4f &mat);
 
+        /// Add int scalar as uniform at a location (from uniformLoc).
+        void add(int location, int val);
+
+        /// Add 3x3 float matrix as uniform at a location (from uniformLoc).
+        void add(int location, const Mat3f &mat);
+
+        /// Add 4x4 float matrix as uniform at a location (from uniformLoc).
+        void add(int location, const Mat4f &mat);
+
+        /// Get uniform location (e.g. for looking it up once before rendering).
+        int uniformLoc(const std::string &name) const;
+
+        /// Assign a uniform block to a buffer binding point (see Buffer::bindBase).
+        bool bindUniformBlock(const std::string &name, unsigned int binding);
+
         /// Enable shader for rendering.
         void enable();
         /// Disable shader for rendering and unbind textures.
@@ -127,8 +147,6 @@ namespace ogl
         /// Check shader compilation status.
         bool checkShaderCompiled(GLuint id, const std::string& message) const;
 
-        /// Get uniform location.
-        int uniformLoc(const std::string &name) const;
 
         /// Compile program.
         bool compile();
@@ -139,9 +157,11 @@ namespace ogl
         unsigned int fragment_shader_id_;
         unsigned int vertex_shader_id_;
         unsigned int geometry_shader_id_;
+        unsigned int compute_shader_id_;
         bool valid_;
         std::vector<Texture*> textures_;
         std::string shader_folder_;
+        std::string defines_;
     };
 
 } // namespace ogl
@@ -0,0 +1,106 @@
+/**
+* This file is part of Menderer.
+*
+* Copyright 2019 Robert Maier, Technical University of Munich.
+* For more information see <https://github.com/robmaier/menderer>.
+*
+* Menderer is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* Menderer is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with Menderer. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <opencv2/core/core.hpp>
+#include <menderer/ogl/ogl.h>
+#include <menderer/ogl/buffer.h>
+#include <menderer/ogl/texture.h>
+
+
+namespace menderer
+{
+namespace ogl
+{
+
+    /**
+     * @brief   Ring of pixel pack buffers for asynchronous texture readbacks.
+     *          Pushing a frame starts copying its textures into the next buffer
+     *          of the ring and inserts a fence. Frames are popped in push order
+     *          once their fence is signaled, so that later frames are rendered
+     *          while earlier frames are read back.
+     * @author  Robert Maier
+     */
+    class ReadbackRing
+    {
+    public:
+
+        /**
+         * @brief   Constructor for creating a readback ring.
+         * @param   num_buffers     Number of pixel buffers (maximum number of frames in flight).
+         */
+        ReadbackRing(size_t num_buffers = 3);
+
+        /// Destructor.
+        ~ReadbackRing();
+
+        /// Start the readback of the textures of a frame (fails if the ring is full).
+        bool push(const std::vector<Texture*> &textures, size_t frame);
+
+        /**
+         * @brief   Retrieve the images of the oldest pending frame.
+         * @param   images  Downloaded images (one per texture of the frame).
+         * @param   frame   Frame id passed to push().
+         * @param   wait    Wait for the readback to complete (otherwise fails if it is still pending).
+         * @return  True if a frame was retrieved.
+         */
+        bool pop(std::vector<cv::Mat> &images, size_t &frame, bool wait);
+
+        /// Discard all pending frames.
+        void reset();
+
+        /// Returns the number of pending frames.
+        size_t size() const;
+
+        /// Checks if no frames are pending.
+        bool empty() const;
+
+        /// Checks if all pixel buffers hold pending frames.
+        bool full() const;
+
+    private:
+        ReadbackRing(const ReadbackRing&);
+        ReadbackRing& operator=(const ReadbackRing&);
+
+        /**
+         * @brief   Pixel buffer with the readback of one frame.
+         * @author  Robert Maier
+         */
+        struct Slot
+        {
+            Slot() : buffer(GL_PIXEL_PACK_BUFFER), fence(nullptr), frame(0) {}
+
+            Buffer buffer;
+            GLsync fence;
+            size_t frame;
+            std::vector<cv::Mat> images;
+            std::vector<size_t> offsets;    // byte offsets of the images within the buffer
+        };
+
+        std::vector<std::unique_ptr<Slot> > slots_;
+        size_t first_;
+        size_t count_;
+    };
+
+} // namespace ogl
+} // namespace menderer
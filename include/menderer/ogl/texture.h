@@ -32,6 +32,8 @@ namespace menderer
 namespace ogl
 {
 
+    class Buffer;
+
     /**
      * @brief   Wrapper class for OpenGL textures.
      * @author  Robert Maier
@@ -70,6 +72,30 @@ namespace ogl
         /// Create a one-channel depth texture on GPU.
         bool createDepth(int width, int height);
 
+        /// Create a one-channel 32 bit float texture on GPU.
+        bool createFloat(int width, int height);
+
+        /// Create a one-channel 32 bit float texture with mipmap levels on GPU (each level is written explicitly).
+        bool createFloatMipmap(int width, int height, int levels);
+
+        /// Create a three-channel 32 bit float texture on GPU (e.g. for vertex or normal maps).
+        bool createFloatRGB(int width, int height);
+
+        /// Create a one-channel 32 bit signed integer texture on GPU (e.g. for triangle ids).
+        bool createInt(int width, int height);
+
+        /// Create a buffer texture on GPU that accesses the data of a buffer (fetched with texelFetch in shaders).
+        bool createBuffer(const Buffer &buffer, int internal_format);
+
+        /// Create a three-channel BGR 2D array texture with multiple layers on GPU.
+        bool createBGRArray(Type type, int width, int height, int layers);
+
+        /// Create a one-channel depth 2D array texture with multiple layers on GPU.
+        bool createDepthArray(int width, int height, int layers);
+
+        /// Create a one-channel 32 bit float 2D array texture with multiple layers on GPU.
+        bool createFloatArray(int width, int height, int layers);
+
         /// Reset/clear the texture.
         void reset();
 
@@ -79,12 +105,24 @@ namespace ogl
         /// Unbind texture.
         void unbind();
 
+        /// Set linear or nearest-neighbor texture interpolation.
+        void setInterpolation(bool linear);
+
+        /// Restrict the mipmap levels accessible for sampling (e.g. while rendering into another level).
+        void setLevelRange(int base_level, int max_level);
+
         /// Upload an image from cv::Mat to texture on GPU.
         bool upload(const cv::Mat &img);
 
-        /// Download an image from the texture on GPU into cv::Mat.
+        /// Download an image from the texture on GPU into cv::Mat (array layers are stacked vertically).
         bool download(cv::Mat &img);
 
+        /// Download the texture into the bound pixel pack buffer at a byte offset (asynchronous readback).
+        bool downloadToPixelBuffer(size_t offset = 0);
+
+        /// Creates an output cv::Mat that is compatible with the texture format.
+        void createFromCurrent(cv::Mat &img) const;
+
         /// Returns the texture id.
         unsigned int id() const;
 
@@ -94,6 +132,15 @@ namespace ogl
         /// Returns the height of the texture.
         int height() const;
 
+        /// Returns the number of layers of the texture (1 for 2D textures).
+        int layers() const;
+
+        /// Returns the number of mipmap levels of the texture (1 without mipmaps).
+        int levels() const;
+
+        /// Checks if the texture is a 2D array texture.
+        bool isArray() const;
+
         /// Checks if texture is empty.
         bool empty() const;
 
@@ -108,7 +155,7 @@ namespace ogl
         Texture& operator=(const Texture&);
 
         /// Generates a texture and sets format and parameters.
-        bool init(Type type, int width, int height, int internalFormat, GLenum imageFormat);
+        bool init(Type type, int width, int height, int internalFormat, GLenum imageFormat, int layers = 0, int levels = 1);
 
         /// Generates a texture and sets format and parameters from cv::Mat type.
         bool init(const cv::Mat &img);
@@ -116,9 +163,6 @@ namespace ogl
         /// Upload data from raw pointer onto texture on GPU.
         bool upload(void* data);
 
-        /// Creates an output cv::Mat that is compatible with the texture format.
-        void createFromCurrent(cv::Mat &img) const;
-
         /// Retrieves texture format from cv::Mat.
         void getFormatFromOpenCV(const cv::Mat &img, int &internalFormat, GLenum &imageFormat) const;
         /// Retrieves data type from cv::Mat type.
@@ -136,6 +180,9 @@ namespace ogl
         GLenum image_type_;
         int width_;
         int height_;
+        int layers_;
+        int levels_;
+        GLenum target_;
         Type type_;
     };
 
@@ -0,0 +1,65 @@
+/**
+* This file is part of Menderer.
+*
+* Copyright 2019 Robert Maier, Technical University of Munich.
+* For more information see <https://github.com/robmaier/menderer>.
+*
+* Menderer is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* Menderer is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with Menderer. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <menderer/mat.h>
+#include <menderer/ogl/ogl.h>
+
+#include <algorithm>
+#include <cmath>
+
+
+namespace menderer
+{
+namespace ogl
+{
+
+    /**
+     * @brief   Interleaved vertex format for rendering: float position,
+     *          normal packed as signed normalized bytes and RGBA8 color
+     *          in a single 4 byte aligned 20 byte stride.
+     * @author  Robert Maier
+     */
+    struct Vertex
+    {
+    public:
+
+        GLfloat position[3];
+        GLbyte normal[4];
+        GLubyte color[4];
+
+        /// Pack a unit normal into signed normalized bytes.
+        /// (GL_INT_2_10_10_10_REV is not accepted by glNormalPointer on all drivers.)
+        static inline void packNormal(const Vec3f &n, GLbyte* packed)
+        {
+            for (int i = 0; i < 3; ++i)
+            {
+                float c = std::max(-1.0f, std::min(1.0f, n[i]));
+                if (std::isnan(c))
+                    c = 0.0f;
+                packed[i] = static_cast<GLbyte>(std::round(c * 127.0f));
+            }
+            packed[3] = 0;
+        }
+    };
+
+} // namespace ogl
+} // namespace menderer
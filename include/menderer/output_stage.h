@@ -0,0 +1,104 @@
+/**
+* This file is part of Menderer.
+*
+* Copyright 2019 Robert Maier, Technical University of Munich.
+* For more information see <https://github.com/robmaier/menderer>.
+*
+* Menderer is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* Menderer is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with Menderer. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace menderer
+{
+
+    /**
+     * @brief   Output stage that encodes and writes rendered frames in the background.
+     *          Jobs are passed through a bounded queue to a pool of worker threads, so
+     *          that the render thread keeps rendering while earlier frames are compressed
+     *          and written to disk. Submitting blocks while the maximum number of jobs is
+     *          pending (backpressure); completion is tracked in submission order.
+     * @author  Robert Maier
+     */
+    class OutputStage
+    {
+    public:
+
+        /// Job encoding and writing a frame (returns false if writing failed).
+        typedef std::function<bool()> Job;
+
+        /**
+         * @brief   Constructor for starting the worker threads.
+         * @param   num_threads     Number of worker threads (0: number of hardware threads).
+         * @param   max_pending     Maximum number of queued and running jobs
+         *                          (0: twice the number of worker threads).
+         */
+        OutputStage(size_t num_threads = 0, size_t max_pending = 0);
+
+        /// Destructor (waits for all pending jobs).
+        ~OutputStage();
+
+        /**
+         * @brief   Submits a job, blocks while the maximum number of jobs is pending.
+         * @param   job     Job to be executed by a worker thread (must not reference
+         *                  data that is modified before it has completed).
+         * @return  Sequence number of the job (counting from 0 in submission order).
+         */
+        size_t push(const Job &job);
+
+        /// Waits until the first num_jobs submitted jobs have completed.
+        void wait(size_t num_jobs);
+
+        /// Waits for all pending jobs and stops the worker threads, returns false if any job failed.
+        bool finish();
+
+        /// Returns the number of jobs completed in submission order (no earlier job pending).
+        size_t numCompleted() const;
+
+        /// Returns the number of failed jobs.
+        size_t numFailed() const;
+
+        /// Returns the maximum number of queued and running jobs.
+        size_t maxPending() const;
+
+    private:
+        OutputStage(const OutputStage&);
+        OutputStage& operator=(const OutputStage&);
+
+        /// Worker thread loop.
+        void work();
+
+        std::vector<std::thread> threads_;
+        size_t max_pending_;
+
+        mutable std::mutex mutex_;
+        std::condition_variable cv_job_;        // signaled when a job is queued or on stop
+        std::condition_variable cv_done_;       // signaled when a job has completed
+        std::deque<std::pair<size_t, Job> > queue_;
+        std::deque<bool> done_;                 // completion flags of jobs from num_completed_ on
+        size_t num_submitted_;
+        size_t num_completed_;
+        size_t num_failed_;
+        bool stop_;
+    };
+
+} // namespace menderer
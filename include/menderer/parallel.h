@@ -0,0 +1,55 @@
+/**
+* This file is part of Menderer.
+*
+* Copyright 2019 Robert Maier, Technical University of Munich.
+* For more information see <https://github.com/robmaier/menderer>.
+*
+* Menderer is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* Menderer is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with Menderer. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+
+namespace menderer
+{
+
+    /// Returns the number of threads used for parallel processing.
+    size_t numThreads();
+
+    /**
+     * @brief   Splits the index range [begin, end) into contiguous blocks
+     *          and processes the blocks in parallel.
+     * @param   begin       First index of the range.
+     * @param   end         End index of the range (exclusive).
+     * @param   func        Function called as func(block_begin, block_end)
+     *                      for each block.
+     * @param   num_blocks  Number of blocks (default: number of threads).
+     */
+    void parallelFor(size_t begin, size_t end,
+                     const std::function<void(size_t, size_t)> &func,
+                     size_t num_blocks = 0);
+
+    /**
+     * @brief   Replaces the values by their exclusive prefix sums (in parallel).
+     * @param   values      Values to be scanned in-place.
+     * @return  Total sum of all values.
+     */
+    template<typename T>
+    T parallelExclusiveScan(std::vector<T> &values);
+
+} // namespace menderer
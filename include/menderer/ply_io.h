@@ -22,7 +22,11 @@
 
 #include <menderer/mat.h>
 
+#include <array>
+#include <cstdint>
+#include <ostream>
 #include <string>
+#include <vector>
 #include <happly/happly.h>
 #include <menderer/mesh.h>
 
@@ -37,13 +41,119 @@ namespace menderer
     {
     public:
 
-        /// Load ply file using happly library.
+        /**
+         * @brief   Load ply file.
+         *          Binary triangle meshes are decoded natively from the
+         *          memory-mapped file, all other files are loaded using
+         *          the happly library.
+         */
         static bool load(const std::string &filename, Mesh &mesh);
 
-        /// Save mesh to ply file using happly library.
+        /**
+         * @brief   Save mesh to ply file.
+         *          Binary files are streamed directly from the mesh arrays,
+         *          ASCII files are written using the happly library.
+         */
         static bool save(const std::string &filename, const Mesh &mesh, bool format_binary = true);
 
+        /// Stream mesh arrays as binary ply data (in native byte order), e.g. into a memory buffer.
+        static bool save(std::ostream &out, const Mesh &mesh);
+
     private:
+        /// PLY property data types.
+        enum Type
+        {
+            Invalid = 0,
+            Int8,
+            UInt8,
+            Int16,
+            UInt16,
+            Int32,
+            UInt32,
+            Float32,
+            Float64
+        };
+
+        /// PLY file formats.
+        enum Format
+        {
+            Ascii = 0,
+            BinaryLittleEndian,
+            BinaryBigEndian
+        };
+
+        /// Scalar or list property of a PLY element.
+        struct Property
+        {
+            std::string name;
+            Type type;
+            Type count_type;    // Invalid for scalar properties
+        };
+
+        /// PLY element with its properties.
+        struct Element
+        {
+            std::string name;
+            size_t count;
+            std::vector<Property> properties;
+        };
+
+        /// Parsed PLY header.
+        struct Header
+        {
+            Format format;
+            std::vector<Element> elements;
+            size_t size;        // header size in bytes
+        };
+
+        /// Converts a PLY type name into the property data type.
+        static Type parseType(const std::string &name);
+
+        /// Returns the size in bytes of a property data type.
+        static size_t typeSize(Type type);
+
+        /// Read a single binary property value and convert it to the target type.
+        template<typename T>
+        static T readValue(const char* ptr, Type type, bool swap_bytes);
+
+        /// Parse the PLY header at the beginning of the file data.
+        static bool readHeader(const char* data, size_t size, Header &header);
+
+        /// Decode a binary PLY file directly into the mesh arrays.
+        static bool loadBinary(const char* data, size_t size, const Header &header, Mesh &mesh);
+
+        /// Parse an ASCII PLY file in parallel directly into the mesh arrays.
+        static bool loadAscii(const char* data, size_t size, const Header &header, Mesh &mesh);
+
+        /// Parse the ASCII records [first_record, first_record + num_records) of an element.
+        static bool parseAsciiRecords(const char* begin, const char* end, const Element &elem,
+                                      size_t first_record, size_t num_records, Mesh &mesh);
+
+        /// Compute the byte offsets of the given sorted line numbers in parallel.
+        static void findLineOffsets(const char* data, size_t size,
+                                    const std::vector<size_t> &lines, std::vector<size_t> &offsets);
+
+        /// Locale-independent parsing of the next ASCII token as a (typed) value.
+        static bool parseValue(const char* &ptr, const char* end, Type type, double &value);
+
+        /// Locale-independent parsing of the next ASCII token as a floating point number.
+        static bool parseReal(const char* &ptr, const char* end, bool single_precision, double &value);
+
+        /// Locale-independent parsing of the next ASCII token as an integer.
+        static bool parseInt(const char* &ptr, const char* end, int64_t &value);
+
+        /// Checks whether an integer can be represented by a property data type.
+        static bool isInRange(int64_t value, Type type);
+
+        /// Origin shift for georeferenced vertex coordinates (zero for small coordinates).
+        static Vec3 originShift(const Vec3 &first_vertex);
+
+        /// Stream mesh arrays into a binary ply file (in native byte order).
+        static bool saveBinary(const std::string &filename, const Mesh &mesh);
+
+        /// Load ply file using happly library.
+        static bool loadHapply(const std::string &filename, Mesh &mesh);
+
         /// Internal helper function for retrieving vertex normals from ply file.
         static std::vector<std::array<double, 3>> getVertexNormals(happly::PLYData& data);
     };
@@ -0,0 +1,121 @@
+/**
+* This file is part of Menderer.
+*
+* Copyright 2019 Robert Maier, Technical University of Munich.
+* For more information see <https://github.com/robmaier/menderer>.
+*
+* Menderer is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* Menderer is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with Menderer. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <functional>
+#include <vector>
+#include <menderer/mat.h>
+
+#include <opencv2/core/core.hpp>
+
+#include <menderer/frame_pool.h>
+#include <menderer/mesh.h>
+
+
+namespace menderer
+{
+
+    /**
+     * @brief   Interface of rendering backends that render a mesh into
+     *          color and metric depth images from camera poses.
+     * @author  Robert Maier
+     */
+    class Renderer
+    {
+    public:
+
+        /// Callback receiving a rendered frame (frame id, color image and metric depth map).
+        typedef std::function<void(size_t, const cv::Mat&, const cv::Mat&)> FrameCallback;
+
+        /// Destructor.
+        virtual ~Renderer() {}
+
+        /// Upload a mesh to the renderer.
+        virtual bool upload(const Mesh& mesh) = 0;
+
+        /// Upload mesh arrays (e.g. from a mesh cache) to the renderer.
+        virtual bool upload(const MeshView& mesh) = 0;
+
+        /**
+         * @brief   Renders the uploaded mesh into a synthetic color image and depth image
+         *          from a specified pose.
+         * @param   pose_world_to_cam   Target pose for rendering.
+         * @param   color_out   Rendered color image (BGR, 8 bit).
+         * @param   depth_out   Rendered metric depth map (NaN where no surface is visible).
+         */
+        virtual bool render(const Mat4& pose_world_to_cam, cv::Mat& color_out, cv::Mat &depth_out) = 0;
+
+        /**
+         * @brief   Renders the uploaded mesh into the preallocated images of a pooled frame,
+         *          which are reused without allocations if size and type match.
+         * @param   pose_world_to_cam   Target pose for rendering.
+         * @param   frame       Output frame from a frame pool.
+         */
+        virtual bool render(const Mat4& pose_world_to_cam, FramePool::Frame &frame)
+        {
+            return render(pose_world_to_cam, frame.color, frame.depth);
+        }
+
+        /**
+         * @brief   Renders the uploaded mesh from a batch of poses. Backends that cannot
+         *          render multiple poses at once render them one after another.
+         * @param   poses_world_to_cam  Target poses for rendering.
+         * @param   colors_out  Rendered color images (one per pose).
+         * @param   depths_out  Rendered metric depth maps (one per pose).
+         */
+        virtual bool renderBatch(const std::vector<Mat4>& poses_world_to_cam,
+                                 std::vector<cv::Mat>& colors_out, std::vector<cv::Mat> &depths_out)
+        {
+            colors_out.resize(poses_world_to_cam.size());
+            depths_out.resize(poses_world_to_cam.size());
+            for (size_t i = 0; i < poses_world_to_cam.size(); ++i)
+            {
+                if (!render(poses_world_to_cam[i], colors_out[i], depths_out[i]))
+                    return false;
+            }
+            return true;
+        }
+
+        /**
+         * @brief   Renders the uploaded mesh from a pose and passes completed frames on in
+         *          submission order. Backends with pipelined readback return before the
+         *          frame is completed, others pass it on immediately.
+         * @param   pose_world_to_cam   Target pose for rendering.
+         * @param   frame       Frame id passed to the callback.
+         * @param   callback    Callback receiving the completed frames.
+         */
+        virtual bool renderAsync(const Mat4& pose_world_to_cam, size_t frame, const FrameCallback &callback)
+        {
+            cv::Mat color, depth;
+            if (!render(pose_world_to_cam, color, depth))
+                return false;
+            callback(frame, color, depth);
+            return true;
+        }
+
+        /// Wait for all frames submitted with renderAsync() and pass them on to the callback.
+        virtual bool flush(const FrameCallback &/*callback*/)
+        {
+            return true;
+        }
+    };
+
+} // namespace menderer
@@ -28,8 +28,11 @@
 
 #include <menderer/camera.h>
 #include <menderer/mesh.h>
+#include <menderer/renderer.h>
 #include <menderer/ogl/framebuffer.h>
 #include <menderer/ogl/mesh_renderer.h>
+#include <menderer/ogl/readback_ring.h>
+#include <menderer/ogl/render_context.h>
 #include <menderer/ogl/texture.h>
 
 
@@ -40,10 +43,23 @@ namespace menderer
      * @brief   Scene for OpenGL rendering.
      * @author  Robert Maier
      */
-    class Scene
+    class Scene : public Renderer
     {
     public:
 
+        /**
+         * @brief   Geometry buffers rendered in the same pass as color and depth
+         *          (in camera coordinates, zero/-1 where there is no surface).
+         * @author  Robert Maier
+         */
+        struct GeometryBuffers
+        {
+            cv::Mat vertex_map;     // camera space vertices (CV_32FC3)
+            cv::Mat normal_map;     // camera space normals (CV_32FC3)
+            cv::Mat face_ids;       // triangle indices of the input mesh (CV_32SC1)
+            cv::Mat barycentrics;   // barycentric coordinates within the triangle (CV_32FC3)
+        };
+
         /**
          * @brief   Constructor for creating a scene for rendering.
          * @param   camera          Pinhole camera model.
@@ -52,26 +68,103 @@ namespace menderer
         Scene(const Camera& camera, const ogl::MeshRenderer::Config &renderer_cfg);
 
         /// Destructor.
-        ~Scene();
+        virtual ~Scene();
 
         /// Upload a mesh on the GPU.
-        bool upload(const Mesh& mesh);
+        virtual bool upload(const Mesh& mesh);
+
+        /// Upload mesh arrays (e.g. from a mesh cache) on the GPU.
+        virtual bool upload(const MeshView& mesh);
 
         /**
          * @brief   Renders the uploaded mesh into a synthetic color image and depth image
          *          from a specified pose.
          * @param   pose_world_to_cam   Target pose for rendering.
          * @param   color_out   Rendered color image.
-         * @param   depth_out   Rendered depth map (from depth buffer).
+         * @param   depth_out   Rendered metric depth map (written by the shader, or
+         *                      converted from the depth buffer for fixed-function rendering).
+         */
+        virtual bool render(const Mat4& pose_world_to_cam, cv::Mat& color_out, cv::Mat &depth_out);
+
+        /**
+         * @brief   Renders the uploaded mesh into the preallocated images of a pooled frame
+         *          (downloaded without allocations, the frame size must match the camera).
+         * @param   pose_world_to_cam   Target pose for rendering.
+         * @param   frame       Output frame from a frame pool.
+         */
+        virtual bool render(const Mat4& pose_world_to_cam, FramePool::Frame &frame);
+
+        /// Checks if geometry buffers are rendered (enabled and supported by the OpenGL context).
+        bool writesGeometryBuffers() const;
+
+        /**
+         * @brief   Renders the uploaded mesh into color, depth and geometry buffers with a
+         *          single draw into multiple render targets (requires the renderer option
+         *          geometry_buffers, triangle ids refer to the input mesh so levels of detail
+         *          are not used).
+         * @param   pose_world_to_cam   Target pose for rendering.
+         * @param   color_out   Rendered color image.
+         * @param   depth_out   Rendered metric depth map.
+         * @param   geometry_out    Rendered vertex and normal maps, triangle ids and barycentrics.
+         */
+        bool render(const Mat4& pose_world_to_cam, cv::Mat& color_out, cv::Mat &depth_out, GeometryBuffers &geometry_out);
+
+        /**
+         * @brief   Renders the uploaded mesh from a batch of poses in one pass into the layers
+         *          of 2D array textures (instanced drawing, one layer per pose), which are
+         *          downloaded with a single readback. Falls back to rendering the poses one
+         *          after another if layered rendering is not supported or for a single pose.
+         *          Culling and levels of detail apply to single poses only.
+         * @param   poses_world_to_cam  Target poses for rendering.
+         * @param   colors_out  Rendered color images (one per pose).
+         * @param   depths_out  Rendered depth maps (one per pose).
          */
-        bool render(const Mat4& pose_world_to_cam, cv::Mat& color_out, cv::Mat &depth_out);
+        virtual bool renderBatch(const std::vector<Mat4>& poses_world_to_cam,
+                                 std::vector<cv::Mat>& colors_out, std::vector<cv::Mat> &depths_out);
+
+        /**
+         * @brief   Renders the uploaded mesh from a pose and starts an asynchronous readback
+         *          into a ring of pixel buffers, so that the next frame is rendered while this
+         *          frame is read back. Frames are passed on in submission order once their
+         *          readback is completed (waiting only if all pixel buffers are in flight).
+         * @param   pose_world_to_cam   Target pose for rendering.
+         * @param   frame       Frame id passed to the callback.
+         * @param   callback    Callback receiving the completed frames.
+         */
+        virtual bool renderAsync(const Mat4& pose_world_to_cam, size_t frame, const FrameCallback &callback);
+
+        /// Wait for all pending readbacks and pass the frames on to the callback.
+        virtual bool flush(const FrameCallback &callback);
 
     private:
+        Scene(const Scene&);
+        Scene& operator=(const Scene&);
+
+        /// Set up the render context (projection and model view matrix) for a pose.
+        void setupRenderContext(const Mat4& pose_world_to_cam, ogl::RenderContext &render_ctx) const;
+
+        /// Render the mesh from a pose into the framebuffer textures.
+        void draw(const Mat4& pose_world_to_cam, ogl::RenderContext &render_ctx);
+
+        /// Pass the oldest pending frame of the readback ring on to the callback.
+        bool completeFrame(bool wait, const FrameCallback &callback);
+
         Camera camera_;
         ogl::Texture tex_color_;
         ogl::Texture tex_depth_;
+        ogl::Texture tex_linear_depth_;     // metric depth written by the shader (if any)
+        ogl::Texture tex_vertex_map_;       // geometry buffers (if enabled)
+        ogl::Texture tex_normal_map_;
+        ogl::Texture tex_face_ids_;
+        ogl::Texture tex_barycentrics_;
         ogl::Framebuffer fb_;
+        ogl::Texture tex_color_batch_;
+        ogl::Texture tex_depth_batch_;
+        ogl::Texture tex_linear_depth_batch_;
+        ogl::Framebuffer fb_batch_;
+        ogl::ReadbackRing readback_;
         ogl::MeshRenderer mesh_renderer_;
+        Vec3 origin_;
     };
 
 } // namespace menderer
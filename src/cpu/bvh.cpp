@@ -0,0 +1,422 @@
+/**
+* This file is part of Menderer.
+*
+* Copyright 2019 Robert Maier, Technical University of Munich.
+* For more information see <https://github.com/robmaier/menderer>.
+*
+* Menderer is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* Menderer is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with Menderer. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <menderer/cpu/bvh.h>
+
+#include <algorithm>
+#include <limits>
+
+#include <menderer/parallel.h>
+
+// depth below which nodes are split at the median
+// (bounds the traversal stack to BVH_SAH_MAX_DEPTH + 32 entries)
+#define BVH_SAH_MAX_DEPTH 64
+#define BVH_STACK_SIZE (BVH_SAH_MAX_DEPTH + 64)
+
+
+namespace menderer
+{
+namespace cpu
+{
+
+    /// Triangle bounds and centroids for building the BVH.
+    struct BVH::BuildData
+    {
+        std::vector<Vec3f> bbox_min;
+        std::vector<Vec3f> bbox_max;
+        std::vector<Vec3f> centroids;
+        std::vector<unsigned int> faces;
+    };
+
+
+    BVH::BVH() :
+        max_leaf_size_(4)
+    {
+    }
+
+
+    BVH::~BVH()
+    {
+    }
+
+
+    void BVH::build(const MeshView &mesh, size_t max_leaf_size)
+    {
+        clear();
+        const size_t num_faces = mesh.num_faces;
+        if (num_faces == 0)
+            return;
+        max_leaf_size_ = std::min(std::max(max_leaf_size, static_cast<size_t>(1)), static_cast<size_t>(255));
+
+        // triangle bounds and centroids
+        BuildData data;
+        data.bbox_min.resize(num_faces);
+        data.bbox_max.resize(num_faces);
+        data.centroids.resize(num_faces);
+        data.faces.resize(num_faces);
+        parallelFor(0, num_faces, [&](size_t i0, size_t i1)
+        {
+            for (size_t i = i0; i < i1; ++i)
+            {
+                const Vec3ui &f = mesh.face_vertices[i];
+                const Vec3f &v0 = mesh.vertices[f[0]];
+                const Vec3f &v1 = mesh.vertices[f[1]];
+                const Vec3f &v2 = mesh.vertices[f[2]];
+                data.bbox_min[i] = v0.cwiseMin(v1).cwiseMin(v2);
+                data.bbox_max[i] = v0.cwiseMax(v1).cwiseMax(v2);
+                data.centroids[i] = (data.bbox_min[i] + data.bbox_max[i]) * 0.5f;
+                data.faces[i] = static_cast<unsigned int>(i);
+            }
+        });
+
+        // split the top levels sequentially into subtrees
+        struct Task
+        {
+            size_t node;
+            size_t begin;
+            size_t end;
+            size_t depth;
+        };
+        const size_t task_size = std::max(num_faces / (numThreads() * 8), static_cast<size_t>(4096));
+        std::vector<Task> pending(1, Task{0, 0, num_faces, 0});
+        std::vector<Task> tasks;
+        nodes_.resize(1);
+        while (!pending.empty())
+        {
+            const Task task = pending.back();
+            pending.pop_back();
+            if (task.end - task.begin <= task_size)
+            {
+                tasks.push_back(task);
+                continue;
+            }
+            Node node;
+            size_t mid;
+            if (splitNode(data, task.begin, task.end, task.depth, node, mid))
+            {
+                node.offset = static_cast<unsigned int>(nodes_.size());
+                nodes_.resize(nodes_.size() + 2);
+                pending.push_back(Task{node.offset, task.begin, mid, task.depth + 1});
+                pending.push_back(Task{node.offset + 1u, mid, task.end, task.depth + 1});
+            }
+            nodes_[task.node] = node;
+        }
+
+        // build subtrees in parallel
+        std::vector<std::vector<Node> > subtrees(tasks.size());
+        parallelFor(0, tasks.size(), [&](size_t t0, size_t t1)
+        {
+            for (size_t t = t0; t < t1; ++t)
+                buildSubtree(data, subtrees[t], tasks[t].begin, tasks[t].end, tasks[t].depth);
+        }, tasks.size());
+
+        // append subtrees (local node i > 0 is stored at base + i - 1)
+        for (size_t t = 0; t < tasks.size(); ++t)
+        {
+            const unsigned int base = static_cast<unsigned int>(nodes_.size());
+            std::vector<Node> &subtree = subtrees[t];
+            for (size_t i = 0; i < subtree.size(); ++i)
+            {
+                Node node = subtree[i];
+                if (node.count == 0)
+                    node.offset = node.offset - 1 + base;
+                if (i == 0)
+                    nodes_[tasks[t].node] = node;
+                else
+                    nodes_.push_back(node);
+            }
+        }
+
+        // store triangles in leaf order
+        triangles_.resize(num_faces);
+        parallelFor(0, num_faces, [&](size_t i0, size_t i1)
+        {
+            for (size_t i = i0; i < i1; ++i)
+            {
+                const unsigned int face = data.faces[i];
+                const Vec3ui &f = mesh.face_vertices[face];
+                Triangle &tri = triangles_[i];
+                tri.v0 = mesh.vertices[f[0]];
+                tri.e1 = mesh.vertices[f[1]] - tri.v0;
+                tri.e2 = mesh.vertices[f[2]] - tri.v0;
+                tri.face = face;
+            }
+        });
+    }
+
+
+    bool BVH::splitNode(BuildData &data, size_t begin, size_t end, size_t depth, Node &node, size_t &mid) const
+    {
+        const int num_bins = 16;
+        const size_t n = end - begin;
+
+        // node bounds and centroid bounds
+        Vec3f c_min = Vec3f::Constant(std::numeric_limits<float>::max());
+        Vec3f c_max = Vec3f::Constant(-std::numeric_limits<float>::max());
+        node.bbox_min = c_min;
+        node.bbox_max = c_max;
+        for (size_t i = begin; i < end; ++i)
+        {
+            const unsigned int f = data.faces[i];
+            node.bbox_min = node.bbox_min.cwiseMin(data.bbox_min[f]);
+            node.bbox_max = node.bbox_max.cwiseMax(data.bbox_max[f]);
+            c_min = c_min.cwiseMin(data.centroids[f]);
+            c_max = c_max.cwiseMax(data.centroids[f]);
+        }
+        node.offset = static_cast<unsigned int>(begin);
+        node.count = static_cast<unsigned short>(std::min(n, max_leaf_size_));
+        node.axis = 0;
+        if (n <= 1)
+            return false;
+
+        // evaluate surface area heuristic on bins along all axes
+        auto area = [](const Vec3f &e) { return e[0] * e[1] + e[1] * e[2] + e[2] * e[0]; };
+        const Vec3f extent = c_max - c_min;
+        float best_cost = std::numeric_limits<float>::max();
+        int best_axis = -1;
+        int best_bin = 0;
+        for (int axis = 0; axis < 3 && depth < BVH_SAH_MAX_DEPTH; ++axis)
+        {
+            if (extent[axis] <= 0.0f)
+                continue;
+            const float scale = num_bins * (1.0f - 1e-5f) / extent[axis];
+            size_t bin_count[num_bins] = {0};
+            Vec3f bin_min[num_bins];
+            Vec3f bin_max[num_bins];
+            for (int b = 0; b < num_bins; ++b)
+            {
+                bin_min[b] = Vec3f::Constant(std::numeric_limits<float>::max());
+                bin_max[b] = Vec3f::Constant(-std::numeric_limits<float>::max());
+            }
+            for (size_t i = begin; i < end; ++i)
+            {
+                const unsigned int f = data.faces[i];
+                const int b = std::min(static_cast<int>((data.centroids[f][axis] - c_min[axis]) * scale), num_bins - 1);
+                ++bin_count[b];
+                bin_min[b] = bin_min[b].cwiseMin(data.bbox_min[f]);
+                bin_max[b] = bin_max[b].cwiseMax(data.bbox_max[f]);
+            }
+
+            // sweep from the right to accumulate the right side costs
+            float right_cost[num_bins];
+            Vec3f r_min = Vec3f::Constant(std::numeric_limits<float>::max());
+            Vec3f r_max = Vec3f::Constant(-std::numeric_limits<float>::max());
+            size_t r_count = 0;
+            for (int b = num_bins - 1; b > 0; --b)
+            {
+                r_count += bin_count[b];
+                r_min = r_min.cwiseMin(bin_min[b]);
+                r_max = r_max.cwiseMax(bin_max[b]);
+                right_cost[b] = r_count > 0 ? area(r_max - r_min) * static_cast<float>(r_count) : 0.0f;
+            }
+            // sweep from the left and evaluate splits after bin b
+            Vec3f l_min = Vec3f::Constant(std::numeric_limits<float>::max());
+            Vec3f l_max = Vec3f::Constant(-std::numeric_limits<float>::max());
+            size_t l_count = 0;
+            for (int b = 0; b < num_bins - 1; ++b)
+            {
+                l_count += bin_count[b];
+                l_min = l_min.cwiseMin(bin_min[b]);
+                l_max = l_max.cwiseMax(bin_max[b]);
+                if (l_count == 0 || l_count == n)
+                    continue;
+                const float cost = area(l_max - l_min) * static_cast<float>(l_count) + right_cost[b + 1];
+                if (cost < best_cost)
+                {
+                    best_cost = cost;
+                    best_axis = axis;
+                    best_bin = b;
+                }
+            }
+        }
+
+        // leaf if splitting is not cheaper than intersecting all triangles
+        const float node_area = area(node.bbox_max - node.bbox_min);
+        const float leaf_cost = node_area * static_cast<float>(n);
+        if (n <= max_leaf_size_ && (best_axis < 0 || node_area + best_cost >= leaf_cost))
+            return false;
+
+        if (best_axis >= 0)
+        {
+            // partition triangles at the best bin boundary
+            const float scale = num_bins * (1.0f - 1e-5f) / extent[best_axis];
+            const float c0 = c_min[best_axis];
+            unsigned int* split = std::partition(data.faces.data() + begin, data.faces.data() + end,
+                                                 [&](unsigned int f)
+            {
+                return std::min(static_cast<int>((data.centroids[f][best_axis] - c0) * scale), num_bins - 1) <= best_bin;
+            });
+            mid = static_cast<size_t>(split - data.faces.data());
+            node.axis = static_cast<unsigned short>(best_axis);
+        }
+        else
+        {
+            // coincident centroids or maximum depth: split at the median of the largest extent
+            int axis = 0;
+            extent.maxCoeff(&axis);
+            mid = begin + n / 2;
+            std::nth_element(data.faces.data() + begin, data.faces.data() + mid, data.faces.data() + end,
+                             [&](unsigned int f0, unsigned int f1)
+            {
+                return data.centroids[f0][axis] < data.centroids[f1][axis];
+            });
+            node.axis = static_cast<unsigned short>(axis);
+        }
+        node.count = 0;
+        return true;
+    }
+
+
+    void BVH::buildSubtree(BuildData &data, std::vector<Node> &nodes, size_t begin, size_t end, size_t depth) const
+    {
+        struct Range
+        {
+            size_t node;
+            size_t begin;
+            size_t end;
+            size_t depth;
+        };
+        nodes.assign(1, Node());
+        std::vector<Range> stack(1, Range{0, begin, end, depth});
+        while (!stack.empty())
+        {
+            const Range range = stack.back();
+            stack.pop_back();
+            Node node;
+            size_t mid;
+            if (splitNode(data, range.begin, range.end, range.depth, node, mid))
+            {
+                node.offset = static_cast<unsigned int>(nodes.size());
+                nodes.resize(nodes.size() + 2);
+                stack.push_back(Range{node.offset, range.begin, mid, range.depth + 1});
+                stack.push_back(Range{node.offset + 1u, mid, range.end, range.depth + 1});
+            }
+            nodes[range.node] = node;
+        }
+    }
+
+
+    void BVH::clear()
+    {
+        nodes_.clear();
+        triangles_.clear();
+    }
+
+
+    bool BVH::empty() const
+    {
+        return nodes_.empty();
+    }
+
+
+    size_t BVH::numNodes() const
+    {
+        return nodes_.size();
+    }
+
+
+    void BVH::intersect(const RayPacket &rays, HitPacket &hits, bool cull_backfaces) const
+    {
+        hits.t = rays.t_max;
+        hits.u.setZero();
+        hits.v.setZero();
+        hits.face.setConstant(-1);
+        if (nodes_.empty())
+            return;
+
+        // inverse ray directions (avoiding divisions by zero)
+        const float eps = 1e-20f;
+        const PacketF dir_x = (rays.dir_x.abs() < eps).select(PacketF::Constant(eps), rays.dir_x);
+        const PacketF dir_y = (rays.dir_y.abs() < eps).select(PacketF::Constant(eps), rays.dir_y);
+        const PacketF dir_z = (rays.dir_z.abs() < eps).select(PacketF::Constant(eps), rays.dir_z);
+        const PacketF inv_x = dir_x.inverse();
+        const PacketF inv_y = dir_y.inverse();
+        const PacketF inv_z = dir_z.inverse();
+        const PacketF org_x = PacketF::Constant(rays.origin[0]);
+        const PacketF org_y = PacketF::Constant(rays.origin[1]);
+        const PacketF org_z = PacketF::Constant(rays.origin[2]);
+        const Vec3f dir_first(rays.dir_x[0], rays.dir_y[0], rays.dir_z[0]);
+
+        unsigned int stack[BVH_STACK_SIZE];
+        int stack_size = 0;
+        stack[stack_size++] = 0;
+        while (stack_size > 0)
+        {
+            const Node &node = nodes_[stack[--stack_size]];
+
+            // slab test of the node bounds for all rays
+            const PacketF tx0 = (node.bbox_min[0] - org_x) * inv_x;
+            const PacketF tx1 = (node.bbox_max[0] - org_x) * inv_x;
+            const PacketF ty0 = (node.bbox_min[1] - org_y) * inv_y;
+            const PacketF ty1 = (node.bbox_max[1] - org_y) * inv_y;
+            const PacketF tz0 = (node.bbox_min[2] - org_z) * inv_z;
+            const PacketF tz1 = (node.bbox_max[2] - org_z) * inv_z;
+            const PacketF t_near = tx0.min(tx1).max(ty0.min(ty1)).max(tz0.min(tz1)).max(rays.t_min);
+            const PacketF t_far = tx0.max(tx1).min(ty0.max(ty1)).min(tz0.max(tz1)).min(hits.t);
+            if (!(t_near <= t_far).any())
+                continue;
+
+            if (node.count > 0)
+            {
+                // intersect leaf triangles (Moeller-Trumbore), sharing terms of the common origin
+                for (unsigned int i = node.offset; i < node.offset + node.count; ++i)
+                {
+                    const Triangle &tri = triangles_[i];
+                    const Vec3f tvec = rays.origin - tri.v0;
+                    const Vec3f qvec = tvec.cross(tri.e1);
+                    const PacketF p_x = rays.dir_y * tri.e2[2] - rays.dir_z * tri.e2[1];
+                    const PacketF p_y = rays.dir_z * tri.e2[0] - rays.dir_x * tri.e2[2];
+                    const PacketF p_z = rays.dir_x * tri.e2[1] - rays.dir_y * tri.e2[0];
+                    const PacketF det = p_x * tri.e1[0] + p_y * tri.e1[1] + p_z * tri.e1[2];
+                    const PacketF inv_det = det.inverse();
+                    const PacketF u = (p_x * tvec[0] + p_y * tvec[1] + p_z * tvec[2]) * inv_det;
+                    const PacketF v = (rays.dir_x * qvec[0] + rays.dir_y * qvec[1] + rays.dir_z * qvec[2]) * inv_det;
+                    const PacketF t = inv_det * tri.e2.dot(qvec);
+                    // (det > 0: ray hits the counter-clockwise front face)
+                    const auto valid_det = cull_backfaces ? (det > 0.0f).eval() : (det != 0.0f).eval();
+                    const auto hit = (valid_det && u >= 0.0f && v >= 0.0f && (u + v) <= 1.0f &&
+                                      t >= rays.t_min && t < hits.t).eval();
+                    if (!hit.any())
+                        continue;
+                    hits.t = hit.select(t, hits.t);
+                    hits.u = hit.select(u, hits.u);
+                    hits.v = hit.select(v, hits.v);
+                    hits.face = hit.select(PacketI::Constant(static_cast<int>(tri.face)), hits.face);
+                }
+            }
+            else
+            {
+                // visit the child closer along the split axis first
+                if (dir_first[node.axis] < 0.0f)
+                {
+                    stack[stack_size++] = node.offset;
+                    stack[stack_size++] = node.offset + 1;
+                }
+                else
+                {
+                    stack[stack_size++] = node.offset + 1;
+                    stack[stack_size++] = node.offset;
+                }
+            }
+        }
+    }
+
+} // namespace cpu
+} // namespace menderer
@@ -0,0 +1,356 @@
+/**
+* This file is part of Menderer.
+*
+* Copyright 2019 Robert Maier, Technical University of Munich.
+* For more information see <https://github.com/robmaier/menderer>.
+*
+* Menderer is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* Menderer is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with Menderer. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <menderer/cpu/raster_scene.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <menderer/parallel.h>
+#include <menderer/ogl/render_context.h>
+
+
+namespace menderer
+{
+namespace cpu
+{
+
+    RasterScene::RasterScene(const Camera& camera, const ogl::MeshRenderer::Config &renderer_cfg) :
+        camera_(camera),
+        cfg_(renderer_cfg),
+        mesh_(),
+        shading_(renderer_cfg),
+        near_(0.0),
+        far_(0.0),
+        num_bin_blocks_(0),
+        tiles_x_(0),
+        tiles_y_(0)
+    {
+        // same clip planes as the OpenGL renderer
+        ogl::RenderContext render_ctx;
+        near_ = render_ctx.near();
+        far_ = render_ctx.far();
+    }
+
+
+    RasterScene::~RasterScene()
+    {
+    }
+
+
+    bool RasterScene::upload(const Mesh& mesh)
+    {
+        return upload(mesh.view());
+    }
+
+
+    bool RasterScene::upload(const MeshView& mesh)
+    {
+        // copy mesh arrays (the view may not outlive the upload)
+        mesh_.clear();
+        mesh_.origin = mesh.origin;
+        mesh_.vertices.assign(mesh.vertices, mesh.vertices + mesh.num_vertices);
+        mesh_.normals.assign(mesh.normals, mesh.normals + mesh.num_normals);
+        mesh_.colors.assign(mesh.colors, mesh.colors + mesh.num_colors);
+        mesh_.face_vertices.assign(mesh.face_vertices, mesh.face_vertices + mesh.num_faces);
+        shading_.setMesh(&mesh_);
+        return true;
+    }
+
+
+    bool RasterScene::setupTriangle(unsigned int face, TriangleSetup &tri) const
+    {
+        const Vec3ui &f = mesh_.face_vertices[face];
+        const Vec3f &p0 = vertices_cam_[f[0]];
+        const Vec3f &p1 = vertices_cam_[f[1]];
+        const Vec3f &p2 = vertices_cam_[f[2]];
+        const float near = static_cast<float>(near_);
+        const float far = static_cast<float>(far_);
+
+        // cull triangles entirely in front of the near plane or behind the far plane
+        const float z_min = std::min(p0[2], std::min(p1[2], p2[2]));
+        const float z_max = std::max(p0[2], std::max(p1[2], p2[2]));
+        if (z_max < near || z_min > far)
+            return false;
+
+        // homogeneous edge functions: the rows of the inverse of [p0 p1 p2]
+        // (shared edges get exactly negated coefficients, i.e. no cracks)
+        const Vec3f n[3] = { p1.cross(p2), p2.cross(p0), p0.cross(p1) };
+        // triangle plane from the edges (more accurate than the sum of the edge functions)
+        const Vec3f normal = (p1 - p0).cross(p2 - p0);
+        const float det = p0.dot(normal);
+        if (!(std::abs(det) > 0.0f))
+            return false;
+        // counter-clockwise triangles facing the camera have det < 0
+        if (cfg_.cull_backfaces && det > 0.0f)
+            return false;
+
+        // edge functions and inverse depth in pixel coordinates,
+        // with edge functions oriented to be positive inside
+        const Mat3 K = camera_.intrinsics();
+        const float fx_inv = static_cast<float>(1.0 / K(0, 0));
+        const float fy_inv = static_cast<float>(1.0 / K(1, 1));
+        const float ox = static_cast<float>((0.5 - K(0, 2)) / K(0, 0));
+        const float oy = static_cast<float>((0.5 - K(1, 2)) / K(1, 1));
+        const float s = det < 0.0f ? -1.0f : 1.0f;
+        for (int i = 0; i < 3; ++i)
+        {
+            const Vec3f e = s * n[i];
+            tri.a[i] = e[0] * fx_inv;
+            tri.b[i] = e[1] * fy_inv;
+            tri.c[i] = e[0] * ox + e[1] * oy + e[2];
+        }
+        const Vec3f plane = normal / det;
+        tri.inv_depth[0] = plane[0] * fx_inv;
+        tri.inv_depth[1] = plane[1] * fy_inv;
+        tri.inv_depth[2] = plane[0] * ox + plane[1] * oy + plane[2];
+
+        // bounding box of covered pixel centers, from the triangle clipped at the near plane
+        // (the rasterization itself is homogeneous and needs no clipping)
+        const Vec3f* pts[3] = { &p0, &p1, &p2 };
+        float u_min = std::numeric_limits<float>::max();
+        float v_min = std::numeric_limits<float>::max();
+        float u_max = -u_min;
+        float v_max = -v_min;
+        for (int i = 0; i < 3; ++i)
+        {
+            const Vec3f &pa = *pts[i];
+            const Vec3f &pb = *pts[(i + 1) % 3];
+            Vec3f clipped[2];
+            int num_clipped = 0;
+            if (pa[2] >= near)
+                clipped[num_clipped++] = pa;
+            if ((pa[2] >= near) != (pb[2] >= near))
+                clipped[num_clipped++] = pa + (pb - pa) * ((near - pa[2]) / (pb[2] - pa[2]));
+            for (int k = 0; k < num_clipped; ++k)
+            {
+                const Vec3f &p = clipped[k];
+                const float u = static_cast<float>(K(0, 0) * p[0] / p[2] + K(0, 2));
+                const float v = static_cast<float>(K(1, 1) * p[1] / p[2] + K(1, 2));
+                u_min = std::min(u_min, u);
+                u_max = std::max(u_max, u);
+                v_min = std::min(v_min, v);
+                v_max = std::max(v_max, v);
+            }
+        }
+        // pixel x covers the center x + 0.5
+        // (both bounds are clamped to [-1, size] in float before the conversion to avoid integer
+        // overflow for triangles far outside the image; NaN is clamped to the lower bound)
+        const float w = static_cast<float>(camera_.width());
+        const float h = static_cast<float>(camera_.height());
+        auto clamp = [](float x, float lo, float hi) { return x > lo ? (x < hi ? x : hi) : lo; };
+        tri.x_min = std::max(static_cast<int>(std::ceil(clamp(u_min - 0.5f, -1.0f, w))), 0);
+        tri.y_min = std::max(static_cast<int>(std::ceil(clamp(v_min - 0.5f, -1.0f, h))), 0);
+        tri.x_max = std::min(static_cast<int>(std::floor(clamp(u_max - 0.5f, -1.0f, w))), camera_.width() - 1);
+        tri.y_max = std::min(static_cast<int>(std::floor(clamp(v_max - 0.5f, -1.0f, h))), camera_.height() - 1);
+        // small triangles may not cover any pixel center, triangles outside the image cover none
+        return tri.x_min <= tri.x_max && tri.y_min <= tri.y_max;
+    }
+
+
+    void RasterScene::rasterizeTile(int tile_x, int tile_y, cv::Mat& color_out, cv::Mat &depth_out) const
+    {
+        typedef Eigen::Array<int, PacketSize, 1> PacketI;
+        typedef Eigen::Array<bool, PacketSize, 1> PacketB;
+        // rows are padded to load and store full packets at the tile border
+        const int stride = TileSize + PacketSize;
+        float depth[TileSize * stride];
+        int faces[TileSize * stride];
+        std::fill(depth, depth + TileSize * stride, std::numeric_limits<float>::infinity());
+        std::fill(faces, faces + TileSize * stride, -1);
+
+        const int x0 = tile_x * TileSize;
+        const int y0 = tile_y * TileSize;
+        const int x1 = std::min(x0 + TileSize, camera_.width()) - 1;
+        const int y1 = std::min(y0 + TileSize, camera_.height()) - 1;
+        const float near = static_cast<float>(near_);
+        const float far = static_cast<float>(far_);
+        PacketF lanes;
+        for (int i = 0; i < PacketSize; ++i)
+            lanes[i] = static_cast<float>(i);
+
+        // rasterize binned triangles in submission order
+        const size_t tile = static_cast<size_t>(tile_y * tiles_x_ + tile_x);
+        const size_t num_tiles = static_cast<size_t>(tiles_x_ * tiles_y_);
+        for (size_t blk = 0; blk < num_bin_blocks_; ++blk)
+        {
+            const std::vector<unsigned int> &bin = bins_[blk * num_tiles + tile];
+            for (size_t k = 0; k < bin.size(); ++k)
+            {
+                const TriangleSetup &tri = triangles_[bin[k]];
+                const int tx0 = std::max(tri.x_min, x0);
+                const int ty0 = std::max(tri.y_min, y0);
+                const int tx1 = std::min(tri.x_max, x1);
+                const int ty1 = std::min(tri.y_max, y1);
+                const int face = static_cast<int>(bin[k]);
+                for (int y = ty0; y <= ty1; ++y)
+                {
+                    const float py = static_cast<float>(y);
+                    const float e0_y = tri.b[0] * py + tri.c[0];
+                    const float e1_y = tri.b[1] * py + tri.c[1];
+                    const float e2_y = tri.b[2] * py + tri.c[2];
+                    const float inv_z_y = tri.inv_depth[1] * py + tri.inv_depth[2];
+                    for (int x = tx0; x <= tx1; x += PacketSize)
+                    {
+                        // evaluate edge functions for a packet of pixels
+                        const PacketF px = lanes + static_cast<float>(x);
+                        const PacketF e0 = tri.a[0] * px + e0_y;
+                        const PacketF e1 = tri.a[1] * px + e1_y;
+                        const PacketF e2 = tri.a[2] * px + e2_y;
+                        const PacketF z = (tri.inv_depth[0] * px + inv_z_y).inverse();
+
+                        // coverage and depth test
+                        const int idx = (y - y0) * stride + (x - x0);
+                        Eigen::Map<PacketF> depth_packet(depth + idx);
+                        const PacketB mask = (px <= static_cast<float>(tx1)) &&
+                                          (e0 >= 0.0f) && (e1 >= 0.0f) && (e2 >= 0.0f) &&
+                                          (z >= near) && (z <= far) && (z < depth_packet);
+                        if (!mask.any())
+                            continue;
+                        Eigen::Map<PacketI> faces_packet(faces + idx);
+                        depth_packet = mask.select(z, depth_packet);
+                        faces_packet = mask.select(PacketI::Constant(face), faces_packet);
+                    }
+                }
+            }
+        }
+
+        // shade visible surface points
+        const Mat3 K = camera_.intrinsics();
+        const float fx_inv = static_cast<float>(1.0 / K(0, 0));
+        const float fy_inv = static_cast<float>(1.0 / K(1, 1));
+        const float cx = static_cast<float>(K(0, 2));
+        const float cy = static_cast<float>(K(1, 2));
+        const Vec3b background = shading_.background();
+        for (int y = y0; y <= y1; ++y)
+        {
+            float* ptr_depth = depth_out.ptr<float>(y);
+            if (color_out.empty())
+            {
+                // depth only (no shading)
+                for (int x = x0; x <= x1; ++x)
+                {
+                    const int idx = (y - y0) * stride + (x - x0);
+                    ptr_depth[x] = faces[idx] < 0 ? std::numeric_limits<float>::quiet_NaN() : depth[idx];
+                }
+                continue;
+            }
+            unsigned char* ptr_color = color_out.ptr<unsigned char>(y);
+            for (int x = x0; x <= x1; ++x)
+            {
+                const int idx = (y - y0) * stride + (x - x0);
+                Vec3b c = background;
+                if (faces[idx] < 0)
+                {
+                    ptr_depth[x] = std::numeric_limits<float>::quiet_NaN();
+                }
+                else
+                {
+                    const float z = depth[idx];
+                    const Vec3f pt((x + 0.5f - cx) * fx_inv * z, (y + 0.5f - cy) * fy_inv * z, z);
+                    // barycentric coordinates of the surface point
+                    const Vec3ui &f = mesh_.face_vertices[faces[idx]];
+                    const Vec3f &p0 = vertices_cam_[f[0]];
+                    const Vec3f e1 = vertices_cam_[f[1]] - p0;
+                    const Vec3f e2 = vertices_cam_[f[2]] - p0;
+                    const Vec3f q = pt - p0;
+                    const Vec3f normal = e1.cross(e2);
+                    const float norm_sq_inv = 1.0f / normal.squaredNorm();
+                    const float b1 = q.cross(e2).dot(normal) * norm_sq_inv;
+                    const float b2 = e1.cross(q).dot(normal) * norm_sq_inv;
+                    ptr_depth[x] = z;
+                    c = shading_.shade(static_cast<unsigned int>(faces[idx]), b1, b2, pt);
+                }
+                ptr_color[3 * x] = c[0];
+                ptr_color[3 * x + 1] = c[1];
+                ptr_color[3 * x + 2] = c[2];
+            }
+        }
+    }
+
+
+    bool RasterScene::render(const Mat4& pose_world_to_view, cv::Mat& color_out, cv::Mat &depth_out)
+    {
+        const int w = camera_.width();
+        const int h = camera_.height();
+        if (w <= 0 || h <= 0)
+            return false;
+
+        // (mesh vertices are stored relative to the mesh origin)
+        Mat4 pose_mesh_to_view = pose_world_to_view;
+        pose_mesh_to_view.topRightCorner<3, 1>() += pose_world_to_view.topLeftCorner<3, 3>() * mesh_.origin;
+        shading_.setPose(pose_mesh_to_view);
+        const Mat3f rot = pose_mesh_to_view.topLeftCorner<3, 3>().cast<float>();
+        const Vec3f trans = pose_mesh_to_view.topRightCorner<3, 1>().cast<float>();
+
+        // transform vertices into camera coordinates
+        vertices_cam_.resize(mesh_.vertices.size());
+        parallelFor(0, vertices_cam_.size(), [&](size_t i0, size_t i1)
+        {
+            for (size_t i = i0; i < i1; ++i)
+                vertices_cam_[i] = rot * mesh_.vertices[i] + trans;
+        });
+
+        // set up triangles and bin them into tiles, in contiguous blocks of triangles
+        // (binning blocks are rasterized in order, i.e. in triangle submission order)
+        const size_t num_faces = mesh_.face_vertices.size();
+        tiles_x_ = (w + TileSize - 1) / TileSize;
+        tiles_y_ = (h + TileSize - 1) / TileSize;
+        const size_t num_tiles = static_cast<size_t>(tiles_x_ * tiles_y_);
+        num_bin_blocks_ = std::max<size_t>(1, std::min(numThreads() * 4, num_faces / 4096));
+        bins_.resize(num_bin_blocks_ * num_tiles);
+        triangles_.resize(num_faces);
+        parallelFor(0, num_bin_blocks_, [&](size_t b0, size_t b1)
+        {
+            for (size_t blk = b0; blk < b1; ++blk)
+            {
+                std::vector<unsigned int>* bins = &bins_[blk * num_tiles];
+                for (size_t t = 0; t < num_tiles; ++t)
+                    bins[t].clear();
+                for (size_t f = blk * num_faces / num_bin_blocks_; f < (blk + 1) * num_faces / num_bin_blocks_; ++f)
+                {
+                    TriangleSetup &tri = triangles_[f];
+                    if (!setupTriangle(static_cast<unsigned int>(f), tri))
+                        continue;
+                    for (int ty = tri.y_min / TileSize; ty <= tri.y_max / TileSize; ++ty)
+                        for (int tx = tri.x_min / TileSize; tx <= tri.x_max / TileSize; ++tx)
+                            bins[ty * tiles_x_ + tx].push_back(static_cast<unsigned int>(f));
+                }
+            }
+        }, num_bin_blocks_);
+
+        // rasterize and shade tiles in parallel (no color for depth-only rendering)
+        if (cfg_.depth_only)
+            color_out.release();
+        else
+            color_out.create(h, w, CV_8UC3);
+        depth_out.create(h, w, CV_32FC1);
+        parallelFor(0, num_tiles, [&](size_t t0, size_t t1)
+        {
+            for (size_t t = t0; t < t1; ++t)
+                rasterizeTile(static_cast<int>(t % tiles_x_), static_cast<int>(t / tiles_x_), color_out, depth_out);
+        }, num_tiles);
+
+        return true;
+    }
+
+} // namespace cpu
+} // namespace menderer
@@ -0,0 +1,183 @@
+/**
+* This file is part of Menderer.
+*
+* Copyright 2019 Robert Maier, Technical University of Munich.
+* For more information see <https://github.com/robmaier/menderer>.
+*
+* Menderer is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* Menderer is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with Menderer. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <menderer/cpu/raycast_scene.h>
+
+#include <cmath>
+#include <limits>
+
+#include <menderer/parallel.h>
+#include <menderer/ogl/render_context.h>
+
+
+namespace menderer
+{
+namespace cpu
+{
+
+    RaycastScene::RaycastScene(const Camera& camera, const ogl::MeshRenderer::Config &renderer_cfg) :
+        camera_(camera),
+        cfg_(renderer_cfg),
+        mesh_(),
+        bvh_(),
+        shading_(renderer_cfg),
+        near_(0.0),
+        far_(0.0)
+    {
+        // same clip planes as the OpenGL renderer
+        ogl::RenderContext render_ctx;
+        near_ = render_ctx.near();
+        far_ = render_ctx.far();
+    }
+
+
+    RaycastScene::~RaycastScene()
+    {
+    }
+
+
+    bool RaycastScene::upload(const Mesh& mesh)
+    {
+        return upload(mesh.view());
+    }
+
+
+    bool RaycastScene::upload(const MeshView& mesh)
+    {
+        // copy mesh arrays (the view may not outlive the upload)
+        mesh_.clear();
+        mesh_.origin = mesh.origin;
+        mesh_.vertices.assign(mesh.vertices, mesh.vertices + mesh.num_vertices);
+        mesh_.normals.assign(mesh.normals, mesh.normals + mesh.num_normals);
+        mesh_.colors.assign(mesh.colors, mesh.colors + mesh.num_colors);
+        mesh_.face_vertices.assign(mesh.face_vertices, mesh.face_vertices + mesh.num_faces);
+        shading_.setMesh(&mesh_);
+
+        // build BVH over the triangles
+        bvh_.build(mesh_.view());
+        return true;
+    }
+
+
+    bool RaycastScene::render(const Mat4& pose_world_to_view, cv::Mat& color_out, cv::Mat &depth_out)
+    {
+        const int w = camera_.width();
+        const int h = camera_.height();
+        if (w <= 0 || h <= 0)
+            return false;
+        const Mat3 K = camera_.intrinsics();
+        const float fx_inv = static_cast<float>(1.0 / K(0, 0));
+        const float fy_inv = static_cast<float>(1.0 / K(1, 1));
+        const float cx = static_cast<float>(K(0, 2));
+        const float cy = static_cast<float>(K(1, 2));
+
+        // (mesh vertices are stored relative to the mesh origin)
+        Mat4 pose_mesh_to_view = pose_world_to_view;
+        pose_mesh_to_view.topRightCorner<3, 1>() += pose_world_to_view.topLeftCorner<3, 3>() * mesh_.origin;
+        shading_.setPose(pose_mesh_to_view);
+        // rays in mesh coordinates
+        const Mat3f rot_inv = pose_mesh_to_view.topLeftCorner<3, 3>().transpose().cast<float>();
+        const Vec3f origin = (-pose_mesh_to_view.topLeftCorner<3, 3>().transpose() *
+                              pose_mesh_to_view.topRightCorner<3, 1>()).cast<float>();
+
+        // (no color for depth-only rendering)
+        const bool shade = !cfg_.depth_only;
+        if (shade)
+            color_out.create(h, w, CV_8UC3);
+        else
+            color_out.release();
+        depth_out.create(h, w, CV_32FC1);
+        const Vec3b background = shading_.background();
+        const float t_min = static_cast<float>(near_);
+        const float t_max = static_cast<float>(far_);
+
+        // cast packets of 4x2 rays within image tiles of 16x16 pixels in parallel
+        const int tile_size = 16;
+        const int tiles_x = (w + tile_size - 1) / tile_size;
+        const int tiles_y = (h + tile_size - 1) / tile_size;
+        const size_t num_tiles = static_cast<size_t>(tiles_x * tiles_y);
+        parallelFor(0, num_tiles, [&](size_t t0, size_t t1)
+        {
+            BVH::RayPacket rays;
+            BVH::HitPacket hits;
+            rays.origin = origin;
+            for (size_t t = t0; t < t1; ++t)
+            {
+                const int x0 = static_cast<int>(t % tiles_x) * tile_size;
+                const int y0 = static_cast<int>(t / tiles_x) * tile_size;
+                for (int y = y0; y < std::min(y0 + tile_size, h); y += 2)
+                {
+                    for (int x = x0; x < std::min(x0 + tile_size, w); x += 4)
+                    {
+                        // rays through pixel centers (camera z-axis component 1, i.e. t is the depth)
+                        Vec3f dirs_cam[BVH::PacketSize];
+                        for (int i = 0; i < BVH::PacketSize; ++i)
+                        {
+                            const int px = x + i % 4;
+                            const int py = y + i / 4;
+                            dirs_cam[i] = Vec3f((px + 0.5f - cx) * fx_inv, (py + 0.5f - cy) * fy_inv, 1.0f);
+                            const Vec3f dir = rot_inv * dirs_cam[i];
+                            rays.dir_x[i] = dir[0];
+                            rays.dir_y[i] = dir[1];
+                            rays.dir_z[i] = dir[2];
+                            rays.t_min[i] = t_min;
+                            rays.t_max[i] = (px < w && py < h) ? t_max : -1.0f;
+                        }
+                        bvh_.intersect(rays, hits, cfg_.cull_backfaces);
+
+                        // shade hits
+                        for (int i = 0; i < BVH::PacketSize; ++i)
+                        {
+                            const int px = x + i % 4;
+                            const int py = y + i / 4;
+                            if (px >= w || py >= h)
+                                continue;
+                            float* ptr_depth = depth_out.ptr<float>(py) + px;
+                            if (!shade)
+                            {
+                                *ptr_depth = hits.face[i] < 0 ? std::numeric_limits<float>::quiet_NaN() : hits.t[i];
+                                continue;
+                            }
+                            unsigned char* ptr_color = color_out.ptr<unsigned char>(py) + 3 * px;
+                            Vec3b c = background;
+                            if (hits.face[i] < 0)
+                            {
+                                *ptr_depth = std::numeric_limits<float>::quiet_NaN();
+                            }
+                            else
+                            {
+                                *ptr_depth = hits.t[i];
+                                c = shading_.shade(static_cast<unsigned int>(hits.face[i]),
+                                                   hits.u[i], hits.v[i], dirs_cam[i] * hits.t[i]);
+                            }
+                            ptr_color[0] = c[0];
+                            ptr_color[1] = c[1];
+                            ptr_color[2] = c[2];
+                        }
+                    }
+                }
+            }
+        }, num_tiles);
+
+        return true;
+    }
+
+} // namespace cpu
+} // namespace menderer
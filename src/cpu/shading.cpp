@@ -0,0 +1,181 @@
+/**
+* This file is part of Menderer.
+*
+* Copyright 2019 Robert Maier, Technical University of Munich.
+* For more information see <https://github.com/robmaier/menderer>.
+*
+* Menderer is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* Menderer is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with Menderer. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <menderer/cpu/shading.h>
+
+#include <algorithm>
+#include <cmath>
+
+
+namespace menderer
+{
+namespace cpu
+{
+
+    Shading::Shading(const ogl::MeshRenderer::Config &cfg) :
+        cfg_(cfg),
+        mode_(FixedFunction),
+        mesh_(nullptr),
+        has_normals_(false),
+        has_colors_(false),
+        rot_eye_(Mat3f::Identity())
+    {
+        if (cfg_.shader == "normals")
+            mode_ = Normals;
+        else if (cfg_.shader == "normals_phong")
+            mode_ = NormalsPhong;
+        else if (cfg_.shader == "phong")
+            mode_ = Phong;
+
+        // light colors (OpenGL defaults of light 0 if lighting is disabled)
+        if (mode_ == FixedFunction)
+        {
+            light_ambient_ = Vec4f(0.2f, 0.2f, 0.2f, 1.0f);
+            light_diffuse_ = Vec4f(0.7f, 0.7f, 0.7f, 1.0f);
+            light_specular_ = Vec4f(0.0f, 0.0f, 0.0f, 1.0f);
+        }
+        else if (cfg_.lighting)
+        {
+            light_ambient_ = Vec4f(0.2f, 0.2f, 0.2f, 1.0f);
+            light_diffuse_ = Vec4f(0.6f, 0.6f, 0.6f, 1.0f);
+            light_specular_ = Vec4f(0.8f, 0.8f, 0.8f, 1.0f);
+        }
+        else
+        {
+            light_ambient_ = Vec4f(0.0f, 0.0f, 0.0f, 1.0f);
+            light_diffuse_ = Vec4f(1.0f, 1.0f, 1.0f, 1.0f);
+            light_specular_ = Vec4f(1.0f, 1.0f, 1.0f, 1.0f);
+        }
+    }
+
+
+    Shading::~Shading()
+    {
+    }
+
+
+    void Shading::setMesh(const Mesh* mesh)
+    {
+        mesh_ = mesh;
+        has_normals_ = mesh_ && !mesh_->normals.empty() && mesh_->normals.size() == mesh_->vertices.size();
+        has_colors_ = mesh_ && !mesh_->colors.empty() && mesh_->colors.size() == mesh_->vertices.size();
+    }
+
+
+    void Shading::setPose(const Mat4 &pose_mesh_to_cam)
+    {
+        // normal matrix of the OpenGL modelview (y and z axis flipped)
+        rot_eye_ = pose_mesh_to_cam.topLeftCorner<3, 3>().cast<float>();
+        rot_eye_.row(1) *= -1.0f;
+        rot_eye_.row(2) *= -1.0f;
+    }
+
+
+    Vec3b Shading::background() const
+    {
+        return toBGR(cfg_.background);
+    }
+
+
+    Vec3f Shading::eyeNormal(unsigned int v) const
+    {
+        // OpenGL default normal if the mesh has no normals
+        const Vec3f n = has_normals_ ? mesh_->normals[v] : Vec3f(0.0f, 0.0f, 1.0f);
+        return rot_eye_ * n;
+    }
+
+
+    Vec4f Shading::vertexColor(unsigned int v) const
+    {
+        Vec4f color = cfg_.color;
+        if (cfg_.colored && has_colors_)
+            color = Vec4f(mesh_->colors[v][0] / 255.0f, mesh_->colors[v][1] / 255.0f,
+                          mesh_->colors[v][2] / 255.0f, 1.0f);
+        if (!cfg_.lighting)
+            return color;
+
+        // fixed-function lighting: global ambient, directional light 0 along eye z-axis
+        const float n_dot_l = std::max(eyeNormal(v).normalized()[2], 0.0f);
+        Vec4f lit = color;
+        lit.head<3>() = (color.head<3>() * 0.2f + color.head<3>().cwiseProduct(light_ambient_.head<3>()) +
+                         n_dot_l * color.head<3>().cwiseProduct(light_diffuse_.head<3>())).cwiseMin(1.0f);
+        return lit;
+    }
+
+
+    Vec3b Shading::shade(unsigned int face, float b1, float b2, const Vec3f &pt) const
+    {
+        const Vec3ui &f = mesh_->face_vertices[face];
+        const float b0 = 1.0f - b1 - b2;
+
+        if (mode_ == FixedFunction)
+        {
+            // per-vertex colors, interpolated (smooth) or from the provoking last vertex (flat)
+            if (!cfg_.smooth)
+                return toBGR(vertexColor(f[2]));
+            return toBGR(b0 * vertexColor(f[0]) + b1 * vertexColor(f[1]) + b2 * vertexColor(f[2]));
+        }
+
+        // interpolated normal and position in eye coordinates
+        const Vec3f normal = b0 * eyeNormal(f[0]) + b1 * eyeNormal(f[1]) + b2 * eyeNormal(f[2]);
+        const Vec3f n = normal.normalized();
+        if (mode_ == Normals)
+            return toBGR(Vec4f(n[0] * 0.5f + 0.5f, n[1] * 0.5f + 0.5f, n[2] * 0.5f + 0.5f, 1.0f));
+
+        const Vec3f vpos(pt[0], -pt[1], -pt[2]);
+        const Vec3f light_dir = (Vec3f(0.0f, 0.0f, 1.0f) - vpos).normalized();
+        const Vec3f e = (-vpos).normalized();
+        const Vec3f r = (2.0f * n.dot(light_dir) * n - light_dir).normalized();
+        const float diffuse = std::max(n.dot(light_dir), 0.0f);
+        const float specular = std::pow(std::max(r.dot(e), 0.0f), 0.3f * 96.0f);
+
+        Vec4f color;
+        Vec4f out;
+        if (mode_ == NormalsPhong)
+        {
+            color = Vec4f(normal[0] * 0.5f + 0.5f, normal[1] * 0.5f + 0.5f, normal[2] * 0.5f + 0.5f, 1.0f);
+            out = Vec4f::Zero();
+        }
+        else
+        {
+            // material color with scene ambient
+            color = cfg_.color;
+            out = color * 0.2f;
+        }
+        out += color.cwiseProduct(light_ambient_);
+        out += (color.cwiseProduct(light_diffuse_) * diffuse).cwiseMax(0.0f).cwiseMin(1.0f);
+        out += (color.cwiseProduct(light_specular_) * specular).cwiseMax(0.0f).cwiseMin(1.0f);
+        return toBGR(out);
+    }
+
+
+    Vec3b Shading::toBGR(const Vec4f &color)
+    {
+        Vec3b bgr;
+        for (int i = 0; i < 3; ++i)
+        {
+            const float c = std::min(std::max(color[2 - i], 0.0f), 1.0f);
+            bgr[i] = static_cast<unsigned char>(c * 255.0f + 0.5f);
+        }
+        return bgr;
+    }
+
+} // namespace cpu
+} // namespace menderer
@@ -181,47 +181,36 @@ namespace menderer
 
     bool Dataset::saveColor(const std::string &filename, const cv::Mat& color)
     {
-        if (filename.empty() || color.empty())
-            return false;
-
-        cv::imwrite(filename, color);
-        return true;
+        return save(filename, color, PngEncoder());
     }
 
 
     bool Dataset::saveDepthPNG(const std::string &filename, const cv::Mat& depth)
     {
-        if (filename.empty() || depth.empty() || depth.type() != CV_32FC1)
+        if (depth.type() != CV_32FC1)
             return false;
 
-        // store rendered depth map as .png (16 bit unsigned short)
-        cv::Mat depth16;
-        depth.convertTo(depth16, CV_16UC1, 5000.0);
-        cv::imwrite(filename, depth16);
-
-        return true;
+        // store rendered depth map as .png (16 bit unsigned short, scaled by 5000)
+        return save(filename, depth, PngEncoder());
     }
 
 
     bool Dataset::saveDepthBinary(const std::string &filename, const cv::Mat& depth)
     {
-        if (filename.empty() || depth.empty() || depth.type() != CV_32FC1)
+        if (depth.type() != CV_32FC1)
             return false;
 
-        // store float depth to binary file
-        std::ofstream out_file;
-        out_file.open(filename.c_str(), std::ios::binary);
-        if (!out_file.is_open())
-            return false;
+        // store float depth to binary file (without header)
+        return save(filename, depth, RawEncoder(false));
+    }
 
-        // write depth data
-        size_t w = static_cast<size_t>(depth.cols);
-        size_t h = static_cast<size_t>(depth.rows);
-        size_t size = w * h;
-        out_file.write((const char*)depth.data, sizeof(float) * size);
-        out_file.close();
 
-        return true;
+    bool Dataset::save(const std::string &filename, const cv::Mat& img, const Encoder &encoder)
+    {
+        if (filename.empty() || img.empty())
+            return false;
+
+        return encoder.save(filename, img);
     }
 
 
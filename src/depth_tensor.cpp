@@ -0,0 +1,148 @@
+/**
+* This file is part of Menderer.
+*
+* Copyright 2019 Robert Maier, Technical University of Munich.
+* For more information see <https://github.com/robmaier/menderer>.
+*
+* Menderer is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* Menderer is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with Menderer. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <menderer/depth_tensor.h>
+
+#include <cstring>
+#include <iostream>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#endif
+
+#include <menderer/encoder.h>
+
+
+namespace menderer
+{
+
+    DepthTensor::DepthTensor() :
+        data_(nullptr),
+        size_(0),
+        header_size_(0),
+        num_frames_(0),
+        width_(0),
+        height_(0),
+        mapped_(false)
+    {
+    }
+
+
+    DepthTensor::~DepthTensor()
+    {
+        close();
+    }
+
+
+    bool DepthTensor::create(const std::string &filename, size_t num_frames, int width, int height)
+    {
+        close();
+        if (filename.empty() || num_frames == 0 || width <= 0 || height <= 0)
+            return false;
+
+        // .npy header for a float32 array of shape (N, H, W)
+        std::vector<size_t> shape;
+        shape.push_back(num_frames);
+        shape.push_back(static_cast<size_t>(height));
+        shape.push_back(static_cast<size_t>(width));
+        std::string header;
+        RawEncoder::npyHeader(shape, CV_32FC1, header);
+        const size_t size = header.size() + num_frames * static_cast<size_t>(width) * static_cast<size_t>(height) * sizeof(float);
+
+#ifndef _WIN32
+        // preallocate file (sparse) and map it for writing
+        int fd = ::open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0 || ftruncate(fd, static_cast<off_t>(size)) != 0)
+        {
+            if (fd >= 0)
+                ::close(fd);
+            std::cerr << "could not create depth tensor file " << filename << "!" << std::endl;
+            return false;
+        }
+        void* ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        // mapping stays valid after closing the file descriptor
+        ::close(fd);
+        if (ptr == MAP_FAILED)
+        {
+            std::cerr << "could not map depth tensor file " << filename << "!" << std::endl;
+            return false;
+        }
+        data_ = static_cast<char*>(ptr);
+        mapped_ = true;
+#else
+        // keep array in memory, written when closing
+        buffer_.assign(size, 0);
+        data_ = &buffer_[0];
+#endif
+        std::memcpy(data_, header.data(), header.size());
+
+        filename_ = filename;
+        size_ = size;
+        header_size_ = header.size();
+        num_frames_ = num_frames;
+        width_ = width;
+        height_ = height;
+        return true;
+    }
+
+
+    cv::Mat DepthTensor::frame(size_t i)
+    {
+        if (!data_ || i >= num_frames_)
+            return cv::Mat();
+        const size_t slice_size = static_cast<size_t>(width_) * static_cast<size_t>(height_) * sizeof(float);
+        return cv::Mat(height_, width_, CV_32FC1, data_ + header_size_ + i * slice_size);
+    }
+
+
+    bool DepthTensor::close()
+    {
+        if (!data_)
+            return true;
+
+        bool ok = true;
+#ifndef _WIN32
+        if (mapped_)
+            ok = munmap(data_, size_) == 0;
+#else
+        std::ofstream file(filename_.c_str(), std::ios::binary);
+        file.write(&buffer_[0], static_cast<std::streamsize>(buffer_.size()));
+        ok = file.good();
+        buffer_.clear();
+#endif
+        data_ = nullptr;
+        size_ = 0;
+        header_size_ = 0;
+        num_frames_ = 0;
+        mapped_ = false;
+        return ok;
+    }
+
+
+    size_t DepthTensor::frames() const
+    {
+        return num_frames_;
+    }
+
+} // namespace menderer
@@ -0,0 +1,727 @@
+/**
+* This file is part of Menderer.
+*
+* Copyright 2019 Robert Maier, Technical University of Munich.
+* For more information see <https://github.com/robmaier/menderer>.
+*
+* Menderer is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* Menderer is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with Menderer. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <menderer/encoder.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+
+#include <opencv2/imgcodecs.hpp>
+
+#include <menderer/parallel.h>
+
+
+namespace menderer
+{
+
+    std::unique_ptr<Encoder> Encoder::create(const std::string &format, int png_compression)
+    {
+        if (format == "png")
+            return std::unique_ptr<Encoder>(new PngEncoder(png_compression));
+        else if (format == "pnm")
+            return std::unique_ptr<Encoder>(new PnmEncoder());
+        else if (format == "raw")
+            return std::unique_ptr<Encoder>(new RawEncoder(true));
+        else if (format == "bin")
+            return std::unique_ptr<Encoder>(new RawEncoder(false));
+        else if (format == "codec")
+            return std::unique_ptr<Encoder>(new DepthCodecEncoder());
+        return std::unique_ptr<Encoder>();
+    }
+
+
+    bool Encoder::save(const std::string &filename, const cv::Mat &img) const
+    {
+        if (filename.empty() || img.empty())
+            return false;
+
+        std::vector<unsigned char> data;
+        if (!encode(img, data))
+            return false;
+
+        std::ofstream out_file(filename.c_str(), std::ios::binary);
+        if (!out_file.is_open())
+            return false;
+        out_file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+        return out_file.good();
+    }
+
+
+    bool Encoder::decode(const std::string &extension, const std::vector<unsigned char> &data, cv::Mat &img)
+    {
+        if (extension == ".png" || extension == ".ppm" || extension == ".pgm")
+        {
+            img = cv::imdecode(data, cv::IMREAD_UNCHANGED);
+            return !img.empty();
+        }
+        else if (extension == ".mdc")
+        {
+            return DepthCodecEncoder::decode(data, img);
+        }
+        else if (extension == ".npy")
+        {
+            std::vector<size_t> shape;
+            int type;
+            size_t header_size;
+            if (!RawEncoder::parseNpyHeader(reinterpret_cast<const char*>(data.data()), data.size(),
+                                            shape, type, header_size) ||
+                shape.size() < 2 || shape.size() > 3)
+                return false;
+            const int channels = shape.size() == 3 ? static_cast<int>(shape[2]) : 1;
+            img.create(static_cast<int>(shape[0]), static_cast<int>(shape[1]), CV_MAKETYPE(type, channels));
+            const size_t size = img.total() * img.elemSize();
+            if (data.size() < header_size + size)
+                return false;
+            std::memcpy(img.ptr(), &data[header_size], size);
+            return true;
+        }
+
+        std::cerr << "cannot decode " << extension << " data!" << std::endl;
+        return false;
+    }
+
+
+    PngEncoder::PngEncoder(int compression, double depth_scale) :
+        compression_(compression),
+        depth_scale_(depth_scale)
+    {
+    }
+
+
+    std::string PngEncoder::extension(int /*type*/) const
+    {
+        return ".png";
+    }
+
+
+    bool PngEncoder::encode(const cv::Mat &img, std::vector<unsigned char> &data) const
+    {
+        if (img.empty())
+            return false;
+
+        return cv::imencode(".png", convert(img), data, params());
+    }
+
+
+    bool PngEncoder::save(const std::string &filename, const cv::Mat &img) const
+    {
+        if (filename.empty() || img.empty())
+            return false;
+
+        // (written directly instead of encoding into a buffer first)
+        return cv::imwrite(filename, convert(img), params());
+    }
+
+
+    std::vector<int> PngEncoder::params() const
+    {
+        std::vector<int> params;
+        if (compression_ >= 0)
+        {
+            params.push_back(cv::IMWRITE_PNG_COMPRESSION);
+            params.push_back(std::min(compression_, 9));
+        }
+        return params;
+    }
+
+
+    const cv::Mat& PngEncoder::convert(const cv::Mat &img) const
+    {
+        if (img.type() != CV_32FC1)
+            return img;
+
+        // store float depth as 16 bit unsigned short (conversion buffer reused per thread)
+        static thread_local cv::Mat img16;
+        img.convertTo(img16, CV_16UC1, depth_scale_);
+        return img16;
+    }
+
+
+    PnmEncoder::PnmEncoder(double depth_scale) :
+        depth_scale_(depth_scale)
+    {
+    }
+
+
+    std::string PnmEncoder::extension(int type) const
+    {
+        return CV_MAT_CN(type) == 3 ? ".ppm" : ".pgm";
+    }
+
+
+    bool PnmEncoder::encode(const cv::Mat &img, std::vector<unsigned char> &data) const
+    {
+        if (img.empty())
+            return false;
+
+        if (img.type() == CV_32FC1)
+        {
+            // store float depth as 16 bit .pgm (16 bit conversion buffer reused per thread)
+            static thread_local cv::Mat img16;
+            img.convertTo(img16, CV_16UC1, depth_scale_);
+            return cv::imencode(".pgm", img16, data);
+        }
+        if ((img.depth() != CV_8U && img.depth() != CV_16U) || (img.channels() != 1 && img.channels() != 3))
+        {
+            std::cerr << "image type not supported by PNM encoder!" << std::endl;
+            return false;
+        }
+        return cv::imencode(extension(img.type()), img, data);
+    }
+
+
+    RawEncoder::RawEncoder(bool header) :
+        header_(header)
+    {
+    }
+
+
+    std::string RawEncoder::extension(int /*type*/) const
+    {
+        return header_ ? ".npy" : ".bin";
+    }
+
+
+    bool RawEncoder::encode(const cv::Mat &img, std::vector<unsigned char> &data) const
+    {
+        if (img.empty())
+            return false;
+
+        std::string header;
+        if (!createHeader(img, header))
+            return false;
+
+        // header followed by the pixel data
+        const size_t row_size = static_cast<size_t>(img.cols) * img.elemSize();
+        data.resize(header.size() + row_size * static_cast<size_t>(img.rows));
+        std::memcpy(data.data(), header.data(), header.size());
+        for (int y = 0; y < img.rows; ++y)
+            std::memcpy(&data[header.size() + row_size * static_cast<size_t>(y)], img.ptr(y), row_size);
+        return true;
+    }
+
+
+    bool RawEncoder::save(const std::string &filename, const cv::Mat &img) const
+    {
+        if (filename.empty() || img.empty())
+            return false;
+
+        std::string header;
+        if (!createHeader(img, header))
+            return false;
+
+        std::ofstream out_file(filename.c_str(), std::ios::binary);
+        if (!out_file.is_open())
+            return false;
+        out_file.write(header.data(), static_cast<std::streamsize>(header.size()));
+
+        // write pixel data (row by row for non-continuous images)
+        const size_t row_size = static_cast<size_t>(img.cols) * img.elemSize();
+        if (img.isContinuous())
+        {
+            out_file.write(reinterpret_cast<const char*>(img.ptr()), static_cast<std::streamsize>(row_size * static_cast<size_t>(img.rows)));
+        }
+        else
+        {
+            for (int y = 0; y < img.rows; ++y)
+                out_file.write(reinterpret_cast<const char*>(img.ptr(y)), static_cast<std::streamsize>(row_size));
+        }
+        return out_file.good();
+    }
+
+
+    bool RawEncoder::createHeader(const cv::Mat &img, std::string &header) const
+    {
+        header.clear();
+        if (!header_)
+            return true;
+
+        std::vector<size_t> shape;
+        shape.push_back(static_cast<size_t>(img.rows));
+        shape.push_back(static_cast<size_t>(img.cols));
+        if (img.channels() > 1)
+            shape.push_back(static_cast<size_t>(img.channels()));
+        if (!npyHeader(shape, img.type(), header))
+        {
+            std::cerr << "image type not supported by raw encoder!" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+
+    bool RawEncoder::npyHeader(const std::vector<size_t> &shape, int type, std::string &header)
+    {
+        // NumPy type description (little endian)
+        std::string descr;
+        switch (CV_MAT_DEPTH(type))
+        {
+        case CV_8U:  descr = "|u1"; break;
+        case CV_8S:  descr = "|i1"; break;
+        case CV_16U: descr = "<u2"; break;
+        case CV_16S: descr = "<i2"; break;
+        case CV_32S: descr = "<i4"; break;
+        case CV_32F: descr = "<f4"; break;
+        case CV_64F: descr = "<f8"; break;
+        default:
+            return false;
+        }
+
+        std::stringstream ss;
+        ss << "{'descr': '" << descr << "', 'fortran_order': False, 'shape': (";
+        for (size_t i = 0; i < shape.size(); ++i)
+            ss << shape[i] << (shape.size() == 1 || i + 1 < shape.size() ? ", " : "");
+        ss << "), }";
+        std::string dict = ss.str();
+
+        // magic string, version 1.0 and header length, dictionary padded with spaces and
+        // terminated by a newline such that the data starts at a multiple of 64 bytes
+        const size_t prefix_size = 10;
+        const size_t header_size = (prefix_size + dict.size() + 1 + 63) / 64 * 64;
+        dict.append(header_size - prefix_size - dict.size() - 1, ' ');
+        dict.push_back('\n');
+        const size_t dict_size = dict.size();
+
+        header.assign("\x93NUMPY\x01\x00", 8);
+        header.push_back(static_cast<char>(dict_size & 0xFF));
+        header.push_back(static_cast<char>((dict_size >> 8) & 0xFF));
+        header += dict;
+        return true;
+    }
+
+
+    bool RawEncoder::parseNpyHeader(const char* data, size_t size, std::vector<size_t> &shape,
+                                    int &type, size_t &header_size)
+    {
+        // magic string, version and header length (2 bytes for version 1.x, 4 bytes otherwise)
+        if (size < 10 || std::memcmp(data, "\x93NUMPY", 6) != 0)
+            return false;
+        const unsigned char* ptr = reinterpret_cast<const unsigned char*>(data);
+        size_t dict_size;
+        if (ptr[6] == 1)
+        {
+            dict_size = static_cast<size_t>(ptr[8]) | (static_cast<size_t>(ptr[9]) << 8);
+            header_size = 10 + dict_size;
+        }
+        else
+        {
+            if (size < 12)
+                return false;
+            dict_size = 0;
+            for (int i = 0; i < 4; ++i)
+                dict_size |= static_cast<size_t>(ptr[8 + i]) << (8 * i);
+            header_size = 12 + dict_size;
+        }
+        if (header_size > size)
+            return false;
+        const std::string dict(data + header_size - dict_size, dict_size);
+
+        // element type
+        const size_t pos_descr = dict.find("'descr'");
+        const size_t pos_type = pos_descr == std::string::npos ? pos_descr : dict.find('\'', dict.find(':', pos_descr));
+        if (pos_type == std::string::npos || pos_type + 4 > dict.size())
+            return false;
+        const std::string descr = dict.substr(pos_type + 1, 3);
+        if (descr == "|u1" || descr == "<u1")
+            type = CV_8U;
+        else if (descr == "|i1" || descr == "<i1")
+            type = CV_8S;
+        else if (descr == "<u2")
+            type = CV_16U;
+        else if (descr == "<i2")
+            type = CV_16S;
+        else if (descr == "<i4")
+            type = CV_32S;
+        else if (descr == "<f4")
+            type = CV_32F;
+        else if (descr == "<f8")
+            type = CV_64F;
+        else
+            return false;
+
+        // only C (row-major) order is supported
+        const size_t pos_order = dict.find("'fortran_order'");
+        if (pos_order == std::string::npos || dict.find("False", pos_order) == std::string::npos ||
+            dict.find("False", pos_order) > dict.find(',', pos_order))
+            return false;
+
+        // dimensions
+        const size_t pos_shape = dict.find("'shape'");
+        const size_t pos_begin = pos_shape == std::string::npos ? pos_shape : dict.find('(', pos_shape);
+        const size_t pos_end = pos_begin == std::string::npos ? pos_begin : dict.find(')', pos_begin);
+        if (pos_end == std::string::npos)
+            return false;
+        shape.clear();
+        std::stringstream ss(dict.substr(pos_begin + 1, pos_end - pos_begin - 1));
+        std::string dim;
+        while (std::getline(ss, dim, ','))
+        {
+            if (dim.find_first_not_of(' ') == std::string::npos)
+                continue;
+            std::stringstream ss_dim(dim);
+            size_t value;
+            if (!(ss_dim >> value))
+                return false;
+            shape.push_back(value);
+        }
+        return true;
+    }
+
+
+    namespace
+    {
+
+        /// Residuals with quotients of at least this value are escaped and stored verbatim.
+        const uint32_t RiceEscape = 24;
+
+        /// Magic number of .mdc files.
+        const char DepthCodecMagic[4] = {'M', 'D', 'C', '1'};
+
+
+        /// Writes bits into a byte stream (least significant bits first).
+        class BitWriter
+        {
+        public:
+            BitWriter(std::vector<unsigned char> &data) : data_(data), acc_(0), num_bits_(0) {}
+
+            /// Writes the lowest n bits of a value (n <= 32).
+            void put(uint32_t value, int n)
+            {
+                acc_ |= static_cast<uint64_t>(value) << num_bits_;
+                num_bits_ += n;
+                while (num_bits_ >= 32)
+                {
+                    for (int i = 0; i < 4; ++i)
+                        data_.push_back(static_cast<unsigned char>(acc_ >> (8 * i)));
+                    acc_ >>= 32;
+                    num_bits_ -= 32;
+                }
+            }
+
+            /// Writes the remaining bits (padded to full bytes).
+            void flush()
+            {
+                for (; num_bits_ > 0; num_bits_ -= 8, acc_ >>= 8)
+                    data_.push_back(static_cast<unsigned char>(acc_));
+                num_bits_ = 0;
+                acc_ = 0;
+            }
+
+        private:
+            std::vector<unsigned char> &data_;
+            uint64_t acc_;
+            int num_bits_;
+        };
+
+
+        /// Reads bits from a byte stream (zeros past the end).
+        class BitReader
+        {
+        public:
+            BitReader(const unsigned char* data, size_t size) : ptr_(data), end_(data + size), acc_(0), num_bits_(0) {}
+
+            /// Reads n bits (n <= 32).
+            uint32_t get(int n)
+            {
+                refill();
+                const uint32_t value = static_cast<uint32_t>(acc_ & ((static_cast<uint64_t>(1) << n) - 1));
+                acc_ >>= n;
+                num_bits_ -= n;
+                return value;
+            }
+
+            /// Reads a unary code (number of ones before a zero), at most max_ones ones (< 32).
+            uint32_t getUnary(uint32_t max_ones)
+            {
+                refill();
+                uint32_t q = 0;
+                while (q < max_ones && (acc_ & 1))
+                {
+                    acc_ >>= 1;
+                    ++q;
+                }
+                // (no terminating zero after the maximum number of ones)
+                const int n = static_cast<int>(q < max_ones ? q + 1 : q);
+                if (q < max_ones)
+                    acc_ >>= 1;
+                num_bits_ -= n;
+                return q;
+            }
+
+        private:
+            void refill()
+            {
+                while (num_bits_ <= 56)
+                {
+                    if (ptr_ == end_)
+                    {
+                        num_bits_ = 64;
+                        break;
+                    }
+                    acc_ |= static_cast<uint64_t>(*ptr_++) << num_bits_;
+                    num_bits_ += 8;
+                }
+            }
+
+            const unsigned char* ptr_;
+            const unsigned char* end_;
+            uint64_t acc_;
+            int num_bits_;
+        };
+
+
+        /// Median edge detector prediction from the left, upper and upper left neighbors.
+        inline uint32_t predict(const uint32_t* row, const uint32_t* row_above, int x)
+        {
+            if (!row_above)
+                return x > 0 ? row[x - 1] : 0;
+            if (x == 0)
+                return row_above[0];
+            const uint32_t a = row[x - 1];
+            const uint32_t b = row_above[x];
+            const uint32_t c = row_above[x - 1];
+            const uint32_t v_min = std::min(a, b);
+            const uint32_t v_max = std::max(a, b);
+            if (c >= v_max)
+                return v_min;
+            if (c <= v_min)
+                return v_max;
+            return a + b - c;
+        }
+
+
+        /// Maps signed residuals (two's complement) to unsigned values (0, -1, 1, -2, ...).
+        inline uint32_t zigzag(uint32_t d)
+        {
+            return (d << 1) ^ (0u - (d >> 31));
+        }
+
+
+        inline uint32_t unzigzag(uint32_t z)
+        {
+            return (z >> 1) ^ (0u - (z & 1));
+        }
+
+
+        void encodeStrip(const cv::Mat &depth, int y_begin, int y_end, std::vector<unsigned char> &data)
+        {
+            const int w = depth.cols;
+            std::vector<uint32_t> residuals(static_cast<size_t>(w));
+            BitWriter writer(data);
+            for (int y = y_begin; y < y_end; ++y)
+            {
+                // (float bit patterns of positive values are ordered like the values)
+                const uint32_t* row = depth.ptr<uint32_t>(y);
+                const uint32_t* row_above = y > y_begin ? depth.ptr<uint32_t>(y - 1) : nullptr;
+                for (int x = 0; x < w; ++x)
+                    residuals[static_cast<size_t>(x)] = zigzag(row[x] - predict(row, row_above, x));
+
+                for (int x0 = 0; x0 < w; x0 += DepthCodecEncoder::BlockSize)
+                {
+                    // Golomb-Rice parameter: smallest k with n * 2^k >= sum of residuals
+                    const int x1 = std::min(w, x0 + DepthCodecEncoder::BlockSize);
+                    uint64_t sum = 0;
+                    for (int x = x0; x < x1; ++x)
+                        sum += residuals[static_cast<size_t>(x)];
+                    int k = 0;
+                    while (k < 31 && (static_cast<uint64_t>(x1 - x0) << k) < sum)
+                        ++k;
+                    writer.put(static_cast<uint32_t>(k), 5);
+
+                    for (int x = x0; x < x1; ++x)
+                    {
+                        const uint32_t r = residuals[static_cast<size_t>(x)];
+                        const uint32_t q = r >> k;
+                        if (q < RiceEscape)
+                        {
+                            // unary quotient (q ones and a zero) and k remainder bits
+                            writer.put((1u << q) - 1, static_cast<int>(q) + 1);
+                            if (k > 0)
+                                writer.put(r & ((1u << k) - 1), k);
+                        }
+                        else
+                        {
+                            writer.put((1u << RiceEscape) - 1, static_cast<int>(RiceEscape));
+                            writer.put(r, 32);
+                        }
+                    }
+                }
+            }
+            writer.flush();
+        }
+
+
+        void decodeStrip(const unsigned char* data, size_t size, int y_begin, int y_end, cv::Mat &depth)
+        {
+            const int w = depth.cols;
+            BitReader reader(data, size);
+            for (int y = y_begin; y < y_end; ++y)
+            {
+                uint32_t* row = depth.ptr<uint32_t>(y);
+                const uint32_t* row_above = y > y_begin ? depth.ptr<uint32_t>(y - 1) : nullptr;
+                for (int x0 = 0; x0 < w; x0 += DepthCodecEncoder::BlockSize)
+                {
+                    const int x1 = std::min(w, x0 + DepthCodecEncoder::BlockSize);
+                    const int k = static_cast<int>(reader.get(5));
+                    for (int x = x0; x < x1; ++x)
+                    {
+                        const uint32_t q = reader.getUnary(RiceEscape);
+                        uint32_t r;
+                        if (q < RiceEscape)
+                            r = (q << k) | (k > 0 ? reader.get(k) : 0);
+                        else
+                            r = reader.get(32);
+                        row[x] = predict(row, row_above, x) + unzigzag(r);
+                    }
+                }
+            }
+        }
+
+
+        void putUInt32(std::vector<unsigned char> &data, size_t offset, uint32_t value)
+        {
+            for (int i = 0; i < 4; ++i)
+                data[offset + static_cast<size_t>(i)] = static_cast<unsigned char>(value >> (8 * i));
+        }
+
+
+        uint32_t getUInt32(const std::vector<unsigned char> &data, size_t offset)
+        {
+            uint32_t value = 0;
+            for (int i = 0; i < 4; ++i)
+                value |= static_cast<uint32_t>(data[offset + static_cast<size_t>(i)]) << (8 * i);
+            return value;
+        }
+
+    } // namespace
+
+
+    std::string DepthCodecEncoder::extension(int /*type*/) const
+    {
+        return ".mdc";
+    }
+
+
+    bool DepthCodecEncoder::encode(const cv::Mat &depth, std::vector<unsigned char> &data) const
+    {
+        if (depth.empty() || depth.type() != CV_32FC1)
+        {
+            std::cerr << "depth codec supports float depth maps only!" << std::endl;
+            return false;
+        }
+
+        // encode strips of rows in parallel
+        const int h = depth.rows;
+        const size_t num_strips = static_cast<size_t>((h + StripRows - 1) / StripRows);
+        std::vector<std::vector<unsigned char> > strips(num_strips);
+        parallelFor(0, num_strips, [&](size_t s0, size_t s1)
+        {
+            for (size_t s = s0; s < s1; ++s)
+            {
+                const int y = static_cast<int>(s) * StripRows;
+                encodeStrip(depth, y, std::min(h, y + StripRows), strips[s]);
+            }
+        });
+
+        // header (magic number, width, height, rows per strip, number of strips and
+        // strip sizes, little endian) followed by the strips
+        const size_t header_size = 4 + 4 * 4 + 4 * num_strips;
+        size_t size = header_size;
+        for (size_t s = 0; s < num_strips; ++s)
+            size += strips[s].size();
+        data.resize(size);
+        std::memcpy(data.data(), DepthCodecMagic, 4);
+        putUInt32(data, 4, static_cast<uint32_t>(depth.cols));
+        putUInt32(data, 8, static_cast<uint32_t>(h));
+        putUInt32(data, 12, static_cast<uint32_t>(StripRows));
+        putUInt32(data, 16, static_cast<uint32_t>(num_strips));
+        size_t offset = header_size;
+        for (size_t s = 0; s < num_strips; ++s)
+        {
+            putUInt32(data, 20 + 4 * s, static_cast<uint32_t>(strips[s].size()));
+            if (!strips[s].empty())
+                std::memcpy(&data[offset], strips[s].data(), strips[s].size());
+            offset += strips[s].size();
+        }
+
+        return true;
+    }
+
+
+    bool DepthCodecEncoder::decode(const std::vector<unsigned char> &data, cv::Mat &depth)
+    {
+        if (data.size() < 20 || std::memcmp(data.data(), DepthCodecMagic, 4) != 0)
+        {
+            std::cerr << "invalid depth codec data!" << std::endl;
+            return false;
+        }
+        const int w = static_cast<int>(getUInt32(data, 4));
+        const int h = static_cast<int>(getUInt32(data, 8));
+        const int strip_rows = static_cast<int>(getUInt32(data, 12));
+        const size_t num_strips = getUInt32(data, 16);
+        if (w <= 0 || h <= 0 || strip_rows <= 0 ||
+            num_strips != static_cast<size_t>((h + strip_rows - 1) / strip_rows) ||
+            data.size() < 20 + 4 * num_strips)
+        {
+            std::cerr << "invalid depth codec data!" << std::endl;
+            return false;
+        }
+
+        // strip offsets
+        std::vector<size_t> offsets(num_strips + 1, 20 + 4 * num_strips);
+        for (size_t s = 0; s < num_strips; ++s)
+            offsets[s + 1] = offsets[s] + getUInt32(data, 20 + 4 * s);
+        if (offsets[num_strips] > data.size())
+        {
+            std::cerr << "invalid depth codec data!" << std::endl;
+            return false;
+        }
+
+        // decode strips in parallel
+        depth.create(h, w, CV_32FC1);
+        parallelFor(0, num_strips, [&](size_t s0, size_t s1)
+        {
+            for (size_t s = s0; s < s1; ++s)
+            {
+                const int y = static_cast<int>(s) * strip_rows;
+                decodeStrip(data.data() + offsets[s], offsets[s + 1] - offsets[s],
+                            y, std::min(h, y + strip_rows), depth);
+            }
+        });
+
+        return true;
+    }
+
+
+    bool DepthCodecEncoder::load(const std::string &filename, cv::Mat &depth)
+    {
+        std::ifstream in_file(filename.c_str(), std::ios::binary);
+        if (!in_file.is_open())
+            return false;
+        std::vector<unsigned char> data((std::istreambuf_iterator<char>(in_file)), std::istreambuf_iterator<char>());
+        return decode(data, depth);
+    }
+
+} // namespace menderer
@@ -0,0 +1,320 @@
+/**
+* This file is part of Menderer.
+*
+* Copyright 2019 Robert Maier, Technical University of Munich.
+* For more information see <https://github.com/robmaier/menderer>.
+*
+* Menderer is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* Menderer is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with Menderer. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <menderer/frame_archive.h>
+
+#include <cstring>
+#include <iostream>
+
+#include <menderer/encoder.h>
+
+
+namespace menderer
+{
+
+    namespace
+    {
+
+        // archive layout (little endian):
+        // file header:  "MFA1", uint32 version
+        // chunks:       "MFCH", uint64 frame, uint64 size, uint32 channel length, channel, data
+        // index:        "MIDX", per chunk: uint64 frame, uint64 offset, uint64 size,
+        //               uint32 channel length, channel
+        // footer:       uint64 index offset, uint64 number of entries, "MFAE"
+        const char ArchiveMagic[4] = {'M', 'F', 'A', '1'};
+        const char ChunkMagic[4] = {'M', 'F', 'C', 'H'};
+        const char IndexMagic[4] = {'M', 'I', 'D', 'X'};
+        const char FooterMagic[4] = {'M', 'F', 'A', 'E'};
+        const uint32_t ArchiveVersion = 1;
+        const uint64_t FileHeaderSize = 8;
+        const uint64_t ChunkHeaderSize = 24;
+        const uint64_t IndexEntrySize = 28;
+        const uint64_t FooterSize = 20;
+
+
+        void appendUInt(std::string &buffer, uint64_t value, int num_bytes)
+        {
+            for (int i = 0; i < num_bytes; ++i)
+                buffer.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+        }
+
+
+        uint64_t readUInt(const char* ptr, int num_bytes)
+        {
+            uint64_t value = 0;
+            for (int i = 0; i < num_bytes; ++i)
+                value |= static_cast<uint64_t>(static_cast<unsigned char>(ptr[i])) << (8 * i);
+            return value;
+        }
+
+    } // namespace
+
+
+    FrameArchiveWriter::FrameArchiveWriter() :
+        offset_(0)
+    {
+    }
+
+
+    FrameArchiveWriter::~FrameArchiveWriter()
+    {
+        close();
+    }
+
+
+    bool FrameArchiveWriter::open(const std::string &filename)
+    {
+        close();
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        file_.open(filename.c_str(), std::ios::binary | std::ios::trunc);
+        if (!file_.is_open())
+        {
+            std::cerr << "could not create frame archive " << filename << "!" << std::endl;
+            return false;
+        }
+
+        std::string header(ArchiveMagic, 4);
+        appendUInt(header, ArchiveVersion, 4);
+        file_.write(header.data(), static_cast<std::streamsize>(header.size()));
+        offset_ = FileHeaderSize;
+        entries_.clear();
+        return file_.good();
+    }
+
+
+    bool FrameArchiveWriter::write(size_t frame, const std::string &channel, const std::vector<unsigned char> &data)
+    {
+        // chunk header
+        std::string header(ChunkMagic, 4);
+        appendUInt(header, frame, 8);
+        appendUInt(header, data.size(), 8);
+        appendUInt(header, channel.size(), 4);
+        header += channel;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!file_.is_open())
+            return false;
+
+        // append chunk and flush it, so that it survives an interrupted run
+        file_.write(header.data(), static_cast<std::streamsize>(header.size()));
+        file_.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+        file_.flush();
+
+        FrameArchiveEntry entry;
+        entry.frame = frame;
+        entry.channel = channel;
+        entry.offset = offset_ + header.size();
+        entry.size = data.size();
+        entries_.push_back(entry);
+        offset_ = entry.offset + entry.size;
+
+        return file_.good();
+    }
+
+
+    bool FrameArchiveWriter::close()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!file_.is_open())
+            return true;
+
+        // trailing index and footer
+        std::string index(IndexMagic, 4);
+        for (size_t i = 0; i < entries_.size(); ++i)
+        {
+            const FrameArchiveEntry &entry = entries_[i];
+            appendUInt(index, entry.frame, 8);
+            appendUInt(index, entry.offset, 8);
+            appendUInt(index, entry.size, 8);
+            appendUInt(index, entry.channel.size(), 4);
+            index += entry.channel;
+        }
+        appendUInt(index, offset_, 8);
+        appendUInt(index, entries_.size(), 8);
+        index.append(FooterMagic, 4);
+        file_.write(index.data(), static_cast<std::streamsize>(index.size()));
+
+        file_.close();
+        entries_.clear();
+        return !file_.fail();
+    }
+
+
+    bool FrameArchiveWriter::isOpen() const
+    {
+        return file_.is_open();
+    }
+
+
+    FrameArchiveReader::FrameArchiveReader() :
+        complete_(false)
+    {
+    }
+
+
+    FrameArchiveReader::~FrameArchiveReader()
+    {
+        close();
+    }
+
+
+    bool FrameArchiveReader::open(const std::string &filename)
+    {
+        close();
+        if (!file_.open(filename))
+            return false;
+        if (file_.size() < FileHeaderSize || std::memcmp(file_.data(), ArchiveMagic, 4) != 0)
+        {
+            std::cerr << "invalid frame archive " << filename << "!" << std::endl;
+            close();
+            return false;
+        }
+
+        // read index, or recover it from the chunks if the archive was not closed
+        complete_ = readIndex();
+        if (!complete_)
+            scanChunks();
+
+        for (size_t i = 0; i < entries_.size(); ++i)
+            lookup_[std::make_pair(entries_[i].frame, entries_[i].channel)] = i;
+        return true;
+    }
+
+
+    void FrameArchiveReader::close()
+    {
+        file_.close();
+        entries_.clear();
+        lookup_.clear();
+        complete_ = false;
+    }
+
+
+    const std::vector<FrameArchiveEntry>& FrameArchiveReader::entries() const
+    {
+        return entries_;
+    }
+
+
+    bool FrameArchiveReader::complete() const
+    {
+        return complete_;
+    }
+
+
+    const FrameArchiveEntry* FrameArchiveReader::find(size_t frame, const std::string &channel) const
+    {
+        auto it = lookup_.find(std::make_pair(static_cast<uint64_t>(frame), channel));
+        if (it == lookup_.end())
+            return nullptr;
+        return &entries_[it->second];
+    }
+
+
+    const unsigned char* FrameArchiveReader::data(const FrameArchiveEntry &entry) const
+    {
+        return reinterpret_cast<const unsigned char*>(file_.data() + entry.offset);
+    }
+
+
+    bool FrameArchiveReader::read(size_t frame, const std::string &channel, std::vector<unsigned char> &data) const
+    {
+        const FrameArchiveEntry* entry = find(frame, channel);
+        if (!entry)
+            return false;
+        const unsigned char* ptr = this->data(*entry);
+        data.assign(ptr, ptr + entry->size);
+        return true;
+    }
+
+
+    bool FrameArchiveReader::read(size_t frame, const std::string &channel, cv::Mat &img) const
+    {
+        std::vector<unsigned char> data;
+        const size_t pos_ext = channel.rfind('.');
+        if (pos_ext == std::string::npos || !read(frame, channel, data))
+            return false;
+        return Encoder::decode(channel.substr(pos_ext), data, img);
+    }
+
+
+    bool FrameArchiveReader::readIndex()
+    {
+        const char* data = file_.data();
+        const uint64_t size = file_.size();
+        if (size < FileHeaderSize + 4 + FooterSize ||
+            std::memcmp(data + size - 4, FooterMagic, 4) != 0)
+            return false;
+
+        const uint64_t index_offset = readUInt(data + size - FooterSize, 8);
+        const uint64_t num_entries = readUInt(data + size - FooterSize + 8, 8);
+        if (index_offset < FileHeaderSize || index_offset + 4 > size - FooterSize ||
+            std::memcmp(data + index_offset, IndexMagic, 4) != 0)
+            return false;
+
+        uint64_t pos = index_offset + 4;
+        const uint64_t end = size - FooterSize;
+        std::vector<FrameArchiveEntry> entries;
+        for (uint64_t i = 0; i < num_entries; ++i)
+        {
+            if (pos + IndexEntrySize > end)
+                return false;
+            FrameArchiveEntry entry;
+            entry.frame = readUInt(data + pos, 8);
+            entry.offset = readUInt(data + pos + 8, 8);
+            entry.size = readUInt(data + pos + 16, 8);
+            const uint64_t channel_size = readUInt(data + pos + 24, 4);
+            pos += IndexEntrySize;
+            if (pos + channel_size > end || entry.offset + entry.size > index_offset)
+                return false;
+            entry.channel.assign(data + pos, channel_size);
+            pos += channel_size;
+            entries.push_back(entry);
+        }
+
+        entries_.swap(entries);
+        return true;
+    }
+
+
+    void FrameArchiveReader::scanChunks()
+    {
+        const char* data = file_.data();
+        const uint64_t size = file_.size();
+        uint64_t pos = FileHeaderSize;
+        entries_.clear();
+        while (pos + ChunkHeaderSize <= size && std::memcmp(data + pos, ChunkMagic, 4) == 0)
+        {
+            FrameArchiveEntry entry;
+            entry.frame = readUInt(data + pos + 4, 8);
+            entry.size = readUInt(data + pos + 12, 8);
+            const uint64_t channel_size = readUInt(data + pos + 20, 4);
+            entry.offset = pos + ChunkHeaderSize + channel_size;
+            // (stop at an incompletely written chunk)
+            if (entry.offset > size || entry.size > size - entry.offset)
+                break;
+            entry.channel.assign(data + pos + ChunkHeaderSize, channel_size);
+            entries_.push_back(entry);
+            pos = entry.offset + entry.size;
+        }
+    }
+
+} // namespace menderer
@@ -0,0 +1,106 @@
+/**
+* This file is part of Menderer.
+*
+* Copyright 2019 Robert Maier, Technical University of Munich.
+* For more information see <https://github.com/robmaier/menderer>.
+*
+* Menderer is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* Menderer is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with Menderer. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <menderer/frame_pool.h>
+
+#include <cstdlib>
+#include <cstring>
+
+#ifndef _WIN32
+#include <unistd.h>
+#else
+#include <malloc.h>
+#endif
+
+
+namespace menderer
+{
+
+    FramePool::FramePool(int width, int height, size_t num_frames, bool color) :
+        width_(width),
+        height_(height),
+        frames_(num_frames),
+        blocks_(),
+        next_(0)
+    {
+        for (size_t i = 0; i < frames_.size(); ++i)
+        {
+            Frame &frame = frames_[i];
+            if (color)
+                frame.color = allocate(CV_8UC3);
+            frame.depth = allocate(CV_32FC1);
+        }
+    }
+
+
+    FramePool::~FramePool()
+    {
+        frames_.clear();
+        for (size_t i = 0; i < blocks_.size(); ++i)
+        {
+#ifndef _WIN32
+            free(blocks_[i]);
+#else
+            _aligned_free(blocks_[i]);
+#endif
+        }
+    }
+
+
+    FramePool::Frame& FramePool::next()
+    {
+        Frame &frame = frames_[next_];
+        next_ = (next_ + 1) % frames_.size();
+        return frame;
+    }
+
+
+    size_t FramePool::size() const
+    {
+        return frames_.size();
+    }
+
+
+    cv::Mat FramePool::allocate(int type)
+    {
+        const size_t byte_size = static_cast<size_t>(width_) * static_cast<size_t>(height_) * CV_ELEM_SIZE(type);
+        if (byte_size == 0)
+            return cv::Mat();
+
+        // page-aligned memory
+        void* data = nullptr;
+#ifndef _WIN32
+        const long page_size = sysconf(_SC_PAGESIZE);
+        if (posix_memalign(&data, static_cast<size_t>(page_size > 0 ? page_size : 4096), byte_size) != 0)
+            data = nullptr;
+#else
+        data = _aligned_malloc(byte_size, 4096);
+#endif
+        if (!data)
+            return cv::Mat();
+        blocks_.push_back(data);
+
+        // touch all pages once (no page faults when rendering into the image)
+        std::memset(data, 0, byte_size);
+
+        return cv::Mat(height_, width_, type, data);
+    }
+
+} // namespace menderer
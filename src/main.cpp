@@ -20,9 +20,11 @@
 
 #include <menderer/mat.h>
 
+#include <algorithm>
 #include <iomanip>
 #include <iostream>
 #include <memory>
+#include <vector>
 
 #include <CLI/CLI.hpp>
 #include <opencv2/core.hpp>
@@ -30,11 +32,20 @@
 
 #include <menderer/camera.h>
 #include <menderer/dataset.h>
+#include <menderer/depth_tensor.h>
+#include <menderer/encoder.h>
+#include <menderer/frame_archive.h>
+#include <menderer/frame_pool.h>
 #include <menderer/mesh.h>
+#include <menderer/mesh_cache.h>
 #include <menderer/mesh_util.h>
+#include <menderer/output_stage.h>
 #include <menderer/ply_io.h>
+#include <menderer/renderer.h>
 #include <menderer/scene.h>
 #include <menderer/trajectory.h>
+#include <menderer/cpu/raster_scene.h>
+#include <menderer/cpu/raycast_scene.h>
 #include <menderer/ogl/ogl.h>
 #include <menderer/ogl/mesh_renderer.h>
 
@@ -63,6 +74,10 @@ int main(int argc, char *argv[])
     std::string mesh_file;
     app.add_option("-m,--mesh", mesh_file, "Input mesh file")
             ->required()->check(CLI::ExistingFile);
+    bool cache_mesh = false;
+    app.add_flag("--cache_mesh", cache_mesh, "Cache preprocessed mesh next to the input mesh (.mmesh)");
+    bool optimize_mesh = false;
+    app.add_flag("--optimize_mesh", optimize_mesh, "Optimize triangle and vertex order for rendering");
     // output folder
     int max_frames = 0;
     app.add_option("--max_frames", max_frames, "Maximum number of input frames to process");
@@ -79,6 +94,25 @@ int main(int argc, char *argv[])
     app.add_flag("--save_depth_binary", save_depth_bin, "Save rendered depth (binary)");
     bool save_mesh;
     app.add_flag("--save_mesh", save_mesh, "Save rendered depth as mesh (.ply)");
+    // output encoders (per output channel)
+    std::string color_format = "png";
+    app.add_set("--color_format", color_format, {"png", "pnm", "raw"},
+                "Format of saved color images (default: png)");
+    std::string depth_format;
+    app.add_set("--depth_format", depth_format, {"png", "pnm", "raw", "codec"},
+                "Save rendered depth in the specified format (--save_depth_png: png)");
+    int png_compression = -1;
+    app.add_option("--png_compression", png_compression, "PNG compression level (0-9, default: -1 for OpenCV default)")
+            ->check(CLI::Range(-1, 9));
+    bool save_depth_tensor = false;
+    app.add_flag("--save_depth_tensor", save_depth_tensor,
+                 "Save rendered depth of all frames as single memory-mapped N x H x W float32 array (depth.npy)");
+    bool archive_output = false;
+    app.add_flag("--archive", archive_output, "Save all outputs into a single frame archive (render.mfa)");
+    int output_threads = 4;
+    app.add_option("--output_threads", output_threads,
+                   "Number of threads encoding and writing output files in the background (default: 4, 0: synchronous)")
+            ->check(CLI::Range(0, 256));
 
     // GUI parameters
     bool gui = false;
@@ -89,6 +123,17 @@ int main(int argc, char *argv[])
     // renderer parameters
     menderer::ogl::MeshRenderer::Config renderer_cfg;
 
+    // rendering backend
+    std::string backend = "gl";
+    app.add_set("--backend", backend, {"gl", "raycast", "raster"}, "Rendering backend (default: gl)");
+    // number of poses rendered at once
+    int batch_size = 1;
+    app.add_option("--batch_size", batch_size, "Number of poses rendered in one pass (default: 1)")
+            ->check(CLI::Range(1, 4096));
+    // pipelined rendering and readback
+    bool pipelined = false;
+    app.add_flag("--pipelined", pipelined, "Read back rendered frames asynchronously while rendering the next frames");
+
     // initialize and configure mesh scene
     // mesh color
     float color_r = 1.0f;
@@ -117,6 +162,24 @@ int main(int argc, char *argv[])
     // "none", "normals_phong", "phong"
     renderer_cfg.shader = "normals_phong";
     app.add_option("--shader", renderer_cfg.shader, "OpenGL rendering shader (default: normals_phong)");
+    // level of detail
+    app.add_option("--lod_pixel_error", renderer_cfg.lod_pixel_error,
+                   "Maximum screen-space error (pixels) for rendering simplified levels of detail (default: 0, disabled)");
+    // culling
+    renderer_cfg.cull_clusters = false;
+    app.add_flag("--cull_clusters", renderer_cfg.cull_clusters, "Enable view frustum culling of triangle clusters");
+    renderer_cfg.cull_occlusion = false;
+    app.add_flag("--cull_occlusion", renderer_cfg.cull_occlusion,
+                 "Enable occlusion culling of triangle clusters (using the previous frame's depth)");
+    renderer_cfg.cull_backfaces = false;
+    app.add_flag("--cull_backfaces", renderer_cfg.cull_backfaces, "Enable backface culling (of triangles and clusters)");
+    renderer_cfg.core_profile = false;
+    app.add_flag("--core_profile", renderer_cfg.core_profile, "Render with an OpenGL 3.3 core profile context");
+    renderer_cfg.depth_only = false;
+    app.add_flag("--depth_only", renderer_cfg.depth_only, "Render depth only (no color shading, blending and readback)");
+    renderer_cfg.geometry_buffers = false;
+    app.add_flag("--geometry_buffers", renderer_cfg.geometry_buffers,
+                 "Render vertex/normal maps, triangle ids and barycentrics in the same pass (saved as .bin)");
 
     // parse command line arguments
     CLI11_PARSE(app, argc, argv);
@@ -129,8 +192,17 @@ int main(int argc, char *argv[])
         renderer_cfg.lighting = true;
     renderer_cfg.print();
 
-    // create OpenGL context
-    if (!menderer::ogl::createContext())
+    // create output encoders
+    if (save_depth_png && depth_format.empty())
+        depth_format = "png";
+    std::unique_ptr<menderer::Encoder> color_encoder = menderer::Encoder::create(color_format, png_compression);
+    std::unique_ptr<menderer::Encoder> depth_encoder;
+    if (!depth_format.empty())
+        depth_encoder = menderer::Encoder::create(depth_format, png_compression);
+
+    // create OpenGL context (not needed by CPU backends)
+    const bool use_gl = (backend == "gl");
+    if (use_gl && !menderer::ogl::createContext(renderer_cfg.core_profile))
     {
         std::cerr << "could not create OpenGL context!" << std::endl;
         return 1;
@@ -170,29 +242,83 @@ int main(int argc, char *argv[])
     //trajectory.print();
     std::cout << "trajectory: " << trajectory.size() << " poses" << std::endl;
 
-    // load mesh from ply file
-    menderer::Mesh mesh;
-    if (!menderer::PlyIO::load(mesh_file, mesh))
+    // create and configure scene for the rendering backend
+    std::unique_ptr<menderer::Renderer> scene;
+    menderer::Scene* gl_scene = nullptr;
+    if (backend == "raycast")
     {
-        std::cerr << "could not load mesh!" << std::endl;
-        return 1;
+        scene.reset(new menderer::cpu::RaycastScene(camera, renderer_cfg));
+    }
+    else if (backend == "raster")
+    {
+        scene.reset(new menderer::cpu::RasterScene(camera, renderer_cfg));
+    }
+    else
+    {
+        gl_scene = new menderer::Scene(camera, renderer_cfg);
+        scene.reset(gl_scene);
+    }
+    std::cout << "rendering backend: " << backend << std::endl;
+
+    // geometry buffers are rendered with single frames of the OpenGL backend (depth-only rendering takes precedence)
+    bool render_geometry = renderer_cfg.geometry_buffers && gl_scene && batch_size == 1 && !pipelined &&
+            !renderer_cfg.depth_only;
+    if (renderer_cfg.geometry_buffers && renderer_cfg.depth_only)
+        std::cerr << "geometry buffers are not rendered in depth-only mode!" << std::endl;
+    else if (renderer_cfg.geometry_buffers && !render_geometry)
+        std::cerr << "geometry buffers are only rendered by the gl backend without batches and pipelining!" << std::endl;
+    if (render_geometry && !gl_scene->writesGeometryBuffers())
+    {
+        // (vertex maps are computed from depth instead)
+        std::cerr << "geometry buffers are not supported by the OpenGL context!" << std::endl;
+        render_geometry = false;
     }
-    mesh.print();
 
-    if (mesh.normals.empty())
+    // map preprocessed mesh from cache (if enabled and up-to-date)
+    menderer::MeshCache mesh_cache;
+    const unsigned int cache_flags = optimize_mesh ? menderer::MeshCache::Optimized : menderer::MeshCache::None;
+    if (cache_mesh && mesh_cache.open(mesh_file, cache_flags))
     {
-        // compute mesh normals for rendering (if not present)
-        std::cout << "compressing mesh vertices ..." << std::endl;
-        menderer::MeshUtil::compressVertices(mesh);
-        std::cout << "computing mesh normals ..." << std::endl;
-        menderer::MeshUtil::computeVertexNormals(mesh);
-        mesh.print();
+        std::cout << "loaded mesh from cache " << menderer::MeshCache::filename(mesh_file) << std::endl;
+        // upload mesh to renderer
+        scene->upload(mesh_cache.view());
+        mesh_cache.close();
     }
+    else
+    {
+        // load mesh from ply file
+        menderer::Mesh mesh;
+        if (!menderer::PlyIO::load(mesh_file, mesh))
+        {
+            std::cerr << "could not load mesh!" << std::endl;
+            return 1;
+        }
+        mesh.print();
 
-    // create and configure scene
-    menderer::Scene scene(camera, renderer_cfg);
-    // upload mesh to GPU
-    scene.upload(mesh);
+        if (mesh.normals.empty())
+        {
+            // compute mesh normals for rendering (if not present)
+            std::cout << "compressing mesh vertices ..." << std::endl;
+            menderer::MeshUtil::compressVertices(mesh);
+            std::cout << "computing mesh normals ..." << std::endl;
+            menderer::MeshUtil::computeVertexNormals(mesh);
+            mesh.print();
+        }
+
+        if (optimize_mesh)
+        {
+            // optimize mesh for vertex cache, overdraw and vertex fetch
+            std::cout << "optimizing mesh for rendering ..." << std::endl;
+            menderer::MeshUtil::optimizeForRendering(mesh);
+        }
+
+        // store preprocessed mesh in cache
+        if (cache_mesh && !menderer::MeshCache::save(mesh_file, mesh, cache_flags))
+            std::cerr << "could not write mesh cache!" << std::endl;
+
+        // upload mesh to renderer
+        scene->upload(mesh);
+    }
 
     if (gui)
     {
@@ -209,65 +335,145 @@ int main(int argc, char *argv[])
 
     // render mesh into target camera poses
     size_t num_frames = trajectory.size();
+    if (max_frames > 0)
+        num_frames = std::min(num_frames, static_cast<size_t>(max_frames));
     std::cout << "rendering " << num_frames << " frames ..." << std::endl;
-    for (size_t i = 0; i < num_frames; ++i)
+    bool stop = false;
+    // frame archive replacing the individual output files
+    std::unique_ptr<menderer::FrameArchiveWriter> archive;
+    if (archive_output && !output_folder.empty())
     {
-        if (max_frames > 0 && i >= static_cast<size_t>(max_frames))
-            break;
+        archive.reset(new menderer::FrameArchiveWriter());
+        if (!archive->open(output_folder + "/render.mfa"))
+            return 1;
+    }
+    // depth of all frames in a single memory-mapped N x H x W array
+    std::unique_ptr<menderer::DepthTensor> depth_tensor;
+    if (save_depth_tensor && !output_folder.empty())
+    {
+        depth_tensor.reset(new menderer::DepthTensor());
+        if (!depth_tensor->create(output_folder + "/depth.npy", num_frames, camera.width(), camera.height()))
+            return 1;
+    }
+    // raw encoder for depth .bin files and geometry buffers
+    const menderer::RawEncoder bin_encoder(false);
+    // output stage encoding and writing frames in the background (synchronous without threads)
+    std::unique_ptr<menderer::OutputStage> output_stage;
+    if (output_threads > 0 && !output_folder.empty())
+        output_stage.reset(new menderer::OutputStage(static_cast<size_t>(output_threads)));
+    // output buffers reused across frames (no allocations in the steady-state render loop),
+    // one more than pending output jobs so that rendering does not wait for a buffer in use
+    const size_t num_pooled = output_stage ? output_stage->maxPending() + 1 : 1;
+    menderer::FramePool frame_pool(camera.width(), camera.height(), num_pooled, !renderer_cfg.depth_only);
+    std::vector<menderer::Scene::GeometryBuffers> rendered_geometry(num_pooled);
+    std::vector<size_t> pooled_jobs(num_pooled, 0);     // output jobs to complete before reusing a buffer
+    size_t num_pooled_frames = 0;
+    const menderer::Scene::GeometryBuffers no_geometry;
+    auto process_frame_geometry = [&](size_t i, const cv::Mat &rendered_color, const cv::Mat &rendered_depth,
+                                      const menderer::Scene::GeometryBuffers &geometry) -> size_t
+    {
+        // (returns the number of output jobs to complete before the images may be modified)
+        if (stop)
+            return 0;
 
         std::cout << "   frame " << (i + 1) << " of " << num_frames << std::endl;
+        size_t num_jobs = 0;
 
-        // render mesh into current target pose
-        menderer::Mat4 pose_world_to_cam = trajectory.pose(i).inverse();
-        cv::Mat rendered_color, rendered_depth;
-        if (!scene.render(pose_world_to_cam, rendered_color, rendered_depth))
+        // copy depth into the tensor unless it was read back into its slice
+        if (depth_tensor)
         {
-            std::cerr << "   could not render frame " << (i + 1) << "!" << std::endl;
-            continue;
+            cv::Mat depth_slice = depth_tensor->frame(i);
+            if (rendered_depth.data != depth_slice.data)
+                rendered_depth.copyTo(depth_slice);
         }
 
         if (!output_folder.empty())
         {
-            // store rendered frame
-            std::stringstream ss;
-            ss << output_folder;
-            ss << "/render_" << std::setfill ('0') << std::setw(6) << i;
-            std::string output_file_prefix = ss.str();
-
-            // save rendered color
-            std::string output_file_color = output_file_prefix + "-color.png";
-            std::cout << "   saving color to " << output_file_color << " ..." << std::endl;
-            menderer::Dataset::saveColor(output_file_color, rendered_color);
-
-            // save rendered depth
-            if (save_depth_png)
+            // store rendered frame (images are not modified until the job has completed)
+            menderer::OutputStage::Job save_frame = [&, i, rendered_color, rendered_depth, geometry]()
             {
-                std::string output_file_depth_png = output_file_prefix + "-depth.png";
-                std::cout << "   saving depth (.png) to " << output_file_depth_png << " ..." << std::endl;
-                menderer::Dataset::saveDepthPNG(output_file_depth_png, rendered_depth);
-            }
-            if (save_mesh)
-            {
-                // compute vertex map from depth
-                cv::Mat rendered_vertex_map;
-                dataset.depthToVertexMap(rendered_depth, rendered_vertex_map);
-                // compute mesh from rgb-d frame
-                menderer::Mesh mesh_rgbd;
-                if (menderer::MeshUtil::createFromRGBD(rendered_vertex_map, rendered_color,
-                                                       pose_world_to_cam.inverse(), mesh_rgbd))
+                menderer::Mat4 pose_world_to_cam = trajectory.pose(i).inverse();
+                std::stringstream ss;
+                ss << output_folder;
+                ss << "/render_" << std::setfill ('0') << std::setw(6) << i;
+                std::string output_file_prefix = ss.str();
+                // (messages are printed at once, jobs may run concurrently)
+                std::stringstream log;
+                bool ok = true;
+
+                // save an image with an encoder as file or into the frame archive
+                auto save_image = [&](const std::string &name, const cv::Mat &img, const menderer::Encoder &encoder) -> bool
+                {
+                    const std::string channel = name + encoder.extension(img.type());
+                    if (!archive)
+                    {
+                        const std::string output_file = output_file_prefix + "-" + channel;
+                        log << "   saving " << name << " to " << output_file << " ..." << std::endl;
+                        return menderer::Dataset::save(output_file, img, encoder);
+                    }
+                    log << "   saving " << name << " to archive (" << channel << ") ..." << std::endl;
+                    std::vector<unsigned char> data;
+                    return encoder.encode(img, data) && archive->write(i, channel, data);
+                };
+
+                // save rendered color (not rendered in depth-only mode)
+                if (!rendered_color.empty())
+                    ok = save_image("color", rendered_color, *color_encoder) && ok;
+
+                // save rendered depth
+                if (depth_encoder)
+                    ok = save_image("depth", rendered_depth, *depth_encoder) && ok;
+                if (save_mesh)
                 {
-                    // save mesh
-                    std::string output_file_ply = output_file_prefix + "-mesh.ply";
-                    std::cout << "   saving mesh (.ply) to " << output_file_ply << " ..." << std::endl;
-                    menderer::PlyIO::save(output_file_ply, mesh_rgbd, false);
+                    // compute vertex map from depth (unless rendered as geometry buffer)
+                    cv::Mat rendered_vertex_map = geometry.vertex_map;
+                    if (rendered_vertex_map.empty())
+                        dataset.depthToVertexMap(rendered_depth, rendered_vertex_map);
+                    // compute mesh from rgb-d frame
+                    menderer::Mesh mesh_rgbd;
+                    if (menderer::MeshUtil::createFromRGBD(rendered_vertex_map, rendered_color,
+                                                           pose_world_to_cam.inverse(), mesh_rgbd))
+                    {
+                        // save mesh
+                        if (!archive)
+                        {
+                            std::string output_file_ply = output_file_prefix + "-mesh.ply";
+                            log << "   saving mesh (.ply) to " << output_file_ply << " ..." << std::endl;
+                            ok = menderer::PlyIO::save(output_file_ply, mesh_rgbd) && ok;
+                        }
+                        else
+                        {
+                            log << "   saving mesh to archive (mesh.ply) ..." << std::endl;
+                            std::ostringstream ply;
+                            const bool ok_ply = menderer::PlyIO::save(ply, mesh_rgbd);
+                            const std::string ply_data = ply.str();
+                            ok = ok_ply && archive->write(i, "mesh.ply", std::vector<unsigned char>(ply_data.begin(), ply_data.end())) && ok;
+                        }
+                    }
                 }
-            }
-            if (save_depth_bin)
-            {
-                std::string output_file_depth_bin = output_file_prefix + "-depth.bin";
-                std::cout << "   saving depth (.bin) to " << output_file_depth_bin << " ..." << std::endl;
-                menderer::Dataset::saveDepthBinary(output_file_depth_bin, rendered_depth);
-            }
+                if (save_depth_bin)
+                    ok = save_image("depth", rendered_depth, bin_encoder) && ok;
+                if (!geometry.vertex_map.empty())
+                {
+                    // save geometry buffers
+                    ok = save_image("vertices", geometry.vertex_map, bin_encoder) && ok;
+                    ok = save_image("normals", geometry.normal_map, bin_encoder) && ok;
+                    ok = save_image("faces", geometry.face_ids, bin_encoder) && ok;
+                    ok = save_image("barycentrics", geometry.barycentrics, bin_encoder) && ok;
+                }
+                if (!ok)
+                    log << "   could not save frame " << (i + 1) << "!" << std::endl;
+
+                if (ok)
+                    std::cout << log.str() << std::flush;
+                else
+                    std::cerr << log.str() << std::flush;
+                return ok;
+            };
+            if (output_stage)
+                num_jobs = output_stage->push(save_frame) + 1;
+            else
+                save_frame();
         }
 
         if (gui)
@@ -303,18 +509,85 @@ int main(int argc, char *argv[])
             int time_wait = gui_pause ? 0 : 30;
             int key = cv::waitKey(time_wait);
             if (key == 27)
-                break;
+                stop = true;
         }
 
+        return num_jobs;
+    };
+    menderer::Renderer::FrameCallback process_frame = [&](size_t i, const cv::Mat &rendered_color, const cv::Mat &rendered_depth)
+    {
+        process_frame_geometry(i, rendered_color, rendered_depth, no_geometry);
+    };
+
+    for (size_t i = 0; i < num_frames && !stop; i += static_cast<size_t>(batch_size))
+    {
+        if (batch_size > 1)
+        {
+            // render mesh into the target poses of the next batch
+            std::vector<menderer::Mat4> batch_poses;
+            for (size_t j = i; j < std::min(num_frames, i + static_cast<size_t>(batch_size)); ++j)
+                batch_poses.push_back(trajectory.pose(j).inverse());
+            std::vector<cv::Mat> rendered_colors, rendered_depths;
+            if (!scene->renderBatch(batch_poses, rendered_colors, rendered_depths))
+            {
+                std::cerr << "   could not render frames " << (i + 1) << " to " << (i + batch_poses.size()) << "!" << std::endl;
+                continue;
+            }
+            for (size_t j = 0; j < batch_poses.size(); ++j)
+                process_frame(i + j, rendered_colors[j], rendered_depths[j]);
+        }
+        else
+        {
+            // render mesh into current target pose
+            menderer::Mat4 pose_world_to_cam = trajectory.pose(i).inverse();
+            bool ok;
+            if (pipelined)
+            {
+                // (completed frames are processed while the next frames are rendered)
+                ok = scene->renderAsync(pose_world_to_cam, i, process_frame);
+            }
+            else
+            {
+                // (rendered into preallocated buffers, downloads reuse them)
+                // (buffers are reused in round-robin order, once written by the output stage)
+                const size_t slot = num_pooled_frames++ % num_pooled;
+                if (output_stage)
+                    output_stage->wait(pooled_jobs[slot]);
+                menderer::FramePool::Frame frame = frame_pool.next();
+                if (depth_tensor)
+                    frame.depth = depth_tensor->frame(i);   // (read back directly into the mapped tensor)
+                menderer::Scene::GeometryBuffers &geometry = rendered_geometry[slot];
+                if (render_geometry)
+                    ok = gl_scene->render(pose_world_to_cam, frame.color, frame.depth, geometry);
+                else
+                    ok = scene->render(pose_world_to_cam, frame);
+                if (ok)
+                    pooled_jobs[slot] = process_frame_geometry(i, frame.color, frame.depth,
+                                                               render_geometry ? geometry : no_geometry);
+            }
+            if (!ok)
+                std::cerr << "   could not render frame " << (i + 1) << "!" << std::endl;
+        }
     }
+    // process pending frames of pipelined rendering
+    scene->flush(process_frame);
+    // wait until all frames are written
+    if (output_stage && !output_stage->finish())
+        std::cerr << "could not save " << output_stage->numFailed() << " frames!" << std::endl;
+    if (archive && !archive->close())
+        std::cerr << "could not write frame archive index!" << std::endl;
+    if (depth_tensor && !depth_tensor->close())
+        std::cerr << "could not write depth tensor!" << std::endl;
     std::cout << "rendering finished (" << num_frames << " frames)" << std::endl;
 
     // clean up GUI
     if (gui)
         cv::destroyAllWindows();
 
-    // destroy OpenGL context
-    menderer::ogl::destroyContext();
+    // destroy scene and OpenGL context
+    scene.reset();
+    if (use_gl)
+        menderer::ogl::destroyContext();
 
     return 0;
 }
@@ -0,0 +1,132 @@
+/**
+* This file is part of Menderer.
+*
+* Copyright 2019 Robert Maier, Technical University of Munich.
+* For more information see <https://github.com/robmaier/menderer>.
+*
+* Menderer is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* Menderer is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with Menderer. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <menderer/mapped_file.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#endif
+
+
+namespace menderer
+{
+
+    MappedFile::MappedFile() :
+        data_(nullptr),
+        size_(0),
+        mapped_(false)
+    {
+    }
+
+
+    MappedFile::~MappedFile()
+    {
+        close();
+    }
+
+
+    bool MappedFile::open(const std::string &filename)
+    {
+        close();
+        if (filename.empty())
+            return false;
+
+#ifndef _WIN32
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0)
+        {
+            ::close(fd);
+            return false;
+        }
+        size_ = static_cast<size_t>(st.st_size);
+        if (size_ > 0)
+        {
+            void* ptr = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (ptr == MAP_FAILED)
+            {
+                ::close(fd);
+                size_ = 0;
+                return false;
+            }
+            // file is read front to back
+            madvise(ptr, size_, MADV_SEQUENTIAL);
+            data_ = static_cast<const char*>(ptr);
+            mapped_ = true;
+        }
+        // mapping stays valid after closing the file descriptor
+        ::close(fd);
+#else
+        // read whole file into memory
+        std::ifstream file(filename.c_str(), std::ios::binary | std::ios::ate);
+        if (!file.is_open())
+            return false;
+        buffer_.resize(static_cast<size_t>(file.tellg()));
+        file.seekg(0, std::ios::beg);
+        if (!buffer_.empty() && !file.read(&buffer_[0], static_cast<std::streamsize>(buffer_.size())))
+        {
+            buffer_.clear();
+            return false;
+        }
+        size_ = buffer_.size();
+        data_ = buffer_.empty() ? nullptr : &buffer_[0];
+#endif
+        return true;
+    }
+
+
+    void MappedFile::close()
+    {
+#ifndef _WIN32
+        if (mapped_)
+            munmap(const_cast<char*>(data_), size_);
+#endif
+        buffer_.clear();
+        data_ = nullptr;
+        size_ = 0;
+        mapped_ = false;
+    }
+
+
+    const char* MappedFile::data() const
+    {
+        return data_;
+    }
+
+
+    size_t MappedFile::size() const
+    {
+        return size_;
+    }
+
+
+    bool MappedFile::empty() const
+    {
+        return size_ == 0;
+    }
+
+} // namespace menderer
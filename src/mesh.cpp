@@ -27,6 +27,7 @@ namespace menderer
 
     void Mesh::clear()
     {
+        origin = Vec3::Zero();
         vertices.clear();
         normals.clear();
         colors.clear();
@@ -43,10 +44,28 @@ namespace menderer
     void Mesh::print() const
     {
         std::cout << "mesh data:" << std::endl;
+        if (!origin.isZero())
+            std::cout << "   origin: " << origin.transpose() << std::endl;
         std::cout << "   vertices: " << vertices.size() << std::endl;
         std::cout << "   normals: " << normals.size() << std::endl;
         std::cout << "   colors: " << colors.size() << std::endl;
         std::cout << "   faces: " << face_vertices.size() << std::endl;
     }
 
+
+    MeshView Mesh::view() const
+    {
+        MeshView v;
+        v.origin = origin;
+        v.vertices = vertices.data();
+        v.num_vertices = vertices.size();
+        v.normals = normals.data();
+        v.num_normals = normals.size();
+        v.colors = colors.data();
+        v.num_colors = colors.size();
+        v.face_vertices = face_vertices.data();
+        v.num_faces = face_vertices.size();
+        return v;
+    }
+
 } // namespace menderer
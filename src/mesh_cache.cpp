@@ -0,0 +1,320 @@
+/**
+* This file is part of Menderer.
+*
+* Copyright 2019 Robert Maier, Technical University of Munich.
+* For more information see <https://github.com/robmaier/menderer>.
+*
+* Menderer is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* Menderer is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with Menderer. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <menderer/mesh_cache.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#ifndef _WIN32
+#include <unistd.h>
+#else
+#include <io.h>
+#include <process.h>
+#endif
+
+#include <menderer/parallel.h>
+
+// cache file magic number and format version
+#define MESH_CACHE_MAGIC "MMESH"
+#define MESH_CACHE_VERSION 2
+// alignment of the cached arrays within the file
+#define MESH_CACHE_ALIGNMENT 64
+
+
+namespace menderer
+{
+
+    MeshCache::MeshCache()
+    {
+    }
+
+
+    MeshCache::~MeshCache()
+    {
+        close();
+    }
+
+
+    std::string MeshCache::filename(const std::string &mesh_file)
+    {
+        return mesh_file + ".mmesh";
+    }
+
+
+    bool MeshCache::open(const std::string &mesh_file, unsigned int flags)
+    {
+        close();
+
+        // map cache file
+        if (!file_.open(filename(mesh_file)))
+            return false;
+        const char* data = file_.data();
+        const size_t size = file_.size();
+        Header header;
+        if (size < sizeof(Header))
+        {
+            close();
+            return false;
+        }
+        std::memcpy(&header, data, sizeof(Header));
+
+        // check cache format and source mesh key
+        Header key;
+        bool ok = std::strncmp(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic)) == 0 &&
+                header.version == MESH_CACHE_VERSION &&
+                header.flags == flags &&
+                computeKey(mesh_file, key) &&
+                header.source_size == key.source_size &&
+                header.source_mtime == key.source_mtime &&
+                header.source_hash == key.source_hash;
+
+        // check array bounds (overflow-safe for corrupted headers)
+        auto in_bounds = [size](uint64_t offset, uint64_t count, size_t elem_size)
+        {
+            return offset <= size && count <= (size - offset) / elem_size;
+        };
+        ok = ok && in_bounds(header.offset_vertices, header.num_vertices, sizeof(Vec3f)) &&
+                in_bounds(header.offset_normals, header.num_normals, sizeof(Vec3f)) &&
+                in_bounds(header.offset_colors, header.num_colors, sizeof(Vec3b)) &&
+                in_bounds(header.offset_faces, header.num_faces, sizeof(Vec3ui));
+        if (!ok)
+        {
+            close();
+            return false;
+        }
+
+        // point view into mapped arrays
+        view_.origin = Vec3(header.origin[0], header.origin[1], header.origin[2]);
+        view_.vertices = reinterpret_cast<const Vec3f*>(data + header.offset_vertices);
+        view_.num_vertices = header.num_vertices;
+        view_.normals = reinterpret_cast<const Vec3f*>(data + header.offset_normals);
+        view_.num_normals = header.num_normals;
+        view_.colors = reinterpret_cast<const Vec3b*>(data + header.offset_colors);
+        view_.num_colors = header.num_colors;
+        view_.face_vertices = reinterpret_cast<const Vec3ui*>(data + header.offset_faces);
+        view_.num_faces = header.num_faces;
+        return true;
+    }
+
+
+    bool MeshCache::save(const std::string &mesh_file, const Mesh &mesh, unsigned int flags)
+    {
+        Header header;
+        std::memset(&header, 0, sizeof(Header));
+        std::strncpy(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic));
+        header.version = MESH_CACHE_VERSION;
+        header.flags = flags;
+        if (!computeKey(mesh_file, header))
+            return false;
+
+        header.origin[0] = mesh.origin[0];
+        header.origin[1] = mesh.origin[1];
+        header.origin[2] = mesh.origin[2];
+
+        // array sizes and (aligned) offsets
+        header.num_vertices = mesh.vertices.size();
+        header.num_normals = mesh.normals.size();
+        header.num_colors = mesh.colors.size();
+        header.num_faces = mesh.face_vertices.size();
+        const uint64_t sizes[4] = { header.num_vertices * sizeof(Vec3f), header.num_normals * sizeof(Vec3f),
+                                    header.num_colors * sizeof(Vec3b), header.num_faces * sizeof(Vec3ui) };
+        const char* arrays[4] = { reinterpret_cast<const char*>(mesh.vertices.data()),
+                                  reinterpret_cast<const char*>(mesh.normals.data()),
+                                  reinterpret_cast<const char*>(mesh.colors.data()),
+                                  reinterpret_cast<const char*>(mesh.face_vertices.data()) };
+        uint64_t* offsets[4] = { &header.offset_vertices, &header.offset_normals,
+                                 &header.offset_colors, &header.offset_faces };
+        uint64_t offset = sizeof(Header);
+        for (int i = 0; i < 4; ++i)
+        {
+            offset = (offset + MESH_CACHE_ALIGNMENT - 1) / MESH_CACHE_ALIGNMENT * MESH_CACHE_ALIGNMENT;
+            *offsets[i] = offset;
+            offset += sizes[i];
+        }
+
+        // write into a uniquely named temporary file first and then rename it,
+        // so that concurrent runs never see a partially written or mixed cache
+        const std::string cache_file = filename(mesh_file);
+        std::string tmp_file;
+        if (!createTempFile(cache_file, tmp_file))
+            return false;
+        {
+            std::ofstream out_file(tmp_file.c_str(), std::ios::binary);
+            if (!out_file.is_open())
+            {
+                std::remove(tmp_file.c_str());
+                return false;
+            }
+            out_file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+            uint64_t pos = sizeof(Header);
+            const std::vector<char> padding(MESH_CACHE_ALIGNMENT, 0);
+            for (int i = 0; i < 4; ++i)
+            {
+                out_file.write(&padding[0], static_cast<std::streamsize>(*offsets[i] - pos));
+                if (sizes[i] > 0)
+                    out_file.write(arrays[i], static_cast<std::streamsize>(sizes[i]));
+                pos = *offsets[i] + sizes[i];
+            }
+            if (!out_file.good())
+            {
+                out_file.close();
+                std::remove(tmp_file.c_str());
+                return false;
+            }
+        }
+#ifdef _WIN32
+        // (rename does not replace an existing file on Windows)
+        std::remove(cache_file.c_str());
+#endif
+        if (std::rename(tmp_file.c_str(), cache_file.c_str()) != 0)
+        {
+            std::remove(tmp_file.c_str());
+            return false;
+        }
+        return true;
+    }
+
+
+    void MeshCache::close()
+    {
+        file_.close();
+        view_ = MeshView();
+    }
+
+
+    bool MeshCache::empty() const
+    {
+        return file_.empty();
+    }
+
+
+    const MeshView& MeshCache::view() const
+    {
+        return view_;
+    }
+
+
+    bool MeshCache::computeKey(const std::string &filename, Header &header)
+    {
+        // file size and modification time
+#ifndef _WIN32
+        struct stat st;
+        if (stat(filename.c_str(), &st) != 0)
+            return false;
+#else
+        struct _stat64 st;
+        if (_stat64(filename.c_str(), &st) != 0)
+            return false;
+#endif
+        header.source_size = static_cast<uint64_t>(st.st_size);
+        header.source_mtime = static_cast<int64_t>(st.st_mtime);
+
+        // content hash
+        MappedFile file;
+        if (!file.open(filename) || file.size() != header.source_size)
+            return false;
+        header.source_hash = computeHash(file.data(), file.size());
+        return true;
+    }
+
+
+    uint64_t MeshCache::computeHash(const char* data, size_t size)
+    {
+        // hash fixed-size blocks in parallel (independent of the number of threads)
+        const size_t block_size = 16 << 20;
+        const size_t num_blocks = (size + block_size - 1) / block_size;
+        std::vector<uint64_t> block_hashes(num_blocks, 0);
+        parallelFor(0, num_blocks, [&](size_t b0, size_t b1)
+        {
+            for (size_t b = b0; b < b1; ++b)
+            {
+                const char* ptr = data + b * block_size;
+                const size_t n = std::min(block_size, size - b * block_size);
+                // 64 bit FNV-1a on 8 byte words with additional mixing
+                uint64_t h = 0xcbf29ce484222325ull;
+                size_t i = 0;
+                for (; i + 8 <= n; i += 8)
+                {
+                    uint64_t w;
+                    std::memcpy(&w, ptr + i, sizeof(w));
+                    h = (h ^ w) * 0x100000001b3ull;
+                    h ^= h >> 29;
+                }
+                for (; i < n; ++i)
+                    h = (h ^ static_cast<unsigned char>(ptr[i])) * 0x100000001b3ull;
+                block_hashes[b] = h;
+            }
+        });
+
+        // combine block hashes
+        uint64_t hash = 0xcbf29ce484222325ull ^ static_cast<uint64_t>(size);
+        for (size_t b = 0; b < num_blocks; ++b)
+        {
+            hash = (hash ^ block_hashes[b]) * 0x100000001b3ull;
+            hash ^= hash >> 29;
+        }
+        return hash;
+    }
+
+
+    bool MeshCache::createTempFile(const std::string &filename, std::string &tmp_file)
+    {
+        // file name from process id and a counter, created exclusively
+        // (retried with the next counter if the file exists, e.g. from another host)
+        static std::atomic<unsigned int> counter(0);
+#ifndef _WIN32
+        const long pid = static_cast<long>(getpid());
+#else
+        const long pid = static_cast<long>(_getpid());
+#endif
+        for (int attempt = 0; attempt < 100; ++attempt)
+        {
+            tmp_file = filename + ".tmp." + std::to_string(pid) + "." + std::to_string(counter++);
+#ifndef _WIN32
+            const int fd = ::open(tmp_file.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0666);
+#else
+            const int fd = _open(tmp_file.c_str(), _O_WRONLY | _O_CREAT | _O_EXCL | _O_BINARY, _S_IREAD | _S_IWRITE);
+#endif
+            if (fd >= 0)
+            {
+#ifndef _WIN32
+                ::close(fd);
+#else
+                _close(fd);
+#endif
+                return true;
+            }
+            if (errno != EEXIST)
+                break;
+        }
+        tmp_file.clear();
+        return false;
+    }
+
+} // namespace menderer
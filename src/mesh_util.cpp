@@ -20,97 +20,175 @@
 
 #include <menderer/mesh_util.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
 #include <iostream>
-#include <map>
-#include <tuple>
+#include <limits>
+#include <memory>
+#include <queue>
+
+#include <menderer/parallel.h>
 
 
 namespace menderer
 {
 
-    void MeshUtil::computeFaceNormals(const Mesh &mesh, std::vector<Vec3> &face_normals)
+    void MeshUtil::computeFaceNormals(const Mesh &mesh, std::vector<Vec3f> &face_normals,
+                                      bool normalize)
     {
-        const std::vector<Vec3> &verts = mesh.vertices;
+        const std::vector<Vec3f> &verts = mesh.vertices;
         const auto &face_indices = mesh.face_vertices;
 
         size_t num_faces = face_indices.size();
         face_normals.resize(num_faces);
-        for (size_t i = 0; i < num_faces; ++i)
+        parallelFor(0, num_faces, [&](size_t f0, size_t f1)
         {
-            // collect vertex locations for current triangle
-            unsigned int vert_idx0 = face_indices[i][0];
-            unsigned int vert_idx1 = face_indices[i][1];
-            unsigned int vert_idx2 = face_indices[i][2];
-            Vec3 v0 = verts[vert_idx0];
-            Vec3 v1 = verts[vert_idx1];
-            Vec3 v2 = verts[vert_idx2];
-
-            // compute normal from vertex locations usnig cross product
-            Vec3 normal = (v1 - v0).cross(v2 - v0);
-            normal.normalize();
-            face_normals[i] = normal;
-        }
+            for (size_t i = f0; i < f1; ++i)
+            {
+                // collect vertex locations for current triangle
+                const Vec3f &v0 = verts[face_indices[i][0]];
+                const Vec3f &v1 = verts[face_indices[i][1]];
+                const Vec3f &v2 = verts[face_indices[i][2]];
+
+                // compute normal from vertex locations usnig cross product
+                Vec3f normal = (v1 - v0).cross(v2 - v0);
+                if (normalize)
+                    normal.normalize();
+                face_normals[i] = normal;
+            }
+        });
     }
 
 
-    void MeshUtil::computeVertexNormals(Mesh &mesh)
+    void MeshUtil::computeVertexFaceAdjacency(const Mesh &mesh, VertexFaceAdjacency &adjacency)
     {
-        // introduce shorthands and clear vertex normals
-        const std::vector<Vec3> &verts = mesh.vertices;
-        std::vector<Vec3> &normals = mesh.normals;
-        const auto& face_indices = mesh.face_vertices;
-        size_t num_verts = verts.size();
-        size_t num_faces = face_indices.size();
-        normals.clear();
+        computeVertexFaceAdjacency(mesh.view(), adjacency);
+    }
 
-        // compute face normals
-        std::vector<Vec3> face_normals;
-        computeFaceNormals(mesh, face_normals);
 
-        // compute vertex normals based on face normals
+    void MeshUtil::computeVertexFaceAdjacency(const MeshView &mesh, VertexFaceAdjacency &adjacency)
+    {
+        const Vec3ui* face_indices = mesh.face_vertices;
+        const size_t num_verts = mesh.num_vertices;
+        const size_t num_faces = mesh.num_faces;
 
-        // first collect faces for each vertex
-        std::vector<std::vector<unsigned int> > vertex_faces;
-        vertex_faces.resize(num_verts, std::vector<unsigned int>());
-        for (unsigned int i = 0; i < num_faces; ++i)
+        // count incident faces per vertex
+        std::unique_ptr<std::atomic<unsigned int>[]> counts(new std::atomic<unsigned int>[num_verts]);
+        parallelFor(0, num_verts, [&](size_t v0, size_t v1)
         {
-            for (int t = 0; t < 3; ++t)
+            for (size_t v = v0; v < v1; ++v)
+                counts[v].store(0, std::memory_order_relaxed);
+        });
+        parallelFor(0, num_faces, [&](size_t f0, size_t f1)
+        {
+            for (size_t i = f0; i < f1; ++i)
             {
-                unsigned int vIdx = face_indices[i][t];
-                vertex_faces[vIdx].push_back(i);
+                for (int t = 0; t < 3; ++t)
+                    counts[face_indices[i][t]].fetch_add(1, std::memory_order_relaxed);
             }
-        }
+        });
 
-        // compute vertex normals by averaging its face normals
-        normals.resize(num_verts);
-        for (size_t i = 0; i < num_verts; ++i)
+        // compute row offsets using prefix sums
+        adjacency.offsets.resize(num_verts + 1);
+        parallelFor(0, num_verts, [&](size_t v0, size_t v1)
         {
-            Vec3 normal(0.0, 0.0, 0.0);
-            if (vertex_faces[i].empty())
+            for (size_t v = v0; v < v1; ++v)
+                adjacency.offsets[v] = counts[v].load(std::memory_order_relaxed);
+        });
+        adjacency.offsets[num_verts] = 0;
+        parallelExclusiveScan(adjacency.offsets);
+
+        // scatter faces into rows
+        parallelFor(0, num_verts, [&](size_t v0, size_t v1)
+        {
+            for (size_t v = v0; v < v1; ++v)
+                counts[v].store(adjacency.offsets[v], std::memory_order_relaxed);
+        });
+        adjacency.faces.resize(adjacency.offsets[num_verts]);
+        parallelFor(0, num_faces, [&](size_t f0, size_t f1)
+        {
+            for (size_t i = f0; i < f1; ++i)
             {
-                //std::cerr << "Vertex " << i << ": no faces found!" << std::endl;
+                for (int t = 0; t < 3; ++t)
+                {
+                    unsigned int pos = counts[face_indices[i][t]].fetch_add(1, std::memory_order_relaxed);
+                    adjacency.faces[pos] = static_cast<unsigned int>(i);
+                }
             }
-            else
+        });
+
+        // sort rows for a deterministic order
+        parallelFor(0, num_verts, [&](size_t v0, size_t v1)
+        {
+            for (size_t v = v0; v < v1; ++v)
+                std::sort(adjacency.faces.begin() + adjacency.offsets[v],
+                          adjacency.faces.begin() + adjacency.offsets[v + 1]);
+        });
+    }
+
+
+    void MeshUtil::computeVertexNormals(Mesh &mesh, NormalWeighting weighting)
+    {
+        VertexFaceAdjacency adjacency;
+        computeVertexFaceAdjacency(mesh, adjacency);
+        computeVertexNormals(mesh, adjacency, weighting);
+    }
+
+
+    void MeshUtil::computeVertexNormals(Mesh &mesh, const VertexFaceAdjacency &adjacency,
+                                        NormalWeighting weighting)
+    {
+        // introduce shorthands
+        const std::vector<Vec3f> &verts = mesh.vertices;
+        std::vector<Vec3f> &normals = mesh.normals;
+        const auto& face_indices = mesh.face_vertices;
+        const size_t num_verts = verts.size();
+
+        // compute face normals (area weighting: length is twice the face area)
+        std::vector<Vec3f> face_normals;
+        computeFaceNormals(mesh, face_normals, weighting != Area);
+
+        // compute vertex normals by averaging the (weighted) normals of incident faces
+        normals.resize(num_verts);
+        parallelFor(0, num_verts, [&](size_t v0, size_t v1)
+        {
+            for (size_t i = v0; i < v1; ++i)
             {
-                for (size_t j = 0; j < vertex_faces[i].size(); ++j)
+                const unsigned int v = static_cast<unsigned int>(i);
+                Vec3f normal(0.0f, 0.0f, 0.0f);
+                for (const unsigned int* f = adjacency.begin(v); f != adjacency.end(v); ++f)
                 {
-                    unsigned int face_idx = vertex_faces[i][j];
-                    normal += face_normals[face_idx];
+                    if (weighting == Angle)
+                    {
+                        // weight by interior angle of the face at the vertex
+                        const Vec3ui &face = face_indices[*f];
+                        int t = face[0] == v ? 0 : (face[1] == v ? 1 : 2);
+                        Vec3f e0 = verts[face[(t + 1) % 3]] - verts[v];
+                        Vec3f e1 = verts[face[(t + 2) % 3]] - verts[v];
+                        float angle = std::atan2(e0.cross(e1).norm(), e0.dot(e1));
+                        normal += angle * face_normals[*f];
+                    }
+                    else
+                    {
+                        normal += face_normals[*f];
+                    }
                 }
-                normal.normalize();
+                if (adjacency.size(v) > 0)
+                    normal.normalize();
+                normals[i] = normal;
             }
-            normals[i] = normal;
-        }
-
-        // clear face normals
-        face_normals.clear();
+        });
     }
 
 
     void MeshUtil::removeDegenerateFaces(Mesh &mesh)
     {
         // remove degenerate faces
-        const std::vector<Vec3> &verts = mesh.vertices;
+        const std::vector<Vec3f> &verts = mesh.vertices;
         auto &faces = mesh.face_vertices;
         std::vector<Vec3ui> faces_new;
         int num_degenerate_faces = 0;
@@ -143,7 +221,7 @@ namespace menderer
     }
 
 
-    double MeshUtil::computeFaceArea(const Vec3 &v0, const Vec3 &v1, const Vec3 &v2)
+    double MeshUtil::computeFaceArea(const Vec3f &v0, const Vec3f &v1, const Vec3f &v2)
     {
         double area = ((v2-v0).cross(v2-v1)).norm();
         if (std::isnan(area) || area == std::numeric_limits<double>::infinity())
@@ -152,72 +230,929 @@ namespace menderer
     }
 
 
-    void MeshUtil::compressVertices(Mesh &mesh)
+    void MeshUtil::compressVertices(Mesh &mesh, double epsilon)
     {
         // unused vertices are removed implicitely
-        std::vector<Vec3> &verts = mesh.vertices;
-        std::vector<Vec3> &normals = mesh.normals;
-        std::vector<Vec3b> &colors = mesh.colors;
+        const std::vector<Vec3f> &verts = mesh.vertices;
         auto& face_indices = mesh.face_vertices;
-        size_t num_faces = face_indices.size();
-        bool has_colors = !colors.empty();
-        bool has_normals = !normals.empty();
+        const size_t num_verts = verts.size();
+        const size_t num_corners = face_indices.size() * 3;
+        const bool has_colors = !mesh.colors.empty();
+        const bool has_normals = !mesh.normals.empty();
+        const unsigned int invalid = std::numeric_limits<unsigned int>::max();
+        if (num_corners >= invalid || num_verts >= invalid / 4)
+        {
+            std::cerr << "too many faces for compressing mesh vertices!" << std::endl;
+            return;
+        }
 
-        typedef std::tuple<double, double, double> vec3;
-        std::vector<unsigned int> vert_indices;
-        vert_indices.resize(verts.size());
-        std::map<vec3, unsigned int> compressed_vert_indices;
+        // welding key of a vertex: float bits (with -0 == +0) or grid cell for epsilon > 0
+        auto vertex_key = [&](unsigned int v, int64_t key[3])
+        {
+            for (int i = 0; i < 3; ++i)
+            {
+                if (epsilon > 0.0)
+                {
+                    key[i] = static_cast<int64_t>(std::floor(verts[v][i] / epsilon));
+                }
+                else
+                {
+                    float f = verts[v][i] == 0.0f ? 0.0f : verts[v][i];
+                    uint32_t bits;
+                    std::memcpy(&bits, &f, sizeof(bits));
+                    key[i] = bits;
+                }
+            }
+        };
+        auto same_key = [&](unsigned int v0, unsigned int v1)
+        {
+            int64_t key0[3], key1[3];
+            vertex_key(v0, key0);
+            vertex_key(v1, key1);
+            return key0[0] == key1[0] && key0[1] == key1[1] && key0[2] == key1[2];
+        };
 
-        // unify vertices
-        std::vector<Vec3> verts_new;
-        std::vector<Vec3b> colors_new;
-        std::vector<Vec3> normals_new;
-        for (size_t i = 0; i < num_faces; i++)
+        // find first face corner referencing each vertex
+        std::unique_ptr<std::atomic<unsigned int>[]> first_corner(new std::atomic<unsigned int>[num_verts]);
+        parallelFor(0, num_verts, [&](size_t v0, size_t v1)
         {
-            for (int t = 0; t < 3; ++t)
+            for (size_t v = v0; v < v1; ++v)
+                first_corner[v].store(invalid, std::memory_order_relaxed);
+        });
+        parallelFor(0, num_corners, [&](size_t c0, size_t c1)
+        {
+            for (size_t c = c0; c < c1; ++c)
             {
-                // create tuple representation for current vertex
-                unsigned int vIdx = static_cast<unsigned int>(face_indices[i][t]);
-                Vec3 vIn = verts[vIdx];
-                vec3 v = std::make_tuple(vIn[0], vIn[1], vIn[2]);
+                const unsigned int v = face_indices[c / 3][static_cast<int>(c % 3)];
+                const unsigned int corner = static_cast<unsigned int>(c);
+                unsigned int cur = first_corner[v].load(std::memory_order_relaxed);
+                while (corner < cur && !first_corner[v].compare_exchange_weak(cur, corner));
+            }
+        });
 
-                // lookup index for this vertex
-                if (compressed_vert_indices.find(v) == compressed_vert_indices.end())
+        // insert used vertices into open-addressing hash table,
+        // keeping the vertex with the first face corner as representative per key
+        size_t table_size = 2;
+        while (table_size < 2 * num_verts)
+            table_size *= 2;
+        const size_t table_mask = table_size - 1;
+        std::unique_ptr<std::atomic<unsigned int>[]> table(new std::atomic<unsigned int>[table_size]);
+        parallelFor(0, table_size, [&](size_t i0, size_t i1)
+        {
+            for (size_t i = i0; i < i1; ++i)
+                table[i].store(invalid, std::memory_order_relaxed);
+        });
+        auto hash_slot = [&](unsigned int v)
+        {
+            int64_t key[3];
+            vertex_key(v, key);
+            uint64_t h = 0;
+            for (int i = 0; i < 3; ++i)
+            {
+                h = (h ^ static_cast<uint64_t>(key[i])) * 0x9E3779B97F4A7C15ull;
+                h ^= h >> 32;
+            }
+            return static_cast<size_t>(h) & table_mask;
+        };
+        std::vector<unsigned int> rep_indices(num_verts, invalid);
+        parallelFor(0, num_verts, [&](size_t v0, size_t v1)
+        {
+            for (size_t i = v0; i < v1; ++i)
+            {
+                const unsigned int v = static_cast<unsigned int>(i);
+                const unsigned int corner = first_corner[v].load(std::memory_order_relaxed);
+                if (corner == invalid)
+                    continue;
+                size_t slot = hash_slot(v);
+                for (; ; slot = (slot + 1) & table_mask)
                 {
-                    // vertex does not exist yet -> store it
-                    compressed_vert_indices[v] = static_cast<unsigned int>(verts_new.size());
-
-                    verts_new.push_back(vIn);
-                    if (has_colors)
-                        colors_new.push_back(colors[vIdx]);
-                    if (has_normals)
-                        normals_new.push_back(normals[vIdx]);
+                    unsigned int cur = invalid;
+                    if (table[slot].compare_exchange_strong(cur, v))
+                        break;
+                    if (!same_key(cur, v))
+                        continue;
+                    while (corner < first_corner[cur].load(std::memory_order_relaxed) &&
+                           !table[slot].compare_exchange_weak(cur, v));
+                    break;
                 }
-                vert_indices[vIdx] = compressed_vert_indices[v];
+                // remember slot of the vertex key
+                rep_indices[v] = static_cast<unsigned int>(slot);
             }
-        }
+        });
+
+        // look up representative vertices
+        parallelFor(0, num_verts, [&](size_t v0, size_t v1)
+        {
+            for (size_t v = v0; v < v1; ++v)
+            {
+                if (rep_indices[v] != invalid)
+                    rep_indices[v] = table[rep_indices[v]].load(std::memory_order_relaxed);
+            }
+        });
+        table.reset();
+
+        // number representatives in order of their first face corner
+        // (deterministic and independent of the number of threads)
+        std::vector<unsigned int> corner_indices(num_corners, 0);
+        parallelFor(0, num_verts, [&](size_t v0, size_t v1)
+        {
+            for (size_t v = v0; v < v1; ++v)
+            {
+                if (rep_indices[v] == v)
+                    corner_indices[first_corner[v].load(std::memory_order_relaxed)] = 1;
+            }
+        });
+        const unsigned int num_verts_new = parallelExclusiveScan(corner_indices);
+        std::vector<unsigned int> vert_indices(num_verts, invalid);
+        parallelFor(0, num_verts, [&](size_t v0, size_t v1)
+        {
+            for (size_t v = v0; v < v1; ++v)
+            {
+                if (rep_indices[v] != invalid)
+                    vert_indices[v] = corner_indices[first_corner[rep_indices[v]].load(std::memory_order_relaxed)];
+            }
+        });
+        corner_indices.clear();
+        corner_indices.shrink_to_fit();
+
+        // gather unified vertices
+        std::vector<Vec3f> verts_new(num_verts_new);
+        std::vector<Vec3b> colors_new(has_colors ? num_verts_new : 0);
+        std::vector<Vec3f> normals_new(has_normals ? num_verts_new : 0);
+        parallelFor(0, num_verts, [&](size_t v0, size_t v1)
+        {
+            for (size_t v = v0; v < v1; ++v)
+            {
+                if (rep_indices[v] != v)
+                    continue;
+                const unsigned int idx = vert_indices[v];
+                verts_new[idx] = verts[v];
+                if (has_colors)
+                    colors_new[idx] = mesh.colors[v];
+                if (has_normals)
+                    normals_new[idx] = mesh.normals[v];
+            }
+        });
 
         // update vertices with new unified vertices
-        mesh.vertices = verts_new;
-        mesh.normals = normals_new;
-        mesh.colors = colors_new;
+        mesh.vertices.swap(verts_new);
+        mesh.normals.swap(normals_new);
+        mesh.colors.swap(colors_new);
 
         // update face indices
-        for (size_t i = 0; i < num_faces; ++i)
+        parallelFor(0, face_indices.size(), [&](size_t f0, size_t f1)
         {
-            for (int t = 0; t < 3; ++t)
+            for (size_t i = f0; i < f1; ++i)
             {
-                // create tuple representation for current vertex
-                unsigned int vIdx = face_indices[i][t];
-                face_indices[i][t] = vert_indices[vIdx];
+                for (int t = 0; t < 3; ++t)
+                    face_indices[i][t] = vert_indices[face_indices[i][t]];
             }
-        }
+        });
 
         // remove degenerate faces
         removeDegenerateFaces(mesh);
     }
 
 
+    void MeshUtil::optimizeForRendering(Mesh &mesh, unsigned int cache_size, float overdraw_threshold)
+    {
+        std::vector<unsigned int> clusters;
+        optimizeVertexCache(mesh, cache_size, &clusters);
+        optimizeOverdraw(mesh, clusters, cache_size, overdraw_threshold);
+        optimizeVertexFetch(mesh);
+    }
+
+
+    void MeshUtil::optimizeVertexCache(Mesh &mesh, unsigned int cache_size,
+                                       std::vector<unsigned int>* clusters)
+    {
+        // Tipsify algorithm from Sander et al.,
+        // "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw", 2007
+        const auto& faces = mesh.face_vertices;
+        const size_t num_verts = mesh.vertices.size();
+        const size_t num_faces = faces.size();
+        if (clusters)
+            clusters->clear();
+        if (num_faces == 0)
+            return;
+
+        VertexFaceAdjacency adjacency;
+        computeVertexFaceAdjacency(mesh, adjacency);
+
+        // number of not yet emitted faces and cache time stamps per vertex
+        std::vector<unsigned int> live(num_verts);
+        for (size_t v = 0; v < num_verts; ++v)
+            live[v] = adjacency.size(static_cast<unsigned int>(v));
+        std::vector<unsigned int> time_stamps(num_verts, 0);
+        std::vector<char> emitted(num_faces, 0);
+        std::vector<unsigned int> dead_end;
+        std::vector<unsigned int> candidates;
+        std::vector<Vec3ui> faces_new;
+        faces_new.reserve(num_faces);
+
+        unsigned int time = cache_size + 1;
+        size_t cursor = 0;
+        int64_t fan = -1;
+        bool is_dead_end = true;
+        while (true)
+        {
+            if (is_dead_end)
+            {
+                // pick next vertex with remaining faces from the dead-end stack or in input order
+                fan = -1;
+                while (!dead_end.empty() && fan < 0)
+                {
+                    unsigned int v = dead_end.back();
+                    dead_end.pop_back();
+                    if (live[v] > 0)
+                        fan = v;
+                }
+                for (; cursor < num_verts && fan < 0; ++cursor)
+                {
+                    if (live[cursor] > 0)
+                        fan = static_cast<int64_t>(cursor);
+                }
+                if (fan < 0)
+                    break;
+                // start a new cluster at hard boundary
+                if (clusters)
+                    clusters->push_back(static_cast<unsigned int>(faces_new.size()));
+            }
+
+            // emit all remaining faces around the fanning vertex
+            candidates.clear();
+            const unsigned int f_vert = static_cast<unsigned int>(fan);
+            for (const unsigned int* f = adjacency.begin(f_vert); f != adjacency.end(f_vert); ++f)
+            {
+                if (emitted[*f])
+                    continue;
+                emitted[*f] = 1;
+                faces_new.push_back(faces[*f]);
+                for (int t = 0; t < 3; ++t)
+                {
+                    unsigned int v = faces[*f][t];
+                    dead_end.push_back(v);
+                    candidates.push_back(v);
+                    --live[v];
+                    if (time - time_stamps[v] > cache_size)
+                        time_stamps[v] = time++;
+                }
+            }
+
+            // continue with the candidate that stays longest in the cache
+            // after emitting its remaining faces
+            fan = -1;
+            int64_t best_priority = -1;
+            for (size_t c = 0; c < candidates.size(); ++c)
+            {
+                unsigned int v = candidates[c];
+                if (live[v] == 0)
+                    continue;
+                int64_t priority = 0;
+                if (time - time_stamps[v] + 2 * live[v] <= cache_size)
+                    priority = time - time_stamps[v];
+                if (priority > best_priority)
+                {
+                    best_priority = priority;
+                    fan = v;
+                }
+            }
+            is_dead_end = (fan < 0);
+        }
+
+        mesh.face_vertices.swap(faces_new);
+    }
+
+
+    void MeshUtil::optimizeOverdraw(Mesh &mesh, const std::vector<unsigned int> &clusters,
+                                    unsigned int cache_size, float overdraw_threshold)
+    {
+        const std::vector<Vec3f> &verts = mesh.vertices;
+        const auto& faces = mesh.face_vertices;
+        const size_t num_faces = faces.size();
+        if (num_faces == 0)
+            return;
+
+        // split hard clusters into smaller clusters wherever
+        // the cache efficiency within the cluster is already good enough
+        const float acmr_threshold = computeACMR(mesh, cache_size) * overdraw_threshold;
+        std::vector<unsigned int> hard_clusters = clusters;
+        if (hard_clusters.empty() || hard_clusters[0] != 0)
+            hard_clusters.insert(hard_clusters.begin(), 0);
+        hard_clusters.push_back(static_cast<unsigned int>(num_faces));
+        std::vector<unsigned int> time_stamps(verts.size(), 0);
+        unsigned int time = cache_size + 1;
+        std::vector<unsigned int> soft_clusters;
+        for (size_t c = 0; c + 1 < hard_clusters.size(); ++c)
+        {
+            size_t start = hard_clusters[c];
+            size_t misses = 0;
+            soft_clusters.push_back(static_cast<unsigned int>(start));
+            for (size_t i = start; i < hard_clusters[c + 1]; ++i)
+            {
+                for (int t = 0; t < 3; ++t)
+                {
+                    unsigned int v = faces[i][t];
+                    if (time - time_stamps[v] > cache_size)
+                    {
+                        time_stamps[v] = time++;
+                        ++misses;
+                    }
+                }
+                if (i + 1 < hard_clusters[c + 1] &&
+                        static_cast<float>(misses) <= acmr_threshold * static_cast<float>(i + 1 - start))
+                {
+                    // start new cluster with empty cache
+                    start = i + 1;
+                    misses = 0;
+                    soft_clusters.push_back(static_cast<unsigned int>(start));
+                    time += cache_size + 1;
+                }
+            }
+        }
+        soft_clusters.push_back(static_cast<unsigned int>(num_faces));
+        const size_t num_clusters = soft_clusters.size() - 1;
+
+        // compute area-weighted centroids and normals of clusters and mesh
+        std::vector<Vec3f> face_normals;
+        computeFaceNormals(mesh, face_normals, false);
+        std::vector<Vec3f> centroids(num_clusters);
+        std::vector<Vec3f> normals(num_clusters);
+        std::vector<float> areas(num_clusters);
+        parallelFor(0, num_clusters, [&](size_t c0, size_t c1)
+        {
+            for (size_t c = c0; c < c1; ++c)
+            {
+                Vec3f centroid = Vec3f::Zero();
+                Vec3f normal = Vec3f::Zero();
+                float area = 0.0f;
+                for (size_t i = soft_clusters[c]; i < soft_clusters[c + 1]; ++i)
+                {
+                    float a = face_normals[i].norm();
+                    centroid += a * (verts[faces[i][0]] + verts[faces[i][1]] + verts[faces[i][2]]) / 3.0f;
+                    normal += face_normals[i];
+                    area += a;
+                }
+                centroids[c] = area > 0.0f ? Vec3f(centroid / area) : Vec3f(verts[faces[soft_clusters[c]][0]]);
+                normals[c] = normal;
+                areas[c] = area;
+            }
+        });
+        Vec3f mesh_centroid = Vec3f::Zero();
+        float mesh_area = 0.0f;
+        for (size_t c = 0; c < num_clusters; ++c)
+        {
+            mesh_centroid += areas[c] * centroids[c];
+            mesh_area += areas[c];
+        }
+        if (mesh_area > 0.0f)
+            mesh_centroid /= mesh_area;
+
+        // render outwards-facing clusters first, since they likely occlude the others
+        std::vector<float> sort_keys(num_clusters);
+        std::vector<unsigned int> order(num_clusters);
+        for (size_t c = 0; c < num_clusters; ++c)
+        {
+            float len = normals[c].norm();
+            sort_keys[c] = len > 0.0f ? (centroids[c] - mesh_centroid).dot(normals[c]) / len : 0.0f;
+            order[c] = static_cast<unsigned int>(c);
+        }
+        std::stable_sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b)
+        {
+            return sort_keys[a] > sort_keys[b];
+        });
+
+        std::vector<Vec3ui> faces_new;
+        faces_new.reserve(num_faces);
+        for (size_t c = 0; c < num_clusters; ++c)
+        {
+            faces_new.insert(faces_new.end(), faces.begin() + soft_clusters[order[c]],
+                             faces.begin() + soft_clusters[order[c] + 1]);
+        }
+        mesh.face_vertices.swap(faces_new);
+    }
+
+
+    void MeshUtil::optimizeVertexFetch(Mesh &mesh)
+    {
+        const size_t num_verts = mesh.vertices.size();
+        const bool has_colors = !mesh.colors.empty();
+        const bool has_normals = !mesh.normals.empty();
+        auto& faces = mesh.face_vertices;
+        const unsigned int invalid = std::numeric_limits<unsigned int>::max();
+
+        // number vertices in order of their first use (unused vertices at the end)
+        std::vector<unsigned int> vert_indices(num_verts, invalid);
+        unsigned int num_used = 0;
+        for (size_t i = 0; i < faces.size(); ++i)
+        {
+            for (int t = 0; t < 3; ++t)
+            {
+                if (vert_indices[faces[i][t]] == invalid)
+                    vert_indices[faces[i][t]] = num_used++;
+            }
+        }
+        for (size_t v = 0; v < num_verts; ++v)
+        {
+            if (vert_indices[v] == invalid)
+                vert_indices[v] = num_used++;
+        }
+
+        // reorder vertex attributes
+        std::vector<Vec3f> verts_new(num_verts);
+        std::vector<Vec3b> colors_new(has_colors ? num_verts : 0);
+        std::vector<Vec3f> normals_new(has_normals ? num_verts : 0);
+        parallelFor(0, num_verts, [&](size_t v0, size_t v1)
+        {
+            for (size_t v = v0; v < v1; ++v)
+            {
+                verts_new[vert_indices[v]] = mesh.vertices[v];
+                if (has_colors)
+                    colors_new[vert_indices[v]] = mesh.colors[v];
+                if (has_normals)
+                    normals_new[vert_indices[v]] = mesh.normals[v];
+            }
+        });
+        mesh.vertices.swap(verts_new);
+        mesh.colors.swap(colors_new);
+        mesh.normals.swap(normals_new);
+
+        // update face indices
+        parallelFor(0, faces.size(), [&](size_t f0, size_t f1)
+        {
+            for (size_t i = f0; i < f1; ++i)
+            {
+                for (int t = 0; t < 3; ++t)
+                    faces[i][t] = vert_indices[faces[i][t]];
+            }
+        });
+    }
+
+
+    void MeshUtil::buildLODs(const MeshView &mesh, std::vector<LevelOfDetail> &lods,
+                             float reduction, size_t min_faces)
+    {
+        lods.clear();
+        const size_t num_verts = mesh.num_vertices;
+        const size_t num_faces = mesh.num_faces;
+        const Vec3f* verts = mesh.vertices;
+        if (num_faces <= min_faces || reduction <= 0.0f || reduction >= 1.0f)
+            return;
+
+        // current faces (updated in place by collapses)
+        std::vector<Vec3ui> faces(mesh.face_vertices, mesh.face_vertices + num_faces);
+        std::vector<char> face_alive(num_faces, 1);
+        std::vector<Vec3f> face_normals(num_faces);
+        parallelFor(0, num_faces, [&](size_t f0, size_t f1)
+        {
+            for (size_t f = f0; f < f1; ++f)
+                face_normals[f] = (verts[faces[f][1]] - verts[faces[f][0]]).cross(verts[faces[f][2]] - verts[faces[f][0]]);
+        });
+        VertexFaceAdjacency adjacency;
+        computeVertexFaceAdjacency(mesh, adjacency);
+
+        // vertex quadrics from the planes of incident faces
+        std::vector<Quadric> quadrics(num_verts);
+        // vertices on boundary or non-manifold edges are locked
+        std::vector<char> locked(num_verts, 0);
+        parallelFor(0, num_verts, [&](size_t v0, size_t v1)
+        {
+            std::vector<unsigned int> neighbors;
+            for (size_t i = v0; i < v1; ++i)
+            {
+                const unsigned int v = static_cast<unsigned int>(i);
+                Quadric q = Quadric::Zero();
+                neighbors.clear();
+                for (const unsigned int* f = adjacency.begin(v); f != adjacency.end(v); ++f)
+                {
+                    const Vec3ui &face = faces[*f];
+                    q += computePlaneQuadric(verts[face[0]], verts[face[1]], verts[face[2]]);
+                    for (int t = 0; t < 3; ++t)
+                    {
+                        if (face[t] != v)
+                            neighbors.push_back(face[t]);
+                    }
+                }
+                quadrics[v] = q;
+                // interior manifold edges are shared by exactly two faces
+                std::sort(neighbors.begin(), neighbors.end());
+                for (size_t n = 0; n < neighbors.size(); )
+                {
+                    size_t m = n;
+                    while (m < neighbors.size() && neighbors[m] == neighbors[n])
+                        ++m;
+                    if (m - n != 2)
+                        locked[v] = 1;
+                    n = m;
+                }
+            }
+        });
+
+        // each collapsed vertex is linked into the circular list of the vertex
+        // it was collapsed into, so that all faces around a vertex can be visited
+        std::vector<unsigned int> ring(num_verts);
+        std::vector<char> collapsed(num_verts, 0);
+        for (size_t v = 0; v < num_verts; ++v)
+            ring[v] = static_cast<unsigned int>(v);
+        auto for_each_face = [&](unsigned int v, const std::function<bool(unsigned int)> &func)
+        {
+            unsigned int u = v;
+            do
+            {
+                for (const unsigned int* f = adjacency.begin(u); f != adjacency.end(u); ++f)
+                {
+                    if (face_alive[*f] && !func(*f))
+                        return false;
+                }
+                u = ring[u];
+            }
+            while (u != v);
+            return true;
+        };
+
+        // priority queue of half-edge collapses (from, to) ordered by quadric error
+        struct Collapse
+        {
+            double cost;
+            unsigned int from;
+            unsigned int to;
+            bool operator<(const Collapse &other) const
+            {
+                if (cost != other.cost)
+                    return cost > other.cost;
+                return from != other.from ? from > other.from : to > other.to;
+            }
+        };
+        std::priority_queue<Collapse> queue;
+        auto push_edge = [&](unsigned int a, unsigned int b)
+        {
+            // cheaper direction of the edge collapse
+            Quadric q = quadrics[a] + quadrics[b];
+            Collapse c;
+            c.cost = std::numeric_limits<double>::infinity();
+            if (!locked[a])
+            {
+                c.cost = std::max(0.0, evaluateQuadric(q, verts[b]));
+                c.from = a;
+                c.to = b;
+            }
+            if (!locked[b])
+            {
+                double cost = std::max(0.0, evaluateQuadric(q, verts[a]));
+                if (cost < c.cost)
+                {
+                    c.cost = cost;
+                    c.from = b;
+                    c.to = a;
+                }
+            }
+            if (c.cost < std::numeric_limits<double>::infinity())
+                queue.push(c);
+        };
+        for (size_t f = 0; f < num_faces; ++f)
+        {
+            for (int t = 0; t < 3; ++t)
+            {
+                unsigned int a = faces[f][t];
+                unsigned int b = faces[f][(t + 1) % 3];
+                // every interior edge is visited twice, push it once
+                if (a < b || locked[a] || locked[b])
+                    push_edge(a, b);
+            }
+        }
+
+        size_t num_alive = num_faces;
+        size_t target = static_cast<size_t>(num_faces * reduction);
+        double max_error = 0.0;
+        std::vector<unsigned int> ring_from, ring_to;
+        while (!queue.empty() && target >= min_faces)
+        {
+            Collapse c = queue.top();
+            queue.pop();
+            if (collapsed[c.from] || collapsed[c.to])
+                continue;
+
+            // re-evaluate cost with current quadrics (lazy update)
+            double cost = std::max(0.0, evaluateQuadric(quadrics[c.from] + quadrics[c.to], verts[c.to]));
+            if (cost > c.cost)
+            {
+                c.cost = cost;
+                queue.push(c);
+                continue;
+            }
+
+            // check that the edge exists, the link condition holds and no face flips
+            size_t num_shared = 0;
+            ring_from.clear();
+            ring_to.clear();
+            bool valid = for_each_face(c.from, [&](unsigned int f)
+            {
+                const Vec3ui &face = faces[f];
+                if (face[0] == c.to || face[1] == c.to || face[2] == c.to)
+                {
+                    ++num_shared;
+                    return true;
+                }
+                Vec3f v[3];
+                Vec3f v_new[3];
+                for (int t = 0; t < 3; ++t)
+                {
+                    v[t] = verts[face[t]];
+                    v_new[t] = face[t] == c.from ? verts[c.to] : v[t];
+                    if (face[t] != c.from)
+                        ring_from.push_back(face[t]);
+                }
+                // compare with current and original orientation to avoid gradual flips
+                Vec3f n = (v[1] - v[0]).cross(v[2] - v[0]);
+                Vec3f n_new = (v_new[1] - v_new[0]).cross(v_new[2] - v_new[0]);
+                return n.dot(n_new) > 0.25f * n.norm() * n_new.norm() &&
+                        face_normals[f].dot(n_new) > 0.0f;
+            });
+            if (!valid || num_shared == 0)
+                continue;
+            for_each_face(c.to, [&](unsigned int f)
+            {
+                for (int t = 0; t < 3; ++t)
+                {
+                    if (faces[f][t] != c.to)
+                        ring_to.push_back(faces[f][t]);
+                }
+                return true;
+            });
+            std::sort(ring_from.begin(), ring_from.end());
+            ring_from.erase(std::unique(ring_from.begin(), ring_from.end()), ring_from.end());
+            std::sort(ring_to.begin(), ring_to.end());
+            ring_to.erase(std::unique(ring_to.begin(), ring_to.end()), ring_to.end());
+            size_t num_common = 0;
+            for (size_t i = 0, j = 0; i < ring_from.size() && j < ring_to.size(); )
+            {
+                if (ring_from[i] < ring_to[j])
+                    ++i;
+                else if (ring_from[i] > ring_to[j])
+                    ++j;
+                else if (ring_from[i] != c.to)
+                    ++num_common, ++i, ++j;
+                else
+                    ++i, ++j;
+            }
+            if (num_common > num_shared)
+                continue;
+
+            // collapse edge: remove shared faces and move the other faces to the target vertex
+            for_each_face(c.from, [&](unsigned int f)
+            {
+                Vec3ui &face = faces[f];
+                if (face[0] == c.to || face[1] == c.to || face[2] == c.to)
+                {
+                    face_alive[f] = 0;
+                    --num_alive;
+                }
+                else
+                {
+                    for (int t = 0; t < 3; ++t)
+                    {
+                        if (face[t] == c.from)
+                            face[t] = c.to;
+                    }
+                }
+                return true;
+            });
+            collapsed[c.from] = 1;
+            std::swap(ring[c.from], ring[c.to]);
+            quadrics[c.to] += quadrics[c.from];
+            max_error = std::max(max_error, c.cost);
+
+            // update collapses of edges around the target vertex
+            ring_to.clear();
+            for_each_face(c.to, [&](unsigned int f)
+            {
+                for (int t = 0; t < 3; ++t)
+                {
+                    if (faces[f][t] != c.to)
+                        ring_to.push_back(faces[f][t]);
+                }
+                return true;
+            });
+            std::sort(ring_to.begin(), ring_to.end());
+            ring_to.erase(std::unique(ring_to.begin(), ring_to.end()), ring_to.end());
+            for (size_t i = 0; i < ring_to.size(); ++i)
+                push_edge(c.to, ring_to[i]);
+
+            if (num_alive <= target)
+            {
+                // store level of detail in original triangle order
+                LevelOfDetail lod;
+                lod.face_vertices.reserve(num_alive);
+                for (size_t f = 0; f < num_faces; ++f)
+                {
+                    if (face_alive[f])
+                        lod.face_vertices.push_back(faces[f]);
+                }
+                lod.error = static_cast<float>(std::sqrt(max_error));
+                lods.push_back(lod);
+                target = static_cast<size_t>(num_alive * reduction);
+            }
+        }
+    }
+
+
+    MeshUtil::Quadric MeshUtil::computePlaneQuadric(const Vec3f &v0, const Vec3f &v1, const Vec3f &v2)
+    {
+        // plane n^T x + d = 0 of the triangle
+        Vec3 n = (v1 - v0).cross(v2 - v0).cast<double>();
+        double len = n.norm();
+        if (len == 0.0 || std::isnan(len))
+            return Quadric::Zero();
+        n /= len;
+        double d = -n.dot(v0.cast<double>());
+        Quadric q;
+        q << n[0] * n[0], n[0] * n[1], n[0] * n[2], n[1] * n[1], n[1] * n[2], n[2] * n[2],
+                n[0] * d, n[1] * d, n[2] * d, d * d;
+        return q;
+    }
+
+
+    double MeshUtil::evaluateQuadric(const Quadric &q, const Vec3f &p)
+    {
+        const double x = p[0], y = p[1], z = p[2];
+        return q[0] * x * x + 2.0 * q[1] * x * y + 2.0 * q[2] * x * z + q[3] * y * y +
+                2.0 * q[4] * y * z + q[5] * z * z + 2.0 * (q[6] * x + q[7] * y + q[8] * z) + q[9];
+    }
+
+
+    unsigned int MeshUtil::computeMortonCode(const Vec3f &p)
+    {
+        // quantize to 10 bits per axis and interleave bits
+        unsigned int code = 0;
+        for (int i = 0; i < 3; ++i)
+        {
+            unsigned int x = static_cast<unsigned int>(std::min(std::max(p[i] * 1024.0f, 0.0f), 1023.0f));
+            x = (x | (x << 16)) & 0x030000FF;
+            x = (x | (x << 8)) & 0x0300F00F;
+            x = (x | (x << 4)) & 0x030C30C3;
+            x = (x | (x << 2)) & 0x09249249;
+            code |= x << (2 - i);
+        }
+        return code;
+    }
+
+
+    void MeshUtil::buildClusters(const MeshView &mesh, std::vector<Vec3ui> &faces, std::vector<unsigned int> &face_ids,
+                                 std::vector<Cluster> &clusters, size_t max_faces)
+    {
+        faces.clear();
+        face_ids.clear();
+        clusters.clear();
+        const size_t num_faces = mesh.num_faces;
+        if (num_faces == 0)
+            return;
+        max_faces = std::max(max_faces, static_cast<size_t>(1));
+
+        // bounding box of triangle centroids
+        std::vector<Vec3f> centroids(num_faces);
+        parallelFor(0, num_faces, [&](size_t i0, size_t i1)
+        {
+            for (size_t i = i0; i < i1; ++i)
+            {
+                const Vec3ui &f = mesh.face_vertices[i];
+                centroids[i] = (mesh.vertices[f[0]] + mesh.vertices[f[1]] + mesh.vertices[f[2]]) / 3.0f;
+            }
+        });
+        Vec3f c_min = Vec3f::Constant(std::numeric_limits<float>::max());
+        Vec3f c_max = Vec3f::Constant(-std::numeric_limits<float>::max());
+        for (size_t i = 0; i < num_faces; ++i)
+        {
+            c_min = c_min.cwiseMin(centroids[i]);
+            c_max = c_max.cwiseMax(centroids[i]);
+        }
+        const Vec3f scale = (c_max - c_min).cwiseMax(1e-12f).cwiseInverse();
+
+        // sort triangles along Morton curve (ties broken by triangle index)
+        std::vector<uint64_t> keys(num_faces);
+        parallelFor(0, num_faces, [&](size_t i0, size_t i1)
+        {
+            for (size_t i = i0; i < i1; ++i)
+            {
+                const Vec3f p = (centroids[i] - c_min).cwiseProduct(scale);
+                keys[i] = (static_cast<uint64_t>(computeMortonCode(p)) << 32) | static_cast<uint64_t>(i);
+            }
+        });
+        std::sort(keys.begin(), keys.end());
+
+        // assign consecutive runs of Morton-sorted triangles to clusters
+        const size_t num_clusters = (num_faces + max_faces - 1) / max_faces;
+        std::vector<unsigned int> face_cluster(num_faces);
+        for (size_t i = 0; i < num_faces; ++i)
+            face_cluster[static_cast<size_t>(keys[i] & 0xFFFFFFFF)] = static_cast<unsigned int>(i / max_faces);
+
+        // reorder triangles by cluster, keeping their original relative order
+        clusters.resize(num_clusters);
+        for (size_t c = 0; c < num_clusters; ++c)
+        {
+            clusters[c].first_face = c * max_faces;
+            clusters[c].num_faces = std::min(max_faces, num_faces - c * max_faces);
+        }
+        std::vector<size_t> next_face(num_clusters);
+        for (size_t c = 0; c < num_clusters; ++c)
+            next_face[c] = clusters[c].first_face;
+        faces.resize(num_faces);
+        face_ids.resize(num_faces);
+        for (size_t i = 0; i < num_faces; ++i)
+        {
+            const size_t f = next_face[face_cluster[i]]++;
+            faces[f] = mesh.face_vertices[i];
+            face_ids[f] = static_cast<unsigned int>(i);
+        }
+
+        // bounding boxes and normal cones of clusters
+        parallelFor(0, num_clusters, [&](size_t c0, size_t c1)
+        {
+            std::vector<Vec3f> normals;
+            for (size_t c = c0; c < c1; ++c)
+            {
+                Cluster &cluster = clusters[c];
+                const Vec3ui* f_begin = faces.data() + cluster.first_face;
+                const Vec3ui* f_end = f_begin + cluster.num_faces;
+
+                cluster.bbox_min = Vec3f::Constant(std::numeric_limits<float>::max());
+                cluster.bbox_max = Vec3f::Constant(-std::numeric_limits<float>::max());
+                normals.clear();
+                Vec3f axis = Vec3f::Zero();
+                for (const Vec3ui* f = f_begin; f != f_end; ++f)
+                {
+                    const Vec3f &v0 = mesh.vertices[(*f)[0]];
+                    const Vec3f &v1 = mesh.vertices[(*f)[1]];
+                    const Vec3f &v2 = mesh.vertices[(*f)[2]];
+                    cluster.bbox_min = cluster.bbox_min.cwiseMin(v0).cwiseMin(v1).cwiseMin(v2);
+                    cluster.bbox_max = cluster.bbox_max.cwiseMax(v0).cwiseMax(v1).cwiseMax(v2);
+                    Vec3f n = (v1 - v0).cross(v2 - v0);
+                    const float len = n.norm();
+                    n = len > 0.0f ? Vec3f(n / len) : Vec3f::Zero();
+                    normals.push_back(n);
+                    axis += n;
+                }
+
+                // normal cone: average normal and minimum angle cosine
+                cluster.cone_apex = (cluster.bbox_min + cluster.bbox_max) * 0.5f;
+                cluster.cone_axis = Vec3f::Zero();
+                cluster.cone_cutoff = 2.0f;
+                const float axis_len = axis.norm();
+                if (axis_len <= 0.0f)
+                    continue;
+                axis /= axis_len;
+                float min_dot = 1.0f;
+                for (size_t i = 0; i < normals.size(); ++i)
+                    min_dot = std::min(min_dot, normals[i].dot(axis));
+                // cone too wide (or degenerate triangles): cluster is never backfacing
+                if (min_dot <= 0.1f)
+                    continue;
+
+                // move apex back along the axis so that the cone test is conservative
+                // for all points on the triangle planes
+                const Vec3f center = cluster.cone_apex;
+                float max_t = 0.0f;
+                for (size_t i = 0; i < normals.size(); ++i)
+                {
+                    const Vec3f &v0 = mesh.vertices[f_begin[i][0]];
+                    const float dc = (center - v0).dot(normals[i]);
+                    const float dn = axis.dot(normals[i]);
+                    max_t = std::max(max_t, dc / dn);
+                }
+                cluster.cone_apex = center - axis * max_t;
+                cluster.cone_axis = axis;
+                cluster.cone_cutoff = std::sqrt(1.0f - min_dot * min_dot);
+            }
+        });
+    }
+
+
+    float MeshUtil::computeACMR(const Mesh &mesh, unsigned int cache_size, size_t begin, size_t end)
+    {
+        const auto& faces = mesh.face_vertices;
+        end = std::min(end, faces.size());
+        if (begin >= end)
+            return 0.0f;
+
+        // simulate FIFO cache using time stamps
+        std::vector<unsigned int> time_stamps(mesh.vertices.size(), 0);
+        unsigned int time = cache_size + 1;
+        size_t misses = 0;
+        for (size_t i = begin; i < end; ++i)
+        {
+            for (int t = 0; t < 3; ++t)
+            {
+                unsigned int v = faces[i][t];
+                if (time - time_stamps[v] > cache_size)
+                {
+                    time_stamps[v] = time++;
+                    ++misses;
+                }
+            }
+        }
+        return static_cast<float>(misses) / static_cast<float>(end - begin);
+    }
+
+
     bool MeshUtil::createFromRGBD(const cv::Mat &vertex_map, const cv::Mat &color,
                                   const Mat4 &pose_cam_to_world, Mesh &mesh)
     {
@@ -226,6 +1161,7 @@ namespace menderer
 
         // clear mesh
         mesh.clear();
+        mesh.origin = pose_cam_to_world.topRightCorner<3, 1>();
 
         // thresholds for triangle generation
         const double depth_threshold = 5.0;
@@ -277,20 +1213,21 @@ namespace menderer
                     continue;
 
                 // transform into world coordinate system
-                p00 = pose_cam_to_world.topLeftCorner<3, 3>() * p00 + pose_cam_to_world.topRightCorner<3, 1>();
-                p10 = pose_cam_to_world.topLeftCorner<3, 3>() * p10 + pose_cam_to_world.topRightCorner<3, 1>();
-                p01 = pose_cam_to_world.topLeftCorner<3, 3>() * p01 + pose_cam_to_world.topRightCorner<3, 1>();
-                p11 = pose_cam_to_world.topLeftCorner<3, 3>() * p11 + pose_cam_to_world.topRightCorner<3, 1>();
+                // (relative to the mesh origin at the camera position)
+                p00 = pose_cam_to_world.topLeftCorner<3, 3>() * p00;
+                p10 = pose_cam_to_world.topLeftCorner<3, 3>() * p10;
+                p01 = pose_cam_to_world.topLeftCorner<3, 3>() * p01;
+                p11 = pose_cam_to_world.topLeftCorner<3, 3>() * p11;
 
                 // insert vertices
                 unsigned int v00 = static_cast<unsigned int>(mesh.vertices.size());
-                mesh.vertices.push_back(p00);
+                mesh.vertices.push_back(p00.cast<float>());
                 unsigned int v10 = static_cast<unsigned int>(mesh.vertices.size());
-                mesh.vertices.push_back(p10);
+                mesh.vertices.push_back(p10.cast<float>());
                 unsigned int v01 = static_cast<unsigned int>(mesh.vertices.size());
-                mesh.vertices.push_back(p01);
+                mesh.vertices.push_back(p01.cast<float>());
                 unsigned int v11 = static_cast<unsigned int>(mesh.vertices.size());
-                mesh.vertices.push_back(p11);
+                mesh.vertices.push_back(p11.cast<float>());
 
                 if (has_colors)
                 {
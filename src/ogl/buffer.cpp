@@ -22,6 +22,8 @@
 
 #include <iostream>
 
+#include <menderer/ogl/vertex.h>
+
 
 namespace menderer
 {
@@ -31,6 +33,7 @@ namespace ogl
     Buffer::Buffer(GLenum target) :
         id_(0),
         target_(target),
+        size_(0),
         size_bytes_(0)
     {
     }
@@ -59,21 +62,47 @@ namespace ogl
     }
 
 
+    void Buffer::bindBase(GLuint index)
+    {
+        if (!id_)
+            return;
+        glBindBufferBase(target_, index, id_);
+    }
+
+
     template<typename T>
     bool Buffer::upload(const std::vector<T> &data, GLenum usage)
+    {
+        return upload(data.data(), data.size(), usage);
+    }
+
+
+    template<typename T>
+    bool Buffer::upload(const T* data, size_t size, GLenum usage)
     {
         // compute and store sizes
-        size_ = data.size();
-        size_bytes_ = sizeof(T) * data.size();
-        return upload(size_bytes_, &(data[0]), usage);
+        size_ = size;
+        size_bytes_ = sizeof(T) * size;
+        return upload(size_bytes_, static_cast<const void*>(data), usage);
     }
 
     // template method instantiations
+    template bool Buffer::upload<float>(const std::vector<float> &data, GLenum usage);
+    template bool Buffer::upload<unsigned int>(const std::vector<unsigned int> &data, GLenum usage);
     template bool Buffer::upload<Vec3b>(const std::vector<Vec3b> &data, GLenum usage);
     template bool Buffer::upload<Vec3f>(const std::vector<Vec3f> &data, GLenum usage);
     template bool Buffer::upload<Vec3i>(const std::vector<Vec3i> &data, GLenum usage);
     template bool Buffer::upload<Vec3ui>(const std::vector<Vec3ui> &data, GLenum usage);
     template bool Buffer::upload<Vec3>(const std::vector<Vec3> &data, GLenum usage);
+    template bool Buffer::upload<Vertex>(const std::vector<Vertex> &data, GLenum usage);
+    template bool Buffer::upload<float>(const float* data, size_t size, GLenum usage);
+    template bool Buffer::upload<unsigned int>(const unsigned int* data, size_t size, GLenum usage);
+    template bool Buffer::upload<Vec3b>(const Vec3b* data, size_t size, GLenum usage);
+    template bool Buffer::upload<Vec3f>(const Vec3f* data, size_t size, GLenum usage);
+    template bool Buffer::upload<Vec3i>(const Vec3i* data, size_t size, GLenum usage);
+    template bool Buffer::upload<Vec3ui>(const Vec3ui* data, size_t size, GLenum usage);
+    template bool Buffer::upload<Vec3>(const Vec3* data, size_t size, GLenum usage);
+    template bool Buffer::upload<Vertex>(const Vertex* data, size_t size, GLenum usage);
 
 
     bool Buffer::upload(size_t size_bytes, const void* data, GLenum usage)
@@ -90,6 +119,32 @@ namespace ogl
     }
 
 
+    bool Buffer::allocate(size_t byte_size, GLenum usage)
+    {
+        size_ = byte_size;
+        size_bytes_ = byte_size;
+        return upload(size_bytes_, nullptr, usage);
+    }
+
+
+    const void* Buffer::mapRead()
+    {
+        if (!id_ || size_bytes_ == 0)
+            return nullptr;
+        glBindBuffer(target_, id_);
+        return glMapBufferRange(target_, 0, static_cast<GLsizeiptr>(size_bytes_), GL_MAP_READ_BIT);
+    }
+
+
+    void Buffer::unmap()
+    {
+        if (!id_)
+            return;
+        glBindBuffer(target_, id_);
+        glUnmapBuffer(target_);
+    }
+
+
     void Buffer::clear()
     {
         std::vector<Vec3> data;
@@ -97,6 +152,12 @@ namespace ogl
     }
 
 
+    GLuint Buffer::id() const
+    {
+        return id_;
+    }
+
+
     size_t Buffer::size() const
     {
         return size_;
@@ -0,0 +1,210 @@
+/**
+* This file is part of Menderer.
+*
+* Copyright 2019 Robert Maier, Technical University of Munich.
+* For more information see <https://github.com/robmaier/menderer>.
+*
+* Menderer is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* Menderer is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with Menderer. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <menderer/ogl/depth_pyramid.h>
+
+#include <algorithm>
+#include <string>
+
+
+namespace menderer
+{
+namespace ogl
+{
+
+    DepthPyramid::DepthPyramid() :
+        width_(0),
+        height_(0),
+        built_(false),
+        tex_(),
+        program_(),
+        core_profile_(false),
+        vao_(0)
+    {
+    }
+
+
+    DepthPyramid::~DepthPyramid()
+    {
+        if (vao_)
+            glDeleteVertexArrays(1, &vao_);
+    }
+
+
+    bool DepthPyramid::allocate(int width, int height)
+    {
+        reset();
+
+        // levels with half the resolution of the previous level (down to 1x1, sizes of a mipmap chain)
+        const int w = std::max(width / 2, 1);
+        const int h = std::max(height / 2, 1);
+        int num_levels = 1;
+        while ((w >> num_levels) > 0 || (h >> num_levels) > 0)
+            ++num_levels;
+        if (!tex_.createFloatMipmap(w, h, num_levels))
+        {
+            reset();
+            return false;
+        }
+        tex_.setInterpolation(false);
+        for (int l = 0; l < num_levels; ++l)
+        {
+            std::unique_ptr<Framebuffer> fb(new Framebuffer());
+            fb->attach(tex_, l);
+            fbs_.push_back(std::move(fb));
+        }
+
+        width_ = width;
+        height_ = height;
+        return true;
+    }
+
+
+    bool DepthPyramid::build(Texture &depth)
+    {
+        if (depth.empty())
+            return false;
+
+        // create max-reduction shader (for the profile of the current context)
+        if (!program_.valid())
+        {
+            GLint profile = 0;
+            glGetIntegerv(GL_CONTEXT_PROFILE_MASK, &profile);
+            core_profile_ = (profile & GL_CONTEXT_CORE_PROFILE_BIT) != 0;
+            const std::string folder = core_profile_ ? "core/" : "";
+            if (!program_.create(folder + "depth_pyramid.vs", folder + "depth_pyramid.fs"))
+                return false;
+            // (core profile draws require a vertex array object, even without attributes)
+            if (core_profile_ && !vao_)
+                glGenVertexArrays(1, &vao_);
+        }
+
+        GLint prev_fb = 0;
+        glGetIntegerv(GL_FRAMEBUFFER_BINDING, &prev_fb);
+
+        if ((depth.width() != width_ || depth.height() != height_) && !allocate(depth.width(), depth.height()))
+        {
+            glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(prev_fb));
+            return false;
+        }
+
+        // store state (explicitly, attribute stacks are not available in the core profile)
+        GLint prev_viewport[4];
+        glGetIntegerv(GL_VIEWPORT, prev_viewport);
+        GLboolean prev_depth_mask = GL_TRUE;
+        glGetBooleanv(GL_DEPTH_WRITEMASK, &prev_depth_mask);
+        const GLboolean prev_depth_test = glIsEnabled(GL_DEPTH_TEST);
+        const GLboolean prev_blend = glIsEnabled(GL_BLEND);
+        const GLboolean prev_cull_face = glIsEnabled(GL_CULL_FACE);
+        const GLboolean prev_multisample = glIsEnabled(GL_MULTISAMPLE);
+
+        glDisable(GL_DEPTH_TEST);
+        glDepthMask(GL_FALSE);
+        glDisable(GL_BLEND);
+        glDisable(GL_CULL_FACE);
+        glDisable(GL_MULTISAMPLE);
+
+        // sample exact depth values
+        depth.setInterpolation(false);
+
+        // reduce each level into the next coarser level
+        // (only the source level is accessible for sampling, so that rendering into the next level is no feedback loop)
+        for (int l = 0; l < tex_.levels(); ++l)
+        {
+            Texture* src = &depth;
+            Vec2f src_size(static_cast<float>(depth.width()), static_cast<float>(depth.height()));
+            if (l > 0)
+            {
+                tex_.setLevelRange(l - 1, l - 1);
+                src = &tex_;
+                src_size = Vec2f(static_cast<float>(std::max(tex_.width() >> (l - 1), 1)),
+                                 static_cast<float>(std::max(tex_.height() >> (l - 1), 1)));
+            }
+            fbs_[l]->bind();
+            fbs_[l]->drawBuffers();
+            glViewport(0, 0, std::max(tex_.width() >> l, 1), std::max(tex_.height() >> l, 1));
+
+            program_.enable();
+            program_.add("tex_src", src);
+            program_.add("src_size", src_size);
+            if (core_profile_)
+            {
+                // full screen triangle (generated in the vertex shader)
+                glBindVertexArray(vao_);
+                glDrawArrays(GL_TRIANGLES, 0, 3);
+                glBindVertexArray(0);
+            }
+            else
+            {
+                // full screen quad
+                glBegin(GL_QUADS);
+                glVertex2f(-1.0f, -1.0f);
+                glVertex2f(1.0f, -1.0f);
+                glVertex2f(1.0f, 1.0f);
+                glVertex2f(-1.0f, 1.0f);
+                glEnd();
+            }
+            program_.disable();
+        }
+        tex_.setLevelRange(0, tex_.levels() - 1);
+
+        depth.setInterpolation(true);
+
+        // restore framebuffer and state
+        glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(prev_fb));
+        glViewport(prev_viewport[0], prev_viewport[1], prev_viewport[2], prev_viewport[3]);
+        glDepthMask(prev_depth_mask);
+        if (prev_depth_test)
+            glEnable(GL_DEPTH_TEST);
+        if (prev_blend)
+            glEnable(GL_BLEND);
+        if (prev_cull_face)
+            glEnable(GL_CULL_FACE);
+        if (prev_multisample)
+            glEnable(GL_MULTISAMPLE);
+
+        built_ = true;
+        return true;
+    }
+
+
+    void DepthPyramid::reset()
+    {
+        fbs_.clear();
+        tex_.reset();
+        width_ = 0;
+        height_ = 0;
+        built_ = false;
+    }
+
+
+    bool DepthPyramid::empty() const
+    {
+        return !built_;
+    }
+
+
+    Texture& DepthPyramid::texture()
+    {
+        return tex_;
+    }
+
+} // namespace ogl
+} // namespace menderer
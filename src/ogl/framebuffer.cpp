@@ -60,7 +60,7 @@ namespace ogl
     }
 
 
-    void Framebuffer::attach(const Texture &tex)
+    void Framebuffer::attach(const Texture &tex, int level)
     {
         if (tex.empty())
             return;
@@ -82,14 +82,36 @@ namespace ogl
         bind();
 
         // set texture as color/depth attachments
-        glFramebufferTexture2D(GL_FRAMEBUFFER, attachment_id, GL_TEXTURE_2D, tex.id(), 0);
+        if (tex.isArray())
+        {
+            // layered attachment (all layers, rendering selects the layer with gl_Layer)
+            glFramebufferTexture(GL_FRAMEBUFFER, attachment_id, tex.id(), level);
+        }
+        else
+        {
+            glFramebufferTexture2D(GL_FRAMEBUFFER, attachment_id, GL_TEXTURE_2D, tex.id(), level);
+        }
     }
 
 
     bool Framebuffer::drawBuffers()
     {
-        // set draw buffers list
-        glDrawBuffers(static_cast<int>(draw_buffers_.size()), &draw_buffers_[0]);
+        // set draw buffers list (color attachments only)
+        std::vector<GLenum> color_buffers;
+        for (size_t i = 0; i < draw_buffers_.size(); ++i)
+        {
+            if (draw_buffers_[i] != GL_DEPTH_ATTACHMENT)
+                color_buffers.push_back(draw_buffers_[i]);
+        }
+        if (color_buffers.empty())
+        {
+            GLenum buf = GL_NONE;
+            glDrawBuffers(1, &buf);
+        }
+        else
+        {
+            glDrawBuffers(static_cast<int>(color_buffers.size()), &color_buffers[0]);
+        }
 
         // check if framebuffer is ok
         if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
@@ -108,8 +130,9 @@ namespace ogl
         glDrawBuffers(1, &buf);
 
         // detach attached textures
+        bind();
         for (size_t i = 0; i < draw_buffers_.size(); ++i)
-            glFramebufferTextureEXT(GL_FRAMEBUFFER, draw_buffers_[i], 0, 0);
+            glFramebufferTexture(GL_FRAMEBUFFER, draw_buffers_[i], 0, 0);
         // clear attachments
         draw_buffers_.clear();
 
@@ -20,7 +20,16 @@
 
 #include <menderer/ogl/mesh_renderer.h>
 
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
 #include <iostream>
+#include <limits>
+#include <numeric>
+
+#include <menderer/mesh_util.h>
+#include <menderer/parallel.h>
+#include <menderer/ogl/vertex.h>
 
 
 namespace menderer
@@ -37,18 +46,57 @@ namespace ogl
         std::cout << "   lighting: " << lighting << std::endl;
         std::cout << "   colored: " << colored << std::endl;
         std::cout << "   smooth: " << smooth << std::endl;
-        //std::cout << "   cull_backfaces: " << cull_backfaces << std::endl;
+        std::cout << "   lod_pixel_error: " << lod_pixel_error << std::endl;
+        std::cout << "   cull_clusters: " << cull_clusters << std::endl;
+        std::cout << "   cull_occlusion: " << cull_occlusion << std::endl;
+        std::cout << "   cull_backfaces: " << cull_backfaces << std::endl;
+        std::cout << "   core_profile: " << core_profile << std::endl;
+        std::cout << "   geometry_buffers: " << geometry_buffers << std::endl;
+        std::cout << "   depth_only: " << depth_only << std::endl;
     }
 
 
     MeshRenderer::MeshRenderer(const Config& cfg) :
         cfg_(cfg),
         num_triangles_(0),
+        lod_(0),
+        bbox_min_(Vec3f::Zero()),
+        bbox_max_(Vec3f::Zero()),
+        culling_(false),
+        num_visible_clusters_(0),
+        clip_(Mat4::Identity()),
+        viewport_(Vec4i::Zero()),
+        near_(0.0),
+        depth_pyramid_(),
+        has_prev_depth_(false),
+        occlusion_supported_(-1),
+        program_occlusion_(),
+        buf_cluster_bounds_(GL_SHADER_STORAGE_BUFFER),
+        buf_cluster_ranges_(GL_SHADER_STORAGE_BUFFER),
+        buf_cluster_flags_(GL_SHADER_STORAGE_BUFFER),
+        buf_commands_(GL_SHADER_STORAGE_BUFFER),
+        buf_commands_retest_(GL_SHADER_STORAGE_BUFFER),
+        cluster_flags_(),
+        front_face_cw_(false),
+        has_normals_(false),
+        has_colors_(false),
         buf_verts_(GL_ARRAY_BUFFER),
-        buf_colors_(GL_ARRAY_BUFFER),
-        buf_normals_(GL_ARRAY_BUFFER),
         buf_indices_(GL_ELEMENT_ARRAY_BUFFER),
-        program_()
+        program_(),
+        vao_(0),
+        uniforms_(),
+        projection_(Mat4f::Identity()),
+        modelview_(Mat4f::Identity()),
+        normal_matrix_(Mat3f::Identity()),
+        batch_supported_(-1),
+        program_batch_(),
+        uniforms_batch_(),
+        buf_views_(GL_UNIFORM_BUFFER),
+        geometry_supported_(-1),
+        program_geometry_(),
+        uniforms_geometry_(),
+        buf_face_ids_(GL_TEXTURE_BUFFER),
+        tex_face_ids_()
     {
         configure(cfg);
     }
@@ -56,6 +104,8 @@ namespace ogl
 
     MeshRenderer::~MeshRenderer()
     {
+        if (vao_)
+            glDeleteVertexArrays(1, &vao_);
     }
 
 
@@ -63,6 +113,9 @@ namespace ogl
     {
         cfg_ = cfg;
         createShader(cfg_.shader);
+        // (enabled attribute arrays depend on the config)
+        if (vao_)
+            createVertexArray();
     }
 
 
@@ -74,66 +127,643 @@ namespace ogl
 
     void MeshRenderer::update(const Mesh& mesh)
     {
+        update(mesh.view());
+    }
+
+
+    void MeshRenderer::update(const MeshView& mesh)
+    {
+        has_normals_ = mesh.num_normals > 0 && mesh.num_normals == mesh.num_vertices;
+        has_colors_ = mesh.num_colors > 0 && mesh.num_colors == mesh.num_vertices;
+
+        // interleave vertex attributes
+        std::vector<Vertex> verts(mesh.num_vertices);
+        parallelFor(0, verts.size(), [&](size_t i0, size_t i1)
+        {
+            for (size_t i = i0; i < i1; ++i)
+            {
+                Vertex &v = verts[i];
+                v.position[0] = mesh.vertices[i][0];
+                v.position[1] = mesh.vertices[i][1];
+                v.position[2] = mesh.vertices[i][2];
+                Vertex::packNormal(has_normals_ ? mesh.normals[i] : Vec3f::Zero(), v.normal);
+                v.color[0] = has_colors_ ? mesh.colors[i][0] : 255;
+                v.color[1] = has_colors_ ? mesh.colors[i][1] : 255;
+                v.color[2] = has_colors_ ? mesh.colors[i][2] : 255;
+                v.color[3] = 255;
+            }
+        });
+
+        // bounding box for level of detail selection
+        bbox_min_ = Vec3f::Constant(std::numeric_limits<float>::max());
+        bbox_max_ = Vec3f::Constant(-std::numeric_limits<float>::max());
+        for (size_t i = 0; i < mesh.num_vertices; ++i)
+        {
+            bbox_min_ = bbox_min_.cwiseMin(mesh.vertices[i]);
+            bbox_max_ = bbox_max_.cwiseMax(mesh.vertices[i]);
+        }
+
+        // full resolution level
+        lods_.clear();
+        lod_ = 0;
+        LevelOfDetail lod0;
+        lod0.first_face = 0;
+        lod0.num_faces = mesh.num_faces;
+        lod0.error = 0.0f;
+        lods_.push_back(lod0);
+
+        // full resolution triangles, partitioned into clusters for culling
+        std::vector<Vec3ui> indices;
+        std::vector<unsigned int> face_ids;
+        clusters_.clear();
+        if (cfg_.cull_clusters || cfg_.cull_occlusion)
+        {
+            MeshUtil::buildClusters(mesh, indices, face_ids, clusters_, cfg_.cluster_size);
+
+            // cluster bounds in structure-of-arrays layout for vectorized culling
+            const Eigen::Index num_clusters = static_cast<Eigen::Index>(clusters_.size());
+            cluster_center_.resize(num_clusters, 3);
+            cluster_extent_.resize(num_clusters, 3);
+            cone_apex_.resize(num_clusters, 3);
+            cone_axis_.resize(num_clusters, 3);
+            cone_cutoff_.resize(num_clusters);
+            for (Eigen::Index c = 0; c < num_clusters; ++c)
+            {
+                const MeshUtil::Cluster &cluster = clusters_[static_cast<size_t>(c)];
+                cluster_center_.row(c) = ((cluster.bbox_min + cluster.bbox_max) * 0.5f).transpose();
+                cluster_extent_.row(c) = ((cluster.bbox_max - cluster.bbox_min) * 0.5f).transpose();
+                cone_apex_.row(c) = cluster.cone_apex.transpose();
+                cone_axis_.row(c) = cluster.cone_axis.transpose();
+                cone_cutoff_[c] = cluster.cone_cutoff;
+            }
+
+            if (cfg_.cull_occlusion && supportsOcclusionCulling())
+            {
+                // cluster bounds and index ranges for the occlusion test on the GPU
+                std::vector<float> bounds(clusters_.size() * 8, 0.0f);
+                std::vector<unsigned int> ranges(clusters_.size() * 2);
+                for (size_t c = 0; c < clusters_.size(); ++c)
+                {
+                    for (int i = 0; i < 3; ++i)
+                    {
+                        bounds[c * 8 + i] = clusters_[c].bbox_min[i];
+                        bounds[c * 8 + 4 + i] = clusters_[c].bbox_max[i];
+                    }
+                    ranges[c * 2] = static_cast<unsigned int>(clusters_[c].first_face * 3);
+                    ranges[c * 2 + 1] = static_cast<unsigned int>(clusters_[c].num_faces * 3);
+                }
+                buf_cluster_bounds_.upload(bounds);
+                buf_cluster_ranges_.upload(ranges);
+                buf_commands_.allocate(clusters_.size() * sizeof(DrawCommand), GL_DYNAMIC_COPY);
+                buf_commands_retest_.allocate(clusters_.size() * sizeof(DrawCommand), GL_DYNAMIC_COPY);
+            }
+        }
+        else
+        {
+            indices.assign(mesh.face_vertices, mesh.face_vertices + mesh.num_faces);
+            face_ids.resize(mesh.num_faces);
+            std::iota(face_ids.begin(), face_ids.end(), 0u);
+        }
+        culling_ = false;
+        num_visible_clusters_ = clusters_.size();
+        has_prev_depth_ = false;
+
+        if (cfg_.lod_pixel_error > 0.0f)
+        {
+            // build levels of detail and store their triangles after the full resolution mesh
+            std::vector<MeshUtil::LevelOfDetail> lods;
+            MeshUtil::buildLODs(mesh, lods);
+            for (size_t i = 0; i < lods.size(); ++i)
+            {
+                LevelOfDetail lod;
+                lod.first_face = indices.size();
+                lod.num_faces = lods[i].face_vertices.size();
+                lod.error = lods[i].error;
+                lods_.push_back(lod);
+                indices.insert(indices.end(), lods[i].face_vertices.begin(), lods[i].face_vertices.end());
+            }
+        }
+
         // upload mesh to GPU
-        buf_verts_.upload(mesh.vertices);
-        buf_colors_.upload(mesh.colors);
-        buf_normals_.upload(mesh.normals);
-        buf_indices_.upload(mesh.face_vertices);
-        num_triangles_ = mesh.face_vertices.size();
+        buf_verts_.upload(verts);
+        buf_indices_.upload(indices);
+        num_triangles_ = mesh.num_faces;
+        if (cfg_.geometry_buffers && !face_ids.empty())
+        {
+            // input triangle indices of the full resolution triangles (fetched by the geometry shader)
+            buf_face_ids_.upload(face_ids);
+            tex_face_ids_.createBuffer(buf_face_ids_, GL_R32UI);
+        }
+
+        // attribute arrays are set up once for the core profile (and batches of views)
+        if (cfg_.core_profile || vao_)
+            createVertexArray();
+    }
+
+
+    void MeshRenderer::createVertexArray()
+    {
+        if (!vao_)
+            glGenVertexArrays(1, &vao_);
+        glBindVertexArray(vao_);
+
+        // interleaved vertex attributes at the shader attribute locations
+        const GLsizei stride = sizeof(Vertex);
+        buf_verts_.bind();
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<const void*>(offsetof(Vertex, position)));
+        if (has_normals_)
+        {
+            glEnableVertexAttribArray(1);
+            glVertexAttribPointer(1, 3, GL_BYTE, GL_TRUE, stride, reinterpret_cast<const void*>(offsetof(Vertex, normal)));
+        }
+        else
+        {
+            glDisableVertexAttribArray(1);
+        }
+        if (cfg_.colored && has_colors_)
+        {
+            glEnableVertexAttribArray(2);
+            glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, reinterpret_cast<const void*>(offsetof(Vertex, color)));
+        }
+        else
+        {
+            glDisableVertexAttribArray(2);
+        }
+
+        // index buffer binding is part of the vertex array object
+        buf_indices_.bind();
+        glBindVertexArray(0);
+    }
+
+
+    void MeshRenderer::setView(const RenderContext &render_ctx)
+    {
+        // projection mirrors the image (y axis flipped): front faces are clockwise
+        const Mat4 proj = render_ctx.projectionMatrix();
+        front_face_cw_ = proj(0, 0) * proj(1, 1) < 0.0;
+
+        // matrix uniforms for the core profile
+        const Mat4 mv = render_ctx.modelViewMatrix();
+        projection_ = proj.cast<float>();
+        modelview_ = mv.cast<float>();
+        normal_matrix_ = mv.topLeftCorner<3, 3>().inverse().transpose().cast<float>();
+
+        // (triangle ids of geometry buffers refer to the full resolution mesh)
+        lod_ = 0;
+        if (lods_.size() > 1 && cfg_.lod_pixel_error > 0.0f && !cfg_.geometry_buffers)
+        {
+            // camera center in mesh coordinates
+            const Vec3 center = -mv.topLeftCorner<3, 3>().transpose() * mv.topRightCorner<3, 1>();
+
+            // distance from camera center to the mesh bounding box
+            const Vec3 d = (bbox_min_.cast<double>() - center).cwiseMax(center - bbox_max_.cast<double>()).cwiseMax(0.0);
+            const double dist = d.norm();
+            if (dist > render_ctx.near())
+            {
+                // focal length in pixels from projection matrix and viewport
+                const Vec4i viewport = render_ctx.viewport();
+                const double focal = std::max(std::abs(proj(0, 0)) * viewport[2], std::abs(proj(1, 1)) * viewport[3]) * 0.5;
+
+                // select coarsest level with projected geometric error below the threshold
+                for (size_t i = 1; i < lods_.size(); ++i)
+                {
+                    if (lods_[i].error * focal / dist > cfg_.lod_pixel_error)
+                        break;
+                    lod_ = i;
+                }
+            }
+        }
+
+        // clusters partition the full resolution level only
+        culling_ = false;
+        num_visible_clusters_ = clusters_.size();
+        if (lod_ == 0 && !clusters_.empty())
+            cullClusters(render_ctx);
+    }
+
+
+    void MeshRenderer::cullClusters(const RenderContext &render_ctx)
+    {
+        const Eigen::Index num_clusters = cluster_center_.rows();
+
+        // frustum planes (in mesh coordinates) from the combined projection and modelview matrix
+        const Mat4 mv = render_ctx.modelViewMatrix();
+        const Mat4 clip = render_ctx.projectionMatrix() * mv;
+        clip_ = clip;
+        viewport_ = render_ctx.viewport();
+        near_ = render_ctx.near();
+        // (visibility is computed in place, without temporary arrays)
+        ArrayXb &visible = cluster_visible_;
+        visible.setConstant(num_clusters, true);
+        for (int i = 0; i < 6; ++i)
+        {
+            const Vec4 plane = (clip.row(3) + (i % 2 == 0 ? 1.0 : -1.0) * clip.row(i / 2)).transpose();
+            const Vec4f p = plane.cast<float>();
+            const Vec4f p_abs = p.cwiseAbs();
+            // box is outside if its point farthest along the plane normal is behind the plane
+            visible = visible && (cluster_center_.col(0) * p[0] + cluster_center_.col(1) * p[1] +
+                                  cluster_center_.col(2) * p[2] + p[3] +
+                                  cluster_extent_.col(0) * p_abs[0] + cluster_extent_.col(1) * p_abs[1] +
+                                  cluster_extent_.col(2) * p_abs[2] >= 0.0f);
+        }
+
+        if (cfg_.cull_backfaces)
+        {
+            // cluster is backfacing if the camera center lies within the negative normal cone
+            const Vec3f center = (-mv.topLeftCorner<3, 3>().transpose() * mv.topRightCorner<3, 1>()).cast<float>();
+            const auto dx = cone_apex_.col(0) - center[0];
+            const auto dy = cone_apex_.col(1) - center[1];
+            const auto dz = cone_apex_.col(2) - center[2];
+            const auto dist = (dx * dx + dy * dy + dz * dz).sqrt();
+            const auto d = dx * cone_axis_.col(0) + dy * cone_axis_.col(1) + dz * cone_axis_.col(2);
+            visible = visible && ((cone_cutoff_ > 1.0f) || (d < cone_cutoff_ * dist));
+        }
+
+        setDrawRanges(cluster_visible_);
+        num_visible_clusters_ = static_cast<size_t>(cluster_visible_.count());
+        culling_ = true;
+    }
+
+
+    void MeshRenderer::setDrawRanges(const ArrayXb &clusters)
+    {
+        draw_counts_.clear();
+        draw_offsets_.clear();
+        for (Eigen::Index c = 0; c < clusters.size(); ++c)
+        {
+            if (!clusters[c])
+                continue;
+            const MeshUtil::Cluster &cluster = clusters_[static_cast<size_t>(c)];
+            const GLsizei count = static_cast<GLsizei>(cluster.num_faces * 3);
+            if (c > 0 && clusters[c - 1])
+            {
+                draw_counts_.back() += count;
+            }
+            else
+            {
+                draw_counts_.push_back(count);
+                draw_offsets_.push_back(reinterpret_cast<const GLvoid*>(cluster.first_face * sizeof(Vec3ui)));
+            }
+        }
     }
 
 
-    void MeshRenderer::draw()
+    void MeshRenderer::drawRanges(bool geometry)
+    {
+        if (geometry)
+        {
+            // primitive ids restart for each draw call and are offset by the first triangle of the range
+            for (size_t i = 0; i < draw_counts_.size(); ++i)
+            {
+                const size_t first_face = reinterpret_cast<size_t>(draw_offsets_[i]) / sizeof(Vec3ui);
+                program_geometry_.add(uniforms_geometry_.first_face, static_cast<int>(first_face));
+                glDrawElements(GL_TRIANGLES, draw_counts_[i], GL_UNSIGNED_INT, draw_offsets_[i]);
+            }
+        }
+        else if (!draw_counts_.empty())
+            glMultiDrawElements(GL_TRIANGLES, draw_counts_.data(), GL_UNSIGNED_INT,
+                                draw_offsets_.data(), static_cast<GLsizei>(draw_counts_.size()));
+    }
+
+
+    void MeshRenderer::testOcclusion(Buffer &commands)
+    {
+        program_occlusion_.enable();
+        buf_cluster_bounds_.bindBase(0);
+        buf_cluster_ranges_.bindBase(1);
+        buf_cluster_flags_.bindBase(2);
+        commands.bindBase(3);
+        program_occlusion_.add("pyramid", &depth_pyramid_.texture());
+        program_occlusion_.add("clip", Mat4f(clip_.cast<float>()));
+        program_occlusion_.add("viewport", Vec4f(viewport_.cast<float>()));
+        program_occlusion_.add("near_plane", static_cast<float>(near_));
+        program_occlusion_.add("num_clusters", static_cast<int>(clusters_.size()));
+        glDispatchCompute(static_cast<GLuint>((clusters_.size() + 63) / 64), 1, 1);
+        program_occlusion_.disable();
+
+        // draw commands and rejected clusters are read by the draw calls and the next test
+        glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+
+
+    void MeshRenderer::drawIndirect(Buffer &commands, bool geometry)
+    {
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commands.id());
+        if (geometry)
+        {
+            // primitive ids restart for each draw call and are offset by the first triangle of the cluster
+            // (occluded clusters are drawn with zero instances)
+            for (size_t c = 0; c < clusters_.size(); ++c)
+            {
+                if (!cluster_visible_[static_cast<Eigen::Index>(c)])
+                    continue;
+                program_geometry_.add(uniforms_geometry_.first_face, static_cast<int>(clusters_[c].first_face));
+                glDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, reinterpret_cast<const void*>(c * sizeof(DrawCommand)));
+            }
+        }
+        else
+        {
+            glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, static_cast<GLsizei>(clusters_.size()), 0);
+        }
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    }
+
+
+    size_t MeshRenderer::lod() const
+    {
+        return lod_;
+    }
+
+
+    size_t MeshRenderer::numVisibleClusters() const
+    {
+        return num_visible_clusters_;
+    }
+
+
+    void MeshRenderer::draw(Texture* depth)
     {
         if (buf_verts_.empty() || num_triangles_ == 0)
             return;
 
+        // build depth pyramid from the previous frame before clearing
+        const bool occlusion = culling_ && cfg_.cull_occlusion && depth && supportsOcclusionCulling();
+        const bool test_occlusion = occlusion && has_prev_depth_ && depth_pyramid_.build(*depth);
+        if (test_occlusion)
+        {
+            // test the frustum-visible clusters against the previous frame's depth
+            // (on the GPU, the draw commands are written without waiting for the depth buffer)
+            cluster_flags_.resize(static_cast<size_t>(cluster_visible_.size()));
+            for (Eigen::Index c = 0; c < cluster_visible_.size(); ++c)
+                cluster_flags_[static_cast<size_t>(c)] = cluster_visible_[c] ? 1 : 0;
+            buf_cluster_flags_.upload(cluster_flags_, GL_STREAM_DRAW);
+            testOcclusion(buf_commands_);
+        }
+
+        // geometry buffers are written by the GLSL 3.30 shaders (also in a compatibility profile context)
+        const bool geometry = writesGeometryBuffers();
+        const bool core = cfg_.core_profile || geometry;
+        Program &program = geometry ? program_geometry_ : program_;
+        const Uniforms &uniforms = geometry ? uniforms_geometry_ : uniforms_;
+        if (geometry && !vao_)
+            createVertexArray();
+
         // fill background
+        clear(writesLinearDepth(), geometry);
+
+        // (the core profile cannot draw without shader and vertex array)
+        if (core && (!program.valid() || !vao_))
+            return;
+        auto begin = [&]()
+        {
+            if (!core)
+            {
+                beginDraw();
+                return;
+            }
+            beginDrawCore(program, uniforms);
+            if (geometry)
+                program.add("face_ids", &tex_face_ids_);
+        };
+        auto end = [&]()
+        {
+            if (core)
+                endDrawCore(program);
+            else
+                endDraw();
+        };
+        begin();
+
+        if (occlusion)
+        {
+            if (test_occlusion)
+            {
+                // draw clusters that are not occluded by the previous frame's depth
+                drawIndirect(buf_commands_, geometry);
+
+                // re-test rejected clusters against the depth drawn so far
+                end();
+                const bool ok = depth_pyramid_.build(*depth);
+                if (ok)
+                    testOcclusion(buf_commands_retest_);
+                begin();
+                if (ok)
+                    drawIndirect(buf_commands_retest_, geometry);
+                else
+                    drawRanges(geometry);   // (all frustum-visible clusters, without the re-test)
+            }
+            else
+            {
+                // no previous frame: draw all frustum-visible clusters
+                drawRanges(geometry);
+            }
+            has_prev_depth_ = true;
+        }
+        else if (culling_)
+        {
+            // draw visible clusters of the full resolution level
+            drawRanges(geometry);
+        }
+        else
+        {
+            // draw triangles of selected level of detail using index buffer
+            const LevelOfDetail &lod = lods_[lod_];
+            if (geometry)
+                program.add(uniforms.first_face, static_cast<int>(lod.first_face));
+            glDrawElements(GL_TRIANGLES, static_cast<GLint>(lod.num_faces * 3), GL_UNSIGNED_INT,
+                           reinterpret_cast<const void*>(lod.first_face * sizeof(Vec3ui)));
+        }
+
+        end();
+    }
+
+
+    void MeshRenderer::clear(bool linear_depth, bool geometry)
+    {
         glClearColor(cfg_.background[0], cfg_.background[1], cfg_.background[2], cfg_.background[3]);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        glClear(cfg_.depth_only ? GL_DEPTH_BUFFER_BIT : (GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
+        if (linear_depth)
+        {
+            // no surface (NaN) in linear depth buffer (the only draw buffer for depth-only rendering)
+            const GLfloat no_depth[4] = {std::numeric_limits<float>::quiet_NaN(), 0.0f, 0.0f, 0.0f};
+            glClearBufferfv(GL_COLOR, cfg_.depth_only ? ColorBuffer : LinearDepthBuffer, no_depth);
+        }
+        if (geometry)
+        {
+            // no surface in geometry buffers (zero vertices and normals as in vertex maps from depth, triangle id -1)
+            const GLfloat zero[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+            const GLint no_face[4] = {-1, 0, 0, 0};
+            glClearBufferfv(GL_COLOR, VertexMapBuffer, zero);
+            glClearBufferfv(GL_COLOR, NormalMapBuffer, zero);
+            glClearBufferiv(GL_COLOR, FaceIdBuffer, no_face);
+            glClearBufferfv(GL_COLOR, BarycentricBuffer, zero);
+        }
+    }
+
+
+    bool MeshRenderer::writesLinearDepth() const
+    {
+        return program_.valid() || program_geometry_.valid();
+    }
+
+
+    bool MeshRenderer::writesGeometryBuffers()
+    {
+        if (!cfg_.geometry_buffers || cfg_.depth_only)
+            return false;
+        if (geometry_supported_ < 0)
+            geometry_supported_ = createGeometryShader() ? 1 : 0;
+        return geometry_supported_ == 1;
+    }
+
+
+    bool MeshRenderer::supportsOcclusionCulling()
+    {
+        if (occlusion_supported_ < 0)
+        {
+            occlusion_supported_ = 0;
+            // compute shaders and indirect multi-draws (OpenGL 4.3)
+            GLint major = 0, minor = 0;
+            glGetIntegerv(GL_MAJOR_VERSION, &major);
+            glGetIntegerv(GL_MINOR_VERSION, &minor);
+            if (major > 4 || (major == 4 && minor >= 3))
+                occlusion_supported_ = program_occlusion_.createCompute("core/cluster_occlusion.cs") ? 1 : 0;
+            else
+                std::cerr << "occlusion culling requires OpenGL 4.3 (using view frustum culling only)!" << std::endl;
+        }
+        return occlusion_supported_ == 1;
+    }
+
+
+    bool MeshRenderer::supportsBatch()
+    {
+        if (batch_supported_ < 0)
+        {
+            batch_supported_ = 0;
+            // GLSL 3.30 (OpenGL 3.3)
+            GLint major = 0, minor = 0;
+            glGetIntegerv(GL_MAJOR_VERSION, &major);
+            glGetIntegerv(GL_MINOR_VERSION, &minor);
+            if (major > 3 || (major == 3 && minor >= 3))
+            {
+                // gl_Layer output of the vertex shader
+                GLint num_extensions = 0;
+                glGetIntegerv(GL_NUM_EXTENSIONS, &num_extensions);
+                for (GLint i = 0; i < num_extensions; ++i)
+                {
+                    const std::string ext(reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(i))));
+                    if (ext == "GL_ARB_shader_viewport_layer_array" || ext == "GL_AMD_vertex_shader_layer")
+                        batch_supported_ = 1;
+                }
+            }
+        }
+        return batch_supported_ == 1;
+    }
+
+
+    bool MeshRenderer::drawBatch(const RenderContext &render_ctx, const std::vector<Mat4> &modelviews)
+    {
+        if (!supportsBatch())
+            return false;
+        // shader and vertex array are created on first use
+        if (!program_batch_.valid() && !createBatchShader())
+            return false;
+        if (!vao_)
+            createVertexArray();
+
+        // fill background of all layers (batch shaders always write linear depth)
+        clear(true, false);
+        if (buf_verts_.empty() || num_triangles_ == 0 || modelviews.empty())
+            return true;
+
+        // projection is shared by all views
+        const Mat4 proj = render_ctx.projectionMatrix();
+        front_face_cw_ = proj(0, 0) * proj(1, 1) < 0.0;
+        projection_ = proj.cast<float>();
+        beginDrawCore(program_batch_, uniforms_batch_);
 
+        // view matrices in std140 layout (column-major model view and normal matrix as mat4 per view)
+        const size_t max_views = static_cast<size_t>(MaxBatchViews);
+        std::vector<float> views(max_views * 32, 0.0f);
+        const LevelOfDetail &lod = lods_[0];
+        for (size_t first = 0; first < modelviews.size(); first += max_views)
+        {
+            const size_t num_views = std::min(modelviews.size() - first, max_views);
+            for (size_t i = 0; i < num_views; ++i)
+            {
+                const Mat4 &mv = modelviews[first + i];
+                Eigen::Map<Mat4f> modelview(&views[i * 32]);
+                Eigen::Map<Mat4f> normal_matrix(&views[i * 32 + 16]);
+                modelview = mv.cast<float>();
+                normal_matrix.topLeftCorner<3, 3>() = mv.topLeftCorner<3, 3>().inverse().transpose().cast<float>();
+            }
+            buf_views_.upload(views, GL_STREAM_DRAW);
+            buf_views_.bindBase(0);
+
+            // one instance per view (rendered into layer first + instance)
+            program_batch_.add(uniforms_batch_.first_view, static_cast<int>(first));
+            glDrawElementsInstanced(GL_TRIANGLES, static_cast<GLsizei>(lod.num_faces * 3), GL_UNSIGNED_INT,
+                                    reinterpret_cast<const void*>(lod.first_face * sizeof(Vec3ui)),
+                                    static_cast<GLsizei>(num_views));
+        }
+
+        endDrawCore(program_batch_);
+        return true;
+    }
+
+
+    void MeshRenderer::beginDraw()
+    {
         // configure depth test
         glPushAttrib(GL_ALL_ATTRIB_BITS);
         glEnable(GL_DEPTH_TEST);
         glDepthFunc(GL_LEQUAL);
 
-        // set up lighting
-        if (cfg_.lighting)
-            setupLighting();
+        // (depth-only rendering needs no lighting, material, blending or shading attributes)
+        if (!cfg_.depth_only)
+        {
+            // set up lighting
+            if (cfg_.lighting)
+                setupLighting();
 
-        // shade model
-        glShadeModel(cfg_.smooth ? GL_SMOOTH : GL_FLAT);
+            // shade model
+            glShadeModel(cfg_.smooth ? GL_SMOOTH : GL_FLAT);
 
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-        glEnable(GL_MULTISAMPLE);
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            // (linear depth is not blended with the background)
+            glDisablei(GL_BLEND, LinearDepthBuffer);
 
-        // set up color and material
-        glColor4fv(cfg_.color.data());
-        setupMaterial();
+            // set up color and material
+            glColor4fv(cfg_.color.data());
+            setupMaterial();
+        }
+        glEnable(GL_MULTISAMPLE);
 
+        // set up interleaved vertex attributes
+        const GLsizei stride = sizeof(Vertex);
         glEnableClientState(GL_VERTEX_ARRAY);
         buf_verts_.bind();
-        glVertexPointer(3, GL_DOUBLE, 0, nullptr);
+        glVertexPointer(3, GL_FLOAT, stride, reinterpret_cast<const void*>(offsetof(Vertex, position)));
 
-        if (!buf_normals_.empty())
+        if (has_normals_ && !cfg_.depth_only)
         {
             glEnableClientState(GL_NORMAL_ARRAY);
-            buf_normals_.bind();
-            glNormalPointer(GL_DOUBLE, 0, nullptr);
+            glNormalPointer(GL_BYTE, stride, reinterpret_cast<const void*>(offsetof(Vertex, normal)));
         }
 
         // set up colors
-        if (cfg_.colored && !buf_colors_.empty())
+        if (cfg_.colored && has_colors_ && !cfg_.depth_only)
         {
             glEnableClientState(GL_COLOR_ARRAY);
-            buf_colors_.bind();
-            glColorPointer(3, GL_UNSIGNED_BYTE, 0, nullptr);
+            glColorPointer(4, GL_UNSIGNED_BYTE, stride, reinterpret_cast<const void*>(offsetof(Vertex, color)));
         }
 
         if (cfg_.cull_backfaces)
         {
             // backface culling
+            glFrontFace(front_face_cw_ ? GL_CW : GL_CCW);
             glCullFace(GL_BACK);
             glEnable(GL_CULL_FACE);
         }
@@ -146,16 +776,17 @@ namespace ogl
         if (program_.valid())
             program_.enable();
 
-        // draw triangles using index buffer
         buf_indices_.bind();
-        glDrawElements(GL_TRIANGLES, static_cast<GLint>(num_triangles_ * 3),
-                       GL_UNSIGNED_INT, nullptr);
+    }
+
 
+    void MeshRenderer::endDraw()
+    {
         // disable client states
         glDisableClientState(GL_VERTEX_ARRAY);
-        if (!buf_normals_.empty())
+        if (has_normals_ && !cfg_.depth_only)
             glDisableClientState(GL_NORMAL_ARRAY);
-        if (cfg_.colored && !buf_colors_.empty())
+        if (cfg_.colored && has_colors_ && !cfg_.depth_only)
             glDisableClientState(GL_COLOR_ARRAY);
 
         // disable shader
@@ -165,8 +796,87 @@ namespace ogl
         glDisable(GL_MULTISAMPLE);
         glDisable(GL_BLEND);
         glPopAttrib();
+    }
+
+
+    void MeshRenderer::beginDrawCore(Program &program, const Uniforms &uniforms)
+    {
+        // configure depth test
+        glEnable(GL_DEPTH_TEST);
+        glDepthFunc(GL_LEQUAL);
 
-        glPopMatrix();
+        if (!cfg_.depth_only)
+        {
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            // (linear depth and geometry buffers are not blended with the background)
+            for (GLuint i = LinearDepthBuffer; i < NumDrawBuffers; ++i)
+                glDisablei(GL_BLEND, i);
+        }
+        glEnable(GL_MULTISAMPLE);
+
+        if (cfg_.cull_backfaces)
+        {
+            // backface culling
+            glFrontFace(front_face_cw_ ? GL_CW : GL_CCW);
+            glCullFace(GL_BACK);
+            glEnable(GL_CULL_FACE);
+        }
+        else
+        {
+            glDisable(GL_CULL_FACE);
+        }
+
+        // only the matrices change per frame (other uniforms are set with the shader)
+        program.enable();
+        program.add(uniforms.projection, projection_);
+        program.add(uniforms.modelview, modelview_);
+        program.add(uniforms.normal_matrix, normal_matrix_);
+
+        // constant attributes replace disabled arrays (default normal and material color)
+        glBindVertexArray(vao_);
+        if (!has_normals_)
+            glVertexAttrib3f(1, 0.0f, 0.0f, 1.0f);
+        if (!cfg_.colored || !has_colors_)
+            glVertexAttrib4fv(2, cfg_.color.data());
+    }
+
+
+    void MeshRenderer::endDrawCore(Program &program)
+    {
+        glBindVertexArray(0);
+        program.disable();
+
+        glDisable(GL_CULL_FACE);
+        glDisable(GL_MULTISAMPLE);
+        glDisable(GL_BLEND);
+        glDisable(GL_DEPTH_TEST);
+    }
+
+
+    void MeshRenderer::lightColors(Vec4f &ambient, Vec4f &diffuse, Vec4f &specular) const
+    {
+        const bool shader = program_.valid() && !cfg_.shader.empty() && cfg_.shader != "none";
+        if (!shader)
+        {
+            // fixed-function lighting
+            ambient = Vec4f(0.2f, 0.2f, 0.2f, 1.0f);
+            diffuse = Vec4f(0.7f, 0.7f, 0.7f, 1.0f);
+            specular = Vec4f(0.0f, 0.0f, 0.0f, 1.0f);
+        }
+        else if (cfg_.lighting)
+        {
+            ambient = Vec4f(0.2f, 0.2f, 0.2f, 1.0f);
+            diffuse = Vec4f(0.6f, 0.6f, 0.6f, 1.0f);
+            specular = Vec4f(0.8f, 0.8f, 0.8f, 1.0f);
+        }
+        else
+        {
+            // OpenGL defaults of light 0
+            ambient = Vec4f(0.0f, 0.0f, 0.0f, 1.0f);
+            diffuse = Vec4f(1.0f, 1.0f, 1.0f, 1.0f);
+            specular = Vec4f(1.0f, 1.0f, 1.0f, 1.0f);
+        }
     }
 
 
@@ -182,15 +892,8 @@ namespace ogl
         glEnable(GL_NORMALIZE);
 
         // light color
-        Vec4f ambient(0.2f, 0.2f, 0.2f, 1.0f);
-        Vec4f diffuse(0.7f, 0.7f, 0.7f, 1.0f);
-        Vec4f specular(0.0f, 0.0f, 0.0f, 1.0f);
-        if (program_.valid())
-        {
-            ambient = Vec4f(0.2f, 0.2f, 0.2f, 1.0f);
-            diffuse = Vec4f(0.6f, 0.6f, 0.6f, 1.0f);
-            specular = Vec4f(0.8f, 0.8f, 0.8f, 1.0f);
-        }
+        Vec4f ambient, diffuse, specular;
+        lightColors(ambient, diffuse, specular);
 
         glLightfv(GL_LIGHT0, GL_AMBIENT, ambient.data());
         glLightfv(GL_LIGHT0, GL_DIFFUSE, diffuse.data());
@@ -224,15 +927,104 @@ namespace ogl
             // delete shader if existing
             program_.reset();
         }
+        // (batch and geometry buffer shaders are created on first use)
+        if (program_batch_.valid())
+            program_batch_.reset();
+        if (program_geometry_.valid())
+            program_geometry_.reset();
+        geometry_supported_ = -1;
 
-        if (shader_name.empty() || shader_name == "none")
+        if (cfg_.core_profile)
+        {
+            // core profile shaders (fixed-function colors and lighting as shader "color")
+            const std::string name = coreShaderName(shader_name);
+            if (program_.create("core/" + name + ".vs", "core/" + name + ".fs"))
+                setupUniforms(program_, uniforms_);
+            return;
+        }
+
+        // (depth-only rendering uses a trivial shader instead of fixed-function state)
+        const std::string name = cfg_.depth_only ? "depth" : shader_name;
+        if (name.empty() || name == "none")
             return;
 
         // create shader
-        if (!shader_name.empty())
+        program_.create(name + ".vs", name + ".fs");
+    }
+
+
+    std::string MeshRenderer::coreShaderName(const std::string &shader_name) const
+    {
+        if (cfg_.depth_only)
+            return "depth";
+        return (shader_name.empty() || shader_name == "none") ? "color" : shader_name;
+    }
+
+
+    bool MeshRenderer::createBatchShader()
+    {
+        // batch vertex shaders (view matrices from uniform block) with the core profile fragment shaders
+        const std::string name = coreShaderName(cfg_.shader);
+        if (!program_batch_.create("core/" + name + "_batch.vs", "core/" + name + ".fs"))
+            return false;
+        setupUniforms(program_batch_, uniforms_batch_);
+        if (!program_batch_.bindUniformBlock("Views", 0))
         {
-            program_.create(shader_name + ".vs", shader_name + ".fs");
+            std::cerr << "batch shader has no view uniform block!" << std::endl;
+            program_batch_.reset();
+            return false;
         }
+        return true;
+    }
+
+
+    bool MeshRenderer::createGeometryShader()
+    {
+        // GLSL 3.30 (OpenGL 3.3)
+        GLint major = 0, minor = 0;
+        glGetIntegerv(GL_MAJOR_VERSION, &major);
+        glGetIntegerv(GL_MINOR_VERSION, &minor);
+        if (major < 3 || (major == 3 && minor < 3))
+        {
+            std::cerr << "geometry buffers require OpenGL 3.3!" << std::endl;
+            return false;
+        }
+
+        // core profile shaders with the geometry buffer outputs enabled and a geometry shader for triangle ids
+        const std::string name = coreShaderName(cfg_.shader);
+        std::string defines = "#define GEOMETRY_BUFFERS\n";
+        if (name == "color")
+            defines += "#define VERTEX_COLOR\n";
+        if (!program_geometry_.create("core/" + name + ".vs", "core/" + name + ".fs", "core/geometry.gs", defines))
+            return false;
+        setupUniforms(program_geometry_, uniforms_geometry_);
+        return true;
+    }
+
+
+    void MeshRenderer::setupUniforms(Program &program, Uniforms &uniforms)
+    {
+        // matrix uniforms are set per frame
+        uniforms.projection = program.uniformLoc("projection");
+        uniforms.modelview = program.uniformLoc("modelview");
+        uniforms.normal_matrix = program.uniformLoc("normal_matrix");
+        uniforms.first_view = program.uniformLoc("first_view");
+        uniforms.first_face = program.uniformLoc("first_face");
+
+        // constant uniforms (replacing fixed-function light and material state)
+        Vec4f ambient, diffuse, specular;
+        lightColors(ambient, diffuse, specular);
+        program.enable();
+        program.add("color", cfg_.color);
+        program.add("scene_ambient", Vec4f(0.2f, 0.2f, 0.2f, 1.0f));
+        program.add("light_position", Vec3f(0.0f, 0.0f, 1.0f));
+        program.add("light_ambient", ambient);
+        program.add("light_diffuse", diffuse);
+        program.add("light_specular", specular);
+        program.add("shininess", 96.0f);
+        program.add("lighting", cfg_.lighting ? 1 : 0);
+        program.add("flat_shading", cfg_.smooth ? 0 : 1);
+        program.disable();
     }
 
 } // namespace ogl
@@ -41,8 +41,10 @@ namespace ogl
         fragment_shader_id_(0),
         vertex_shader_id_(0),
         geometry_shader_id_(0),
+        compute_shader_id_(0),
         valid_(false),
-        shader_folder_(std::string(STR(APP_SOURCE_DIR)) + "/src/ogl/shaders/")
+        shader_folder_(std::string(STR(APP_SOURCE_DIR)) + "/src/ogl/shaders/"),
+        defines_()
     {
     }
 
@@ -53,11 +55,13 @@ namespace ogl
     }
 
 
-    bool Program::create(const std::string &vert_shader, const std::string &frag_shader, const std::string &geom_shader)
+    bool Program::create(const std::string &vert_shader, const std::string &frag_shader, const std::string &geom_shader,
+                         const std::string &defines)
     {
         // create program
         if (!program_id_)
             program_id_ = glCreateProgram();
+        defines_ = defines;
 
         // create OpenGL shader program
         if (!vert_shader.empty())
@@ -72,7 +76,7 @@ namespace ogl
         }
         if (!geom_shader.empty())
         {
-            if (!addShader(Program::FragmentShader, geom_shader))
+            if (!addShader(Program::GeometryShader, geom_shader))
                 std::cerr << "geometry shader could not be created!" << std::endl;
         }
 
@@ -87,6 +91,28 @@ namespace ogl
     }
 
 
+    bool Program::createCompute(const std::string &comp_shader, const std::string &defines)
+    {
+        // create program
+        if (!program_id_)
+            program_id_ = glCreateProgram();
+        defines_ = defines;
+
+        // create OpenGL compute program
+        if (!addShader(Program::ComputeShader, comp_shader))
+            std::cerr << "compute shader could not be created!" << std::endl;
+
+        if (!compile())
+        {
+            reset();
+            return false;
+        }
+
+        valid_ = true;
+        return true;
+    }
+
+
     bool Program::valid() const
     {
         return valid_;
@@ -111,6 +137,11 @@ namespace ogl
             deleteShader(geometry_shader_id_);
             geometry_shader_id_ = 0;
         }
+        if (compute_shader_id_)
+        {
+            deleteShader(compute_shader_id_);
+            compute_shader_id_ = 0;
+        }
 
         // delete program
         if (program_id_)
@@ -138,6 +169,8 @@ namespace ogl
             glAttachShader(program_id_, vertex_shader_id_);
         if (geometry_shader_id_)
             glAttachShader(program_id_, geometry_shader_id_);
+        if (compute_shader_id_)
+            glAttachShader(program_id_, compute_shader_id_);
 
         // link program
         glLinkProgram(program_id_);
@@ -154,8 +187,10 @@ namespace ogl
             ok = createShader(fragment_shader_id_, type, name);
         else if (type == VertexShader)
             ok = createShader(vertex_shader_id_, type, name);
-        else
+        else if (type == GeometryShader)
             ok = createShader(geometry_shader_id_, type, name);
+        else
+            ok = createShader(compute_shader_id_, type, name);
         return ok;
     }
 
@@ -285,12 +320,40 @@ namespace ogl
     }
 
 
+    void Program::add(int location, int val)
+    {
+        glUniform1i(location, val);
+    }
+
+
+    void Program::add(int location, const Mat3f &mat)
+    {
+        glUniformMatrix3fv(location, 1, 0, mat.data());
+    }
+
+
+    void Program::add(int location, const Mat4f &mat)
+    {
+        glUniformMatrix4fv(location, 1, 0, mat.data());
+    }
+
+
     int Program::uniformLoc(const std::string &name) const
     {
         return glGetUniformLocation(program_id_, name.c_str());
     }
 
 
+    bool Program::bindUniformBlock(const std::string &name, unsigned int binding)
+    {
+        const GLuint index = glGetUniformBlockIndex(program_id_, name.c_str());
+        if (index == GL_INVALID_INDEX)
+            return false;
+        glUniformBlockBinding(program_id_, index, binding);
+        return true;
+    }
+
+
     void Program::enable()
     {
         // use program
@@ -322,6 +385,8 @@ namespace ogl
             shader_type = GL_FRAGMENT_SHADER; break;
         case VertexShader:
             shader_type = GL_VERTEX_SHADER; break;
+        case ComputeShader:
+            shader_type = GL_COMPUTE_SHADER; break;
         default:
             shader_type = GL_GEOMETRY_SHADER; break;
         }
@@ -364,6 +429,14 @@ namespace ogl
         file.close();
         code = ss.str();
 
+        if (!defines_.empty())
+        {
+            // insert preprocessor definitions after the version directive (which must come first)
+            size_t pos = code.compare(0, 8, "#version") == 0 ? 0 : code.find("\n#version");
+            pos = (pos == std::string::npos) ? 0 : code.find('\n', pos + 1) + 1;
+            code.insert(pos, defines_);
+        }
+
         return code;
     }
 
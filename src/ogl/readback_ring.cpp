@@ -0,0 +1,155 @@
+/**
+* This file is part of Menderer.
+*
+* Copyright 2019 Robert Maier, Technical University of Munich.
+* For more information see <https://github.com/robmaier/menderer>.
+*
+* Menderer is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* Menderer is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with Menderer. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <menderer/ogl/readback_ring.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+
+namespace menderer
+{
+namespace ogl
+{
+
+    ReadbackRing::ReadbackRing(size_t num_buffers) :
+        first_(0),
+        count_(0)
+    {
+        for (size_t i = 0; i < std::max(num_buffers, size_t(1)); ++i)
+            slots_.push_back(std::unique_ptr<Slot>(new Slot()));
+    }
+
+
+    ReadbackRing::~ReadbackRing()
+    {
+        reset();
+    }
+
+
+    bool ReadbackRing::push(const std::vector<Texture*> &textures, size_t frame)
+    {
+        if (full() || textures.empty())
+            return false;
+        Slot &slot = *slots_[(first_ + count_) % slots_.size()];
+
+        // output images and their (aligned) offsets within the pixel buffer
+        slot.images.resize(textures.size());
+        slot.offsets.resize(textures.size());
+        size_t byte_size = 0;
+        for (size_t i = 0; i < textures.size(); ++i)
+        {
+            slot.images[i] = cv::Mat();
+            textures[i]->createFromCurrent(slot.images[i]);
+            slot.offsets[i] = byte_size;
+            byte_size += (slot.images[i].total() * slot.images[i].elemSize() + 15) / 16 * 16;
+        }
+        if (slot.buffer.byteSize() != byte_size)
+            slot.buffer.allocate(byte_size);
+
+        // copy textures into the pixel buffer and insert fence
+        slot.buffer.bind();
+        for (size_t i = 0; i < textures.size(); ++i)
+            textures[i]->downloadToPixelBuffer(slot.offsets[i]);
+        slot.buffer.unbind();
+        slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        slot.frame = frame;
+        ++count_;
+
+        return true;
+    }
+
+
+    bool ReadbackRing::pop(std::vector<cv::Mat> &images, size_t &frame, bool wait)
+    {
+        if (empty())
+            return false;
+        Slot &slot = *slots_[first_];
+
+        // check (or wait for) completion of the readback
+        GLenum status = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        while (wait && status == GL_TIMEOUT_EXPIRED)
+            status = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+        if (status == GL_TIMEOUT_EXPIRED)
+            return false;
+        glDeleteSync(slot.fence);
+        slot.fence = nullptr;
+        first_ = (first_ + 1) % slots_.size();
+        --count_;
+        if (status == GL_WAIT_FAILED)
+        {
+            std::cerr << "readback of frame " << slot.frame << " failed!" << std::endl;
+            return false;
+        }
+
+        // copy images from the mapped pixel buffer
+        const unsigned char* data = static_cast<const unsigned char*>(slot.buffer.mapRead());
+        if (data)
+        {
+            for (size_t i = 0; i < slot.images.size(); ++i)
+                std::memcpy(slot.images[i].data, data + slot.offsets[i], slot.images[i].total() * slot.images[i].elemSize());
+            slot.buffer.unmap();
+        }
+        slot.buffer.unbind();
+        if (!data)
+            return false;
+
+        // hand over images (the slot does not keep references)
+        images.swap(slot.images);
+        slot.images.clear();
+        frame = slot.frame;
+        return true;
+    }
+
+
+    void ReadbackRing::reset()
+    {
+        for (size_t i = 0; i < slots_.size(); ++i)
+        {
+            if (slots_[i]->fence)
+                glDeleteSync(slots_[i]->fence);
+            slots_[i]->fence = nullptr;
+            slots_[i]->images.clear();
+        }
+        first_ = 0;
+        count_ = 0;
+    }
+
+
+    size_t ReadbackRing::size() const
+    {
+        return count_;
+    }
+
+
+    bool ReadbackRing::empty() const
+    {
+        return count_ == 0;
+    }
+
+
+    bool ReadbackRing::full() const
+    {
+        return count_ == slots_.size();
+    }
+
+} // namespace ogl
+} // namespace menderer
@@ -214,15 +214,16 @@ namespace ogl
     {
         int w = depth.cols;
         int h = depth.rows;
-        cv::Mat depth_out = cv::Mat::zeros(h, w, depth.type());
         float n = static_cast<float>(near_);
         float f = static_cast<float>(far_);
 
+        // (converted in place)
         for (int y = 0; y < h; ++y)
         {
+            float* row = depth.ptr<float>(y);
             for (int x = 0; x < w; ++x)
             {
-                float d = depth.at<float>(y, x);
+                float d = row[x];
 
                 float d_scaled;
                 if (d == 1.0f)
@@ -237,11 +238,9 @@ namespace ogl
                     d_scaled = (2.0f * n * f) / (f + n - zn * (f - n));
                 }
 
-                depth_out.at<float>(y, x) = d_scaled;
+                row[x] = d_scaled;
             }
         }
-
-        depth = depth_out;
     }
 
 } // namespace ogl
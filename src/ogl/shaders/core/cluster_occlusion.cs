@@ -0,0 +1,122 @@
+/**
+* This file is part of Menderer.
+*
+* Copyright 2019 Robert Maier, Technical University of Munich.
+* For more information see <https://github.com/robmaier/menderer>.
+*
+* Menderer is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* Menderer is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with Menderer. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#version 430 core
+
+layout(local_size_x = 64) in;
+
+// cluster bounding boxes (min and max corner) in mesh coordinates
+layout(std430, binding = 0) readonly buffer ClusterBounds
+{
+    vec4 bounds[];
+};
+
+// first index and number of indices of the clusters in the index buffer
+layout(std430, binding = 1) readonly buffer ClusterRanges
+{
+    uvec2 ranges[];
+};
+
+// candidate clusters (input), set to the clusters rejected by this test (output)
+layout(std430, binding = 2) buffer ClusterFlags
+{
+    uint flags[];
+};
+
+// indirect draw commands (one per cluster, not drawn with zero instances)
+struct DrawCommand
+{
+    uint count;
+    uint instance_count;
+    uint first_index;
+    int base_vertex;
+    uint base_instance;
+};
+layout(std430, binding = 3) writeonly buffer DrawCommands
+{
+    DrawCommand commands[];
+};
+
+// maximum depth pyramid (level l texels cover 2^(l+1) x 2^(l+1) pixels)
+uniform sampler2D pyramid;
+// projection and modelview matrix, viewport and near plane
+uniform mat4 clip;
+uniform vec4 viewport;
+uniform float near_plane;
+uniform int num_clusters;
+
+bool isOccluded(vec3 bbox_min, vec3 bbox_max)
+{
+    // project bounding box corners into window coordinates
+    vec2 rect_min = vec2(3.402823e38);
+    vec2 rect_max = vec2(-3.402823e38);
+    float depth_min = 1.0;
+    for (int i = 0; i < 8; ++i)
+    {
+        vec4 p = vec4((i & 1) != 0 ? bbox_max.x : bbox_min.x,
+                      (i & 2) != 0 ? bbox_max.y : bbox_min.y,
+                      (i & 4) != 0 ? bbox_max.z : bbox_min.z, 1.0);
+        vec4 q = clip * p;
+        // box intersects the near plane
+        if (q.w < near_plane)
+            return false;
+        vec2 pt = viewport.xy + (q.xy / q.w + 1.0) * 0.5 * viewport.zw;
+        rect_min = min(rect_min, pt);
+        rect_max = max(rect_max, pt);
+        depth_min = min(depth_min, (q.z / q.w + 1.0) * 0.5);
+    }
+
+    // coarsest necessary level: rectangle covers at most 3x3 texels
+    float extent = max(rect_max.x - rect_min.x, rect_max.y - rect_min.y);
+    int num_levels = textureQueryLevels(pyramid);
+    int level = 0;
+    while (level + 1 < num_levels && float(2 << level) * 2.0 < extent)
+        ++level;
+    ivec2 size = textureSize(pyramid, level);
+    float scale = 1.0 / float(2 << level);
+    ivec2 p0 = clamp(ivec2(floor(rect_min * scale)), ivec2(0), size - 1);
+    ivec2 p1 = clamp(ivec2(floor(rect_max * scale)), ivec2(0), size - 1);
+
+    // occluded if the rectangle is behind the farthest covered depth
+    float depth_max = 0.0;
+    for (int y = p0.y; y <= p1.y; ++y)
+        for (int x = p0.x; x <= p1.x; ++x)
+            depth_max = max(depth_max, texelFetch(pyramid, ivec2(x, y), level).r);
+    return depth_min > depth_max;
+}
+
+void main()
+{
+    int c = int(gl_GlobalInvocationID.x);
+    if (c >= num_clusters)
+        return;
+
+    // test candidate clusters and draw the ones that are not occluded
+    bool candidate = flags[c] != 0u;
+    bool occluded = candidate && isOccluded(bounds[2 * c].xyz, bounds[2 * c + 1].xyz);
+    flags[c] = occluded ? 1u : 0u;
+
+    commands[c].count = ranges[c].y;
+    commands[c].instance_count = (candidate && !occluded) ? 1u : 0u;
+    commands[c].first_index = ranges[c].x;
+    commands[c].base_vertex = 0;
+    commands[c].base_instance = 0u;
+}
@@ -0,0 +1,65 @@
+/**
+* This file is part of Menderer.
+*
+* Copyright 2019 Robert Maier, Technical University of Munich.
+* For more information see <https://github.com/robmaier/menderer>.
+*
+* Menderer is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* Menderer is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with Menderer. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#version 330 core
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 normal_in;
+layout(location = 2) in vec4 color_in;
+
+uniform mat4 projection;
+uniform mat4 modelview;
+uniform mat3 normal_matrix;
+uniform bool lighting;
+uniform vec4 scene_ambient;
+uniform vec4 light_ambient;
+uniform vec4 light_diffuse;
+
+out VertexData
+{
+#ifdef GEOMETRY_BUFFERS
+    vec3 normal;
+    vec3 vpos;
+#endif
+    vec4 color;
+    flat vec4 color_flat;
+};
+
+void main()
+{
+    // per-vertex color (equivalent to fixed-function color material)
+    color = color_in;
+    if (lighting)
+    {
+        // directional light along the eye z-axis
+        vec3 n = normalize(normal_matrix * normal_in);
+        vec3 lit = color_in.rgb * scene_ambient.rgb + color_in.rgb * light_ambient.rgb +
+                   max(n.z, 0.0) * color_in.rgb * light_diffuse.rgb;
+        color = vec4(min(lit, 1.0), color_in.a);
+    }
+    color_flat = color;
+    // output vertex
+    vec4 pos = modelview * vec4(position, 1.0);
+#ifdef GEOMETRY_BUFFERS
+    normal = normal_matrix * normal_in;
+    vpos = vec3(pos);
+#endif
+    gl_Position = projection * pos;
+}
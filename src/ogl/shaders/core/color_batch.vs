@@ -0,0 +1,71 @@
+/**
+* This file is part of Menderer.
+*
+* Copyright 2019 Robert Maier, Technical University of Munich.
+* For more information see <https://github.com/robmaier/menderer>.
+*
+* Menderer is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* Menderer is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with Menderer. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#version 330 core
+// (layer selection in the vertex shader)
+#extension GL_ARB_shader_viewport_layer_array : enable
+#extension GL_AMD_vertex_shader_layer : enable
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 normal_in;
+layout(location = 2) in vec4 color_in;
+
+// view matrices of the batch (one view per instance)
+struct View
+{
+    mat4 modelview;
+    mat4 normal_matrix;     // (upper 3x3 block)
+};
+
+layout(std140) uniform Views
+{
+    View views[64];
+};
+
+uniform mat4 projection;
+uniform int first_view;
+uniform bool lighting;
+uniform vec4 scene_ambient;
+uniform vec4 light_ambient;
+uniform vec4 light_diffuse;
+
+out VertexData
+{
+    vec4 color;
+    flat vec4 color_flat;
+};
+
+void main()
+{
+    // per-vertex color (equivalent to fixed-function color material)
+    color = color_in;
+    if (lighting)
+    {
+        // directional light along the eye z-axis
+        vec3 n = normalize(mat3(views[gl_InstanceID].normal_matrix) * normal_in);
+        vec3 lit = color_in.rgb * scene_ambient.rgb + color_in.rgb * light_ambient.rgb +
+                   max(n.z, 0.0) * color_in.rgb * light_diffuse.rgb;
+        color = vec4(min(lit, 1.0), color_in.a);
+    }
+    color_flat = color;
+    // output vertex into the layer of the view
+    gl_Position = projection * views[gl_InstanceID].modelview * vec4(position, 1.0);
+    gl_Layer = first_view + gl_InstanceID;
+}
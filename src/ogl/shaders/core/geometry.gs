@@ -0,0 +1,77 @@
+/**
+* This file is part of Menderer.
+*
+* Copyright 2019 Robert Maier, Technical University of Munich.
+* For more information see <https://github.com/robmaier/menderer>.
+*
+* Menderer is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* Menderer is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with Menderer. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#version 330 core
+
+layout(triangles) in;
+layout(triangle_strip, max_vertices = 3) out;
+
+// triangle indices of the input mesh (per triangle of the index buffer)
+uniform usamplerBuffer face_ids;
+// index of the first triangle of the draw call in the index buffer
+uniform int first_face;
+
+in VertexData
+{
+    vec3 normal;
+    vec3 vpos;
+#ifdef VERTEX_COLOR
+    vec4 color;
+    flat vec4 color_flat;
+#endif
+} vertex_in[];
+
+out VertexData
+{
+    vec3 normal;
+    vec3 vpos;
+#ifdef VERTEX_COLOR
+    vec4 color;
+    flat vec4 color_flat;
+#endif
+} vertex_out;
+
+out GeometryData
+{
+    vec3 barycentric;
+    flat int face_id;
+} geometry_out;
+
+void main()
+{
+    // (primitive ids restart at zero for each draw call)
+    int face_id = int(texelFetch(face_ids, first_face + gl_PrimitiveIDIn).r);
+
+    // pass the triangle through with barycentric coordinates of its corners
+    for (int i = 0; i < 3; ++i)
+    {
+        vertex_out.normal = vertex_in[i].normal;
+        vertex_out.vpos = vertex_in[i].vpos;
+#ifdef VERTEX_COLOR
+        vertex_out.color = vertex_in[i].color;
+        vertex_out.color_flat = vertex_in[i].color_flat;
+#endif
+        geometry_out.barycentric = vec3(float(i == 0), float(i == 1), float(i == 2));
+        geometry_out.face_id = face_id;
+        gl_Position = gl_in[i].gl_Position;
+        EmitVertex();
+    }
+    EndPrimitive();
+}
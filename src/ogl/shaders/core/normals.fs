@@ -0,0 +1,63 @@
+/**
+* This file is part of Menderer.
+*
+* Copyright 2019 Robert Maier, Technical University of Munich.
+* For more information see <https://github.com/robmaier/menderer>.
+*
+* Menderer is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* Menderer is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with Menderer. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#version 330 core
+
+in VertexData
+{
+    vec3 normal;
+#ifdef GEOMETRY_BUFFERS
+    vec3 vpos;
+#endif
+};
+
+layout(location = 0) out vec4 frag_color;
+layout(location = 1) out vec4 frag_depth;
+
+#ifdef GEOMETRY_BUFFERS
+// triangle of the fragment (from the geometry shader)
+in GeometryData
+{
+    vec3 barycentric;
+    flat int face_id;
+};
+
+layout(location = 2) out vec4 frag_vertex;
+layout(location = 3) out vec4 frag_normal;
+layout(location = 4) out int frag_face_id;
+layout(location = 5) out vec4 frag_barycentric;
+#endif
+
+void main()
+{
+    // use normal for output color
+    vec3 color = vec3(normalize(normal)) * 0.5 + 0.5;
+    // output color
+    frag_color = vec4(color, 1.0);
+    // output linear (metric) depth
+    frag_depth = vec4(1.0 / gl_FragCoord.w, 0.0, 0.0, 1.0);
+#ifdef GEOMETRY_BUFFERS
+    // vertex and normal in camera coordinates (y and z axis of the eye space flipped)
+    frag_vertex = vec4(vpos * vec3(1.0, -1.0, -1.0), 1.0);
+    frag_normal = vec4(normalize(normal) * vec3(1.0, -1.0, -1.0), 0.0);
+    frag_face_id = face_id;
+    frag_barycentric = vec4(barycentric, 0.0);
+#endif
+}
@@ -0,0 +1,84 @@
+/**
+* This file is part of Menderer.
+*
+* Copyright 2019 Robert Maier, Technical University of Munich.
+* For more information see <https://github.com/robmaier/menderer>.
+*
+* Menderer is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* Menderer is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with Menderer. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#version 330 core
+
+uniform vec3 light_position;
+uniform vec4 light_ambient;
+uniform vec4 light_diffuse;
+uniform vec4 light_specular;
+uniform float shininess;
+
+in VertexData
+{
+    vec3 normal;
+    vec3 vpos;
+};
+
+layout(location = 0) out vec4 frag_color;
+layout(location = 1) out vec4 frag_depth;
+
+#ifdef GEOMETRY_BUFFERS
+// triangle of the fragment (from the geometry shader)
+in GeometryData
+{
+    vec3 barycentric;
+    flat int face_id;
+};
+
+layout(location = 2) out vec4 frag_vertex;
+layout(location = 3) out vec4 frag_normal;
+layout(location = 4) out int frag_face_id;
+layout(location = 5) out vec4 frag_barycentric;
+#endif
+
+void main()
+{
+    // use normal for output color
+    vec3 color3 = normal * 0.5 + 0.5;
+    vec4 color = vec4(color3, 1.0);
+
+    // vectors for shading computation
+    vec3 n = normalize(normal);
+    vec3 light_dir = normalize(light_position - vpos);
+    vec3 E = normalize(-vpos);
+    vec3 R = normalize(-reflect(light_dir, n));
+
+    // ambient term
+    vec4 ambient = color * light_ambient;
+    // diffuse term
+    vec4 diffuse = color * light_diffuse * max(dot(n, light_dir), 0.0);
+    diffuse = clamp(diffuse, 0.0, 1.0);
+    // specular term
+    vec4 specular = color * light_specular * pow(max(dot(R, E), 0.0), 0.3 * shininess);
+    specular = clamp(specular, 0.0, 1.0);
+
+    // output color
+    frag_color = ambient + diffuse + specular;
+    // output linear (metric) depth
+    frag_depth = vec4(1.0 / gl_FragCoord.w, 0.0, 0.0, 1.0);
+#ifdef GEOMETRY_BUFFERS
+    // vertex and normal in camera coordinates (y and z axis of the eye space flipped)
+    frag_vertex = vec4(vpos * vec3(1.0, -1.0, -1.0), 1.0);
+    frag_normal = vec4(normalize(normal) * vec3(1.0, -1.0, -1.0), 0.0);
+    frag_face_id = face_id;
+    frag_barycentric = vec4(barycentric, 0.0);
+#endif
+}
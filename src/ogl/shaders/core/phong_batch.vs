@@ -0,0 +1,60 @@
+/**
+* This file is part of Menderer.
+*
+* Copyright 2019 Robert Maier, Technical University of Munich.
+* For more information see <https://github.com/robmaier/menderer>.
+*
+* Menderer is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* Menderer is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with Menderer. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#version 330 core
+// (layer selection in the vertex shader)
+#extension GL_ARB_shader_viewport_layer_array : enable
+#extension GL_AMD_vertex_shader_layer : enable
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 normal_in;
+
+// view matrices of the batch (one view per instance)
+struct View
+{
+    mat4 modelview;
+    mat4 normal_matrix;     // (upper 3x3 block)
+};
+
+layout(std140) uniform Views
+{
+    View views[64];
+};
+
+uniform mat4 projection;
+uniform int first_view;
+
+out VertexData
+{
+    vec3 normal;
+    vec3 vpos;
+};
+
+void main()
+{
+    // vertex normal
+    normal = normalize(mat3(views[gl_InstanceID].normal_matrix) * normal_in);
+    // vertex position
+    vec4 pos = views[gl_InstanceID].modelview * vec4(position, 1.0);
+    vpos = vec3(pos);
+    // output vertex position into the layer of the view
+    gl_Position = projection * pos;
+    gl_Layer = first_view + gl_InstanceID;
+}
@@ -0,0 +1,42 @@
+/**
+* This file is part of Menderer.
+*
+* Copyright 2019 Robert Maier, Technical University of Munich.
+* For more information see <https://github.com/robmaier/menderer>.
+*
+* Menderer is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* Menderer is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with Menderer. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#version 120
+
+uniform sampler2D tex_src;
+uniform vec2 src_size;
+
+void main()
+{
+    // maximum depth of the source texels 2x ... 2x+2
+    // (covers the footprint for odd source sizes)
+    vec2 base = floor(gl_FragCoord.xy) * 2.0;
+    float depth = 0.0;
+    for (int y = 0; y < 3; ++y)
+    {
+        for (int x = 0; x < 3; ++x)
+        {
+            vec2 p = min(base + vec2(float(x), float(y)), src_size - 1.0) + 0.5;
+            depth = max(depth, texture2D(tex_src, p / src_size).r);
+        }
+    }
+    // output depth
+    gl_FragColor = vec4(depth, 0.0, 0.0, 1.0);
+}
@@ -28,5 +28,7 @@ void main()
     // use normal for output color
     vec3 color = vec3(normalize(normal)) * 0.5 + 0.5;
     // output color
-    gl_FragColor = vec4(color, 1.0);
+    gl_FragData[0] = vec4(color, 1.0);
+    // output linear (metric) depth
+    gl_FragData[1] = vec4(1.0 / gl_FragCoord.w, 0.0, 0.0, 1.0);
 }
@@ -42,5 +42,7 @@ void main()
     specular = clamp(specular, 0.0, 1.0); 
 
     // output color
-    gl_FragColor = gl_FrontLightModelProduct.sceneColor + ambient + diffuse + specular;
+    gl_FragData[0] = gl_FrontLightModelProduct.sceneColor + ambient + diffuse + specular;
+    // output linear (metric) depth
+    gl_FragData[1] = vec4(1.0 / gl_FragCoord.w, 0.0, 0.0, 1.0);
 }
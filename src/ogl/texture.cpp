@@ -1,9 +1,12 @@
 #include <menderer/ogl/texture.h>
 
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <sstream>
 
+#include <menderer/ogl/buffer.h>
+
 
 namespace menderer
 {
@@ -18,6 +21,9 @@ namespace ogl
         image_type_(0),
         width_(0),
         height_(0),
+        layers_(1),
+        levels_(1),
+        target_(GL_TEXTURE_2D),
         type_(UByte)
     {
     }
@@ -52,6 +58,79 @@ namespace ogl
     }
 
 
+    bool Texture::createFloat(int width, int height)
+    {
+        return init(Float, width, height, GL_R32F, GL_RED);
+    }
+
+
+    bool Texture::createFloatMipmap(int width, int height, int levels)
+    {
+        return init(Float, width, height, GL_R32F, GL_RED, 0, levels);
+    }
+
+
+    bool Texture::createFloatRGB(int width, int height)
+    {
+        return init(Float, width, height, GL_RGB32F, GL_RGB);
+    }
+
+
+    bool Texture::createInt(int width, int height)
+    {
+        return init(Int, width, height, GL_R32I, GL_RED_INTEGER);
+    }
+
+
+    bool Texture::createBuffer(const Buffer &buffer, int internal_format)
+    {
+        if (buffer.empty())
+            return false;
+        // (the target of a texture cannot be changed after it was bound)
+        if (id_ && target_ != GL_TEXTURE_BUFFER)
+            reset();
+        target_ = GL_TEXTURE_BUFFER;
+        if (!id_)
+        {
+            glGenTextures(1, &id_);
+            if (!id_)
+                return false;
+        }
+        internal_format_ = internal_format;
+
+        // texels are the buffer data (no image storage, sampling parameters or downloads)
+        bind();
+        glTexBuffer(GL_TEXTURE_BUFFER, static_cast<GLenum>(internal_format), buffer.id());
+        unbind();
+
+        return true;
+    }
+
+
+    bool Texture::createBGRArray(Type type, int width, int height, int layers)
+    {
+        if (layers < 1)
+            return false;
+        return init(type, width, height, GL_RGB, GL_BGR, layers);
+    }
+
+
+    bool Texture::createDepthArray(int width, int height, int layers)
+    {
+        if (layers < 1)
+            return false;
+        return init(Float, width, height, GL_DEPTH_COMPONENT, GL_DEPTH_COMPONENT, layers);
+    }
+
+
+    bool Texture::createFloatArray(int width, int height, int layers)
+    {
+        if (layers < 1)
+            return false;
+        return init(Float, width, height, GL_R32F, GL_RED, layers);
+    }
+
+
     bool Texture::init(const cv::Mat &img)
     {
         // determine image type
@@ -66,8 +145,13 @@ namespace ogl
     }
 
 
-    bool Texture::init(Type type, int width, int height, int internal_format, GLenum image_format)
+    bool Texture::init(Type type, int width, int height, int internal_format, GLenum image_format, int layers, int levels)
     {
+        // (the target of a texture cannot be changed after it was bound)
+        const GLenum target = layers > 0 ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+        if (id_ && target != target_)
+            reset();
+        target_ = target;
         if (!id_)
         {
             glGenTextures(1, &id_);
@@ -79,6 +163,8 @@ namespace ogl
         type_ = type;
         width_ = width;
         height_ = height;
+        layers_ = std::max(layers, 1);
+        levels_ = std::max(levels, 1);
         image_type_ = convertTypeToOGL(type);
         internal_format_ = internal_format;
         image_format_ = image_format;
@@ -86,12 +172,14 @@ namespace ogl
         // set texture interpolation and clamping
         bind();
         // set texture clamping
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_R, GL_CLAMP);
+        glTexParameteri(target_, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(target_, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(target_, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
         // set texture interpolation
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(target_, GL_TEXTURE_MIN_FILTER, levels_ > 1 ? GL_LINEAR_MIPMAP_NEAREST : GL_LINEAR);
+        glTexParameteri(target_, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(target_, GL_TEXTURE_BASE_LEVEL, 0);
+        glTexParameteri(target_, GL_TEXTURE_MAX_LEVEL, levels_ - 1);
         unbind();
 
         // upload
@@ -114,6 +202,8 @@ namespace ogl
         image_type_ = 0;
         width_ = 0;
         height_ = 0;
+        layers_ = 1;
+        levels_ = 1;
         type_ = UByte;
     }
 
@@ -124,7 +214,7 @@ namespace ogl
             return;
         unit_ = unit;
         glActiveTexture(GL_TEXTURE0 + unit_);
-        glBindTexture(GL_TEXTURE_2D, id_);
+        glBindTexture(target_, id_);
     }
 
 
@@ -133,7 +223,31 @@ namespace ogl
         if (!id_)
             return;
         glActiveTexture(GL_TEXTURE0 + unit_);
-        glBindTexture(GL_TEXTURE_2D, 0);
+        glBindTexture(target_, 0);
+    }
+
+
+    void Texture::setInterpolation(bool linear)
+    {
+        if (!id_)
+            return;
+        bind();
+        const GLint filter = linear ? GL_LINEAR : GL_NEAREST;
+        const GLint min_filter = levels_ > 1 ? (linear ? GL_LINEAR_MIPMAP_NEAREST : GL_NEAREST_MIPMAP_NEAREST) : filter;
+        glTexParameteri(target_, GL_TEXTURE_MIN_FILTER, min_filter);
+        glTexParameteri(target_, GL_TEXTURE_MAG_FILTER, filter);
+        unbind();
+    }
+
+
+    void Texture::setLevelRange(int base_level, int max_level)
+    {
+        if (!id_)
+            return;
+        bind();
+        glTexParameteri(target_, GL_TEXTURE_BASE_LEVEL, base_level);
+        glTexParameteri(target_, GL_TEXTURE_MAX_LEVEL, max_level);
+        unbind();
     }
 
 
@@ -168,10 +282,28 @@ namespace ogl
         glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
         // upload data to texture
         bind();
-        if (data)
-            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width_, height_, image_format_, image_type_, data);
+        if (isArray())
+        {
+            // all layers at once
+            if (data)
+                glTexSubImage3D(target_, 0, 0, 0, 0, width_, height_, layers_, image_format_, image_type_, data);
+            else
+                glTexImage3D(target_, 0, internal_format_, width_, height_, layers_, 0, image_format_, image_type_, data);
+        }
         else
-            glTexImage2D(GL_TEXTURE_2D, 0, internal_format_, width_, height_, 0, image_format_, image_type_, data);
+        {
+            if (data)
+            {
+                glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width_, height_, image_format_, image_type_, data);
+            }
+            else
+            {
+                // (mipmap levels are allocated with the sizes of a complete mipmap chain)
+                for (int l = 0; l < levels_; ++l)
+                    glTexImage2D(GL_TEXTURE_2D, l, internal_format_, std::max(width_ >> l, 1), std::max(height_ >> l, 1),
+                                 0, image_format_, image_type_, data);
+            }
+        }
         unbind();
 
         return true;
@@ -183,19 +315,32 @@ namespace ogl
         if (!id_ || empty())
             return false;
 
-        // create output image if not created yet or if sizes don't match
+        // create output image from internal format if not created yet or if size or type don't match
+        // (preallocated images of the right size and type are reused without allocation)
+        createFromCurrent(img);
         if (img.empty())
-        {
-            img.release();
-            // create from internal format
-            createFromCurrent(img);
-        }
+            return false;
 
         // set tight OpenGL row alignment state
         glPixelStorei(GL_PACK_ALIGNMENT, 1);
         // download texture
         bind();
-        glGetTexImage(GL_TEXTURE_2D, 0, image_format_, image_type_, img.data);
+        glGetTexImage(target_, 0, image_format_, image_type_, img.data);
+        unbind();
+
+        return true;
+    }
+
+
+    bool Texture::downloadToPixelBuffer(size_t offset)
+    {
+        if (!id_ || empty())
+            return false;
+
+        // download texture into the bound pixel pack buffer (returns without waiting for the data)
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        bind();
+        glGetTexImage(target_, 0, image_format_, image_type_, reinterpret_cast<void*>(offset));
         unbind();
 
         return true;
@@ -319,7 +464,8 @@ namespace ogl
     {
         // determine OpenCV image type from internal format
         int num_channels = 0;
-        if (image_format_ == GL_LUMINANCE || image_format_ == GL_RED || image_format_ == GL_INTENSITY)
+        if (image_format_ == GL_LUMINANCE || image_format_ == GL_RED || image_format_ == GL_INTENSITY ||
+            image_format_ == GL_RED_INTEGER)
             num_channels = 1;
         else if (image_format_ == GL_LUMINANCE_ALPHA)
             num_channels = 2;
@@ -363,14 +509,26 @@ namespace ogl
                 t = CV_32FC4;
         }
 
+        else if (type_ == Int)
+        {
+            if (num_channels == 1)
+                t = CV_32SC1;
+            else if (num_channels == 2)
+                t = CV_32SC2;
+            else if (num_channels == 3)
+                t = CV_32SC3;
+            else if (num_channels == 4)
+                t = CV_32SC4;
+        }
+
         // special cases
         if (t == 0 && image_format_ == GL_DEPTH_COMPONENT)
             t = CV_32FC1;
 
         if (t != 0)
         {
-            // create OpenCV image
-            img.create(height_, width_, t);
+            // create OpenCV image (with the layers of array textures stacked vertically)
+            img.create(height_ * layers_, width_, t);
         }
     }
 
@@ -392,6 +550,24 @@ namespace ogl
     }
 
 
+    int Texture::layers() const
+    {
+        return layers_;
+    }
+
+
+    int Texture::levels() const
+    {
+        return levels_;
+    }
+
+
+    bool Texture::isArray() const
+    {
+        return target_ == GL_TEXTURE_2D_ARRAY;
+    }
+
+
     bool Texture::empty() const
     {
         return (width_ * height_ == 0);
@@ -406,7 +582,7 @@ namespace ogl
             return false;
 
         // image dimensions
-        if (img.rows != height_ || img.cols != width_)
+        if (img.rows != height_ * layers_ || img.cols != width_)
             return false;
 
         // check if input image format is right
@@ -0,0 +1,158 @@
+/**
+* This file is part of Menderer.
+*
+* Copyright 2019 Robert Maier, Technical University of Munich.
+* For more information see <https://github.com/robmaier/menderer>.
+*
+* Menderer is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* Menderer is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with Menderer. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <menderer/output_stage.h>
+
+#include <algorithm>
+#include <exception>
+#include <iostream>
+
+#include <menderer/parallel.h>
+
+
+namespace menderer
+{
+
+    OutputStage::OutputStage(size_t num_threads, size_t max_pending) :
+        max_pending_(max_pending),
+        num_submitted_(0),
+        num_completed_(0),
+        num_failed_(0),
+        stop_(false)
+    {
+        if (num_threads == 0)
+            num_threads = numThreads();
+        if (max_pending_ == 0)
+            max_pending_ = 2 * num_threads;
+        max_pending_ = std::max(max_pending_, num_threads);
+
+        for (size_t i = 0; i < num_threads; ++i)
+            threads_.push_back(std::thread(&OutputStage::work, this));
+    }
+
+
+    OutputStage::~OutputStage()
+    {
+        finish();
+    }
+
+
+    size_t OutputStage::push(const Job &job)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        // backpressure: wait until a pending job has completed
+        cv_done_.wait(lock, [&]() { return num_submitted_ - num_completed_ < max_pending_; });
+
+        const size_t seq = num_submitted_++;
+        done_.push_back(false);
+        queue_.push_back(std::make_pair(seq, job));
+        cv_job_.notify_one();
+        return seq;
+    }
+
+
+    void OutputStage::wait(size_t num_jobs)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        num_jobs = std::min(num_jobs, num_submitted_);
+        cv_done_.wait(lock, [&]() { return num_completed_ >= num_jobs; });
+    }
+
+
+    bool OutputStage::finish()
+    {
+        // drain the queue before stopping the workers
+        wait(static_cast<size_t>(-1));
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cv_job_.notify_all();
+        for (size_t i = 0; i < threads_.size(); ++i)
+            threads_[i].join();
+        threads_.clear();
+
+        return numFailed() == 0;
+    }
+
+
+    size_t OutputStage::numCompleted() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return num_completed_;
+    }
+
+
+    size_t OutputStage::numFailed() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return num_failed_;
+    }
+
+
+    size_t OutputStage::maxPending() const
+    {
+        return max_pending_;
+    }
+
+
+    void OutputStage::work()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true)
+        {
+            cv_job_.wait(lock, [&]() { return stop_ || !queue_.empty(); });
+            if (queue_.empty())
+                return;
+            std::pair<size_t, Job> job = queue_.front();
+            queue_.pop_front();
+
+            // run job without holding the lock
+            // (exceptions must not escape the worker thread, the job counts as failed)
+            lock.unlock();
+            bool ok = false;
+            try
+            {
+                ok = job.second();
+            }
+            catch (const std::exception &e)
+            {
+                std::cerr << "output job " << job.first << " failed: " << e.what() << std::endl;
+            }
+            catch (...)
+            {
+                std::cerr << "output job " << job.first << " failed!" << std::endl;
+            }
+            lock.lock();
+
+            if (!ok)
+                ++num_failed_;
+            // advance in-order completion over all leading completed jobs
+            done_[job.first - num_completed_] = true;
+            while (!done_.empty() && done_.front())
+            {
+                done_.pop_front();
+                ++num_completed_;
+            }
+            cv_done_.notify_all();
+        }
+    }
+
+} // namespace menderer
@@ -0,0 +1,110 @@
+/**
+* This file is part of Menderer.
+*
+* Copyright 2019 Robert Maier, Technical University of Munich.
+* For more information see <https://github.com/robmaier/menderer>.
+*
+* Menderer is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* Menderer is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with Menderer. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <menderer/parallel.h>
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+
+namespace menderer
+{
+
+    size_t numThreads()
+    {
+        unsigned int num_threads = std::thread::hardware_concurrency();
+        return num_threads > 0 ? static_cast<size_t>(num_threads) : 1;
+    }
+
+
+    void parallelFor(size_t begin, size_t end,
+                     const std::function<void(size_t, size_t)> &func,
+                     size_t num_blocks)
+    {
+        if (end <= begin)
+            return;
+        const size_t n = end - begin;
+        if (num_blocks == 0)
+            num_blocks = numThreads();
+        num_blocks = std::min(num_blocks, n);
+
+        // blocks are fetched dynamically by the worker threads
+        std::atomic<size_t> next_block(0);
+        auto worker = [&]()
+        {
+            size_t b;
+            while ((b = next_block++) < num_blocks)
+                func(begin + b * n / num_blocks, begin + (b + 1) * n / num_blocks);
+        };
+
+        // calling thread works on blocks as well
+        const size_t num_workers = std::min(num_blocks, numThreads());
+        std::vector<std::thread> threads;
+        for (size_t i = 1; i < num_workers; ++i)
+            threads.push_back(std::thread(worker));
+        worker();
+        for (size_t i = 0; i < threads.size(); ++i)
+            threads[i].join();
+    }
+
+
+
+    template<typename T>
+    T parallelExclusiveScan(std::vector<T> &values)
+    {
+        // sum up blocks, scan the block sums and then scan within the blocks
+        const size_t n = values.size();
+        const size_t num_blocks = std::max<size_t>(1, std::min(numThreads() * 4, n / 16384));
+        std::vector<T> block_sums(num_blocks + 1, T(0));
+        parallelFor(0, num_blocks, [&](size_t b0, size_t b1)
+        {
+            for (size_t b = b0; b < b1; ++b)
+            {
+                T sum = T(0);
+                for (size_t i = b * n / num_blocks; i < (b + 1) * n / num_blocks; ++i)
+                    sum += values[i];
+                block_sums[b + 1] = sum;
+            }
+        }, num_blocks);
+        for (size_t b = 0; b < num_blocks; ++b)
+            block_sums[b + 1] += block_sums[b];
+        parallelFor(0, num_blocks, [&](size_t b0, size_t b1)
+        {
+            for (size_t b = b0; b < b1; ++b)
+            {
+                T sum = block_sums[b];
+                for (size_t i = b * n / num_blocks; i < (b + 1) * n / num_blocks; ++i)
+                {
+                    T val = values[i];
+                    values[i] = sum;
+                    sum += val;
+                }
+            }
+        }, num_blocks);
+        return block_sums[num_blocks];
+    }
+
+    // template function instantiations
+    template unsigned int parallelExclusiveScan<unsigned int>(std::vector<unsigned int> &values);
+    template size_t parallelExclusiveScan<size_t>(std::vector<size_t> &values);
+
+} // namespace menderer
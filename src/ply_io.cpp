@@ -20,10 +20,22 @@
 
 #include <menderer/ply_io.h>
 
-#include <iostream>
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <locale>
+#include <sstream>
 #include <vector>
 
+#include <menderer/mapped_file.h>
+#include <menderer/parallel.h>
+
 
 namespace menderer
 {
@@ -32,10 +44,876 @@ namespace menderer
     {
         if (filename.empty())
             return false;
-        std::ifstream file(filename.c_str(), std::ios::binary);
-        if (!file)
+
+        // map ply file into memory
+        MappedFile file;
+        if (!file.open(filename))
+            return false;
+
+        // decode triangle meshes directly into the mesh arrays
+        Header header;
+        if (readHeader(file.data(), file.size(), header))
+        {
+            bool ok;
+            if (header.format == Ascii)
+                ok = loadAscii(file.data(), file.size(), header, mesh);
+            else
+                ok = loadBinary(file.data(), file.size(), header, mesh);
+            if (ok)
+                return true;
+            mesh.clear();
+        }
+        file.close();
+
+        // fall back to happly for all other files
+        return loadHapply(filename, mesh);
+    }
+
+
+    PlyIO::Type PlyIO::parseType(const std::string &name)
+    {
+        if (name == "char" || name == "int8")
+            return Int8;
+        else if (name == "uchar" || name == "uint8")
+            return UInt8;
+        else if (name == "short" || name == "int16")
+            return Int16;
+        else if (name == "ushort" || name == "uint16")
+            return UInt16;
+        else if (name == "int" || name == "int32")
+            return Int32;
+        else if (name == "uint" || name == "uint32")
+            return UInt32;
+        else if (name == "float" || name == "float32")
+            return Float32;
+        else if (name == "double" || name == "float64")
+            return Float64;
+        return Invalid;
+    }
+
+
+    size_t PlyIO::typeSize(Type type)
+    {
+        switch (type)
+        {
+        case Int8:
+        case UInt8:
+            return 1;
+        case Int16:
+        case UInt16:
+            return 2;
+        case Int32:
+        case UInt32:
+        case Float32:
+            return 4;
+        case Float64:
+            return 8;
+        default:
+            return 0;
+        }
+    }
+
+
+    template<typename T>
+    T PlyIO::readValue(const char* ptr, Type type, bool swap_bytes)
+    {
+        // copy raw bytes (and convert from big endian if necessary)
+        char buf[8];
+        const size_t num_bytes = typeSize(type);
+        if (swap_bytes)
+            std::reverse_copy(ptr, ptr + num_bytes, buf);
+        else
+            std::memcpy(buf, ptr, num_bytes);
+
+        switch (type)
+        {
+        case Int8:
+            { int8_t v; std::memcpy(&v, buf, sizeof(v)); return static_cast<T>(v); }
+        case UInt8:
+            { uint8_t v; std::memcpy(&v, buf, sizeof(v)); return static_cast<T>(v); }
+        case Int16:
+            { int16_t v; std::memcpy(&v, buf, sizeof(v)); return static_cast<T>(v); }
+        case UInt16:
+            { uint16_t v; std::memcpy(&v, buf, sizeof(v)); return static_cast<T>(v); }
+        case Int32:
+            { int32_t v; std::memcpy(&v, buf, sizeof(v)); return static_cast<T>(v); }
+        case UInt32:
+            { uint32_t v; std::memcpy(&v, buf, sizeof(v)); return static_cast<T>(v); }
+        case Float32:
+            { float v; std::memcpy(&v, buf, sizeof(v)); return static_cast<T>(v); }
+        case Float64:
+            { double v; std::memcpy(&v, buf, sizeof(v)); return static_cast<T>(v); }
+        default:
+            return T();
+        }
+    }
+
+
+    bool PlyIO::readHeader(const char* data, size_t size, Header &header)
+    {
+        header.format = Ascii;
+        header.elements.clear();
+        header.size = 0;
+        if (!data)
+            return false;
+
+        bool has_magic = false;
+        bool has_format = false;
+        size_t pos = 0;
+        while (pos < size)
+        {
+            // extract next header line
+            const char* eol = static_cast<const char*>(std::memchr(data + pos, '\n', size - pos));
+            size_t line_end = eol ? static_cast<size_t>(eol - data) : size;
+            std::string line(data + pos, line_end - pos);
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+            pos = line_end + 1;
+
+            std::istringstream iss(line);
+            std::string keyword;
+            iss >> keyword;
+            if (!has_magic)
+            {
+                // first line must be the magic number
+                if (keyword != "ply")
+                    return false;
+                has_magic = true;
+            }
+            else if (keyword == "format")
+            {
+                std::string format;
+                iss >> format;
+                if (format == "ascii")
+                    header.format = Ascii;
+                else if (format == "binary_little_endian")
+                    header.format = BinaryLittleEndian;
+                else if (format == "binary_big_endian")
+                    header.format = BinaryBigEndian;
+                else
+                    return false;
+                has_format = true;
+            }
+            else if (keyword == "element")
+            {
+                Element elem;
+                if (!(iss >> elem.name >> elem.count))
+                    return false;
+                header.elements.push_back(elem);
+            }
+            else if (keyword == "property")
+            {
+                if (header.elements.empty())
+                    return false;
+                Property prop;
+                std::string type;
+                iss >> type;
+                if (type == "list")
+                {
+                    std::string count_type;
+                    iss >> count_type >> type;
+                    prop.count_type = parseType(count_type);
+                    if (prop.count_type == Invalid)
+                        return false;
+                }
+                else
+                {
+                    prop.count_type = Invalid;
+                }
+                prop.type = parseType(type);
+                if (prop.type == Invalid || !(iss >> prop.name))
+                    return false;
+                header.elements.back().properties.push_back(prop);
+            }
+            else if (keyword == "end_header")
+            {
+                header.size = std::min(pos, size);
+                return has_format;
+            }
+            else if (!keyword.empty() && keyword != "comment" && keyword != "obj_info")
+            {
+                return false;
+            }
+        }
+
+        return false;
+    }
+
+
+    bool PlyIO::loadBinary(const char* data, size_t size, const Header &header, Mesh &mesh)
+    {
+        const bool swap_bytes = (header.format == BinaryBigEndian);
+        const char* ptr = data + header.size;
+        const char* end = data + size;
+        bool has_vertices = false;
+        bool has_faces = false;
+
+        for (size_t e = 0; e < header.elements.size(); ++e)
+        {
+            const Element &elem = header.elements[e];
+            const std::vector<Property> &props = elem.properties;
+
+            if (elem.name == "vertex")
+            {
+                // map vertex properties to byte offsets within fixed-size records
+                // (x, y, z, nx, ny, nz, red, green, blue)
+                static const char* attr_names[9] = { "x", "y", "z", "nx", "ny", "nz", "red", "green", "blue" };
+                int attr_props[9] = { -1, -1, -1, -1, -1, -1, -1, -1, -1 };
+                std::vector<size_t> offsets(props.size(), 0);
+                size_t stride = 0;
+                for (size_t p = 0; p < props.size(); ++p)
+                {
+                    // variable-size vertex records are not supported
+                    if (props[p].count_type != Invalid)
+                        return false;
+                    offsets[p] = stride;
+                    stride += typeSize(props[p].type);
+                    for (int a = 0; a < 9; ++a)
+                    {
+                        if (props[p].name == attr_names[a])
+                            attr_props[a] = static_cast<int>(p);
+                    }
+                }
+                if (attr_props[0] < 0 || attr_props[1] < 0 || attr_props[2] < 0)
+                    return false;
+                bool has_normals = (attr_props[3] >= 0 && attr_props[4] >= 0 && attr_props[5] >= 0);
+                bool has_colors = (attr_props[6] >= 0 && attr_props[7] >= 0 && attr_props[8] >= 0);
+                if (has_colors)
+                {
+                    // colors must be stored as integers
+                    for (int a = 6; a < 9; ++a)
+                    {
+                        Type t = props[static_cast<size_t>(attr_props[a])].type;
+                        if (t == Float32 || t == Float64)
+                            return false;
+                    }
+                }
+                if (static_cast<size_t>(end - ptr) / std::max<size_t>(stride, 1) < elem.count)
+                    return false;
+
+                // gather offsets and types of mesh attributes
+                size_t off[9];
+                Type type[9];
+                for (int a = 0; a < 9; ++a)
+                {
+                    size_t p = static_cast<size_t>(std::max(attr_props[a], 0));
+                    off[a] = offsets[p];
+                    type[a] = props[p].type;
+                }
+
+                // decode vertex records directly into mesh arrays
+                const size_t num_verts = elem.count;
+                mesh.vertices.resize(num_verts);
+                mesh.normals.resize(has_normals ? num_verts : 0);
+                mesh.colors.resize(has_colors ? num_verts : 0);
+                if (num_verts > 0)
+                    mesh.origin = originShift(Vec3(readValue<double>(ptr + off[0], type[0], swap_bytes),
+                                                   readValue<double>(ptr + off[1], type[1], swap_bytes),
+                                                   readValue<double>(ptr + off[2], type[2], swap_bytes)));
+                const Vec3 origin = mesh.origin;
+                for (size_t i = 0; i < num_verts; ++i)
+                {
+                    const char* rec = ptr + i * stride;
+                    mesh.vertices[i] = (Vec3(readValue<double>(rec + off[0], type[0], swap_bytes),
+                                             readValue<double>(rec + off[1], type[1], swap_bytes),
+                                             readValue<double>(rec + off[2], type[2], swap_bytes)) - origin).cast<float>();
+                    if (has_normals)
+                        mesh.normals[i] = Vec3f(readValue<float>(rec + off[3], type[3], swap_bytes),
+                                                readValue<float>(rec + off[4], type[4], swap_bytes),
+                                                readValue<float>(rec + off[5], type[5], swap_bytes));
+                    if (has_colors)
+                        mesh.colors[i] = Vec3b(readValue<unsigned char>(rec + off[6], type[6], swap_bytes),
+                                               readValue<unsigned char>(rec + off[7], type[7], swap_bytes),
+                                               readValue<unsigned char>(rec + off[8], type[8], swap_bytes));
+                }
+                ptr += num_verts * stride;
+                has_vertices = true;
+            }
+            else
+            {
+                // find face vertex indices
+                int idx_prop = -1;
+                if (elem.name == "face")
+                {
+                    for (size_t p = 0; p < props.size(); ++p)
+                    {
+                        if (props[p].count_type != Invalid &&
+                                (props[p].name == "vertex_indices" || props[p].name == "vertex_index"))
+                        {
+                            idx_prop = static_cast<int>(p);
+                            break;
+                        }
+                    }
+                    if (idx_prop < 0)
+                        return false;
+                    mesh.face_vertices.resize(elem.count);
+                }
+
+                if (idx_prop == 0 && props.size() == 1 && typeSize(props[0].count_type) == 1 &&
+                        typeSize(props[0].type) == 4 && !swap_bytes)
+                {
+                    // fast path for plain triangle lists with 32 bit indices
+                    const size_t stride = 1 + 3 * sizeof(unsigned int);
+                    if (static_cast<size_t>(end - ptr) / stride < elem.count)
+                        return false;
+                    for (size_t i = 0; i < elem.count; ++i)
+                    {
+                        const char* rec = ptr + i * stride;
+                        if (rec[0] != 3)
+                            return false;
+                        std::memcpy(mesh.face_vertices[i].data(), rec + 1, 3 * sizeof(unsigned int));
+                    }
+                    ptr += elem.count * stride;
+                }
+                else
+                {
+                    // walk through variable-size records
+                    for (size_t i = 0; i < elem.count; ++i)
+                    {
+                        for (size_t p = 0; p < props.size(); ++p)
+                        {
+                            const Property &prop = props[p];
+                            size_t num_values = 1;
+                            if (prop.count_type != Invalid)
+                            {
+                                const size_t count_size = typeSize(prop.count_type);
+                                if (static_cast<size_t>(end - ptr) < count_size)
+                                    return false;
+                                int64_t count = readValue<int64_t>(ptr, prop.count_type, swap_bytes);
+                                if (count < 0)
+                                    return false;
+                                num_values = static_cast<size_t>(count);
+                                ptr += count_size;
+                            }
+                            const size_t value_size = typeSize(prop.type);
+                            if (static_cast<size_t>(end - ptr) / value_size < num_values)
+                                return false;
+
+                            if (static_cast<int>(p) == idx_prop)
+                            {
+                                // only triangle meshes are decoded natively
+                                if (num_values != 3)
+                                    return false;
+                                mesh.face_vertices[i] = Vec3ui(readValue<unsigned int>(ptr, prop.type, swap_bytes),
+                                                               readValue<unsigned int>(ptr + value_size, prop.type, swap_bytes),
+                                                               readValue<unsigned int>(ptr + 2 * value_size, prop.type, swap_bytes));
+                            }
+                            ptr += num_values * value_size;
+                        }
+                    }
+                }
+                if (idx_prop >= 0)
+                    has_faces = true;
+            }
+        }
+
+        return has_vertices && has_faces;
+    }
+
+
+    bool PlyIO::loadAscii(const char* data, size_t size, const Header &header, Mesh &mesh)
+    {
+        const char* body = data + header.size;
+        const size_t body_size = size - header.size;
+
+        // ASCII records are stored line by line; split the vertex and face
+        // elements into line-aligned blocks that are parsed in parallel
+        const size_t num_blocks = numThreads() * 4;
+        const size_t min_block_records = 4096;
+        struct Block
+        {
+            const Element* elem;
+            size_t first_record;
+            size_t num_records;
+            size_t first_line;
+            size_t end_line;
+        };
+        std::vector<Block> blocks;
+        std::vector<size_t> lines;
+        bool has_vertices = false;
+        bool has_faces = false;
+        size_t first_line = 0;
+        for (size_t e = 0; e < header.elements.size(); ++e)
+        {
+            const Element &elem = header.elements[e];
+            if (elem.name == "vertex" || elem.name == "face")
+            {
+                has_vertices = has_vertices || (elem.name == "vertex");
+                has_faces = has_faces || (elem.name == "face");
+                size_t n = std::max<size_t>(1, std::min(num_blocks, elem.count / min_block_records));
+                for (size_t b = 0; b < n; ++b)
+                {
+                    Block block;
+                    block.elem = &elem;
+                    block.first_record = b * elem.count / n;
+                    block.num_records = (b + 1) * elem.count / n - block.first_record;
+                    block.first_line = first_line + block.first_record;
+                    block.end_line = block.first_line + block.num_records;
+                    blocks.push_back(block);
+                    lines.push_back(block.first_line);
+                    lines.push_back(block.end_line);
+                }
+            }
+            first_line += elem.count;
+        }
+        if (!has_vertices || !has_faces)
+            return false;
+
+        // determine byte offsets of block boundaries
+        std::sort(lines.begin(), lines.end());
+        lines.erase(std::unique(lines.begin(), lines.end()), lines.end());
+        std::vector<size_t> offsets;
+        findLineOffsets(body, body_size, lines, offsets);
+
+        // allocate mesh arrays
+        for (size_t e = 0; e < header.elements.size(); ++e)
+        {
+            const Element &elem = header.elements[e];
+            if (elem.name == "vertex")
+            {
+                bool has_normals = false;
+                bool has_colors = false;
+                for (size_t p = 0; p < elem.properties.size(); ++p)
+                {
+                    const std::string &name = elem.properties[p].name;
+                    has_normals = has_normals || name == "nx";
+                    has_colors = has_colors || name == "red";
+                }
+                mesh.vertices.resize(elem.count);
+                mesh.normals.resize(has_normals ? elem.count : 0);
+                mesh.colors.resize(has_colors ? elem.count : 0);
+            }
+            else if (elem.name == "face")
+            {
+                mesh.face_vertices.resize(elem.count);
+            }
+        }
+
+        // choose origin shift from the first vertex before parsing in parallel
+        for (size_t b = 0; b < blocks.size(); ++b)
+        {
+            const Block &block = blocks[b];
+            if (block.elem->name != "vertex" || block.first_record != 0 || block.num_records == 0)
+                continue;
+            const char* ptr = body + offsets[std::lower_bound(lines.begin(), lines.end(), block.first_line) - lines.begin()];
+            const char* eol = static_cast<const char*>(std::memchr(ptr, '\n', static_cast<size_t>(body + body_size - ptr)));
+            const char* line_end = eol ? eol : body + body_size;
+            const std::vector<Property> &props = block.elem->properties;
+            Vec3 first_vertex = Vec3::Zero();
+            for (size_t p = 0; p < props.size() && props[p].count_type == Invalid; ++p)
+            {
+                double val;
+                if (!parseValue(ptr, line_end, props[p].type, val))
+                    break;
+                if (props[p].name == "x")
+                    first_vertex[0] = val;
+                else if (props[p].name == "y")
+                    first_vertex[1] = val;
+                else if (props[p].name == "z")
+                    first_vertex[2] = val;
+            }
+            mesh.origin = originShift(first_vertex);
+        }
+
+        // parse blocks in parallel
+        std::atomic<bool> ok(true);
+        parallelFor(0, blocks.size(), [&](size_t b0, size_t b1)
+        {
+            for (size_t b = b0; b < b1 && ok; ++b)
+            {
+                const Block &block = blocks[b];
+                size_t begin = offsets[std::lower_bound(lines.begin(), lines.end(), block.first_line) - lines.begin()];
+                size_t end = offsets[std::lower_bound(lines.begin(), lines.end(), block.end_line) - lines.begin()];
+                if (!parseAsciiRecords(body + begin, body + end, *block.elem,
+                                       block.first_record, block.num_records, mesh))
+                    ok = false;
+            }
+        }, blocks.size());
+
+        return ok;
+    }
+
+
+    bool PlyIO::parseAsciiRecords(const char* begin, const char* end, const Element &elem,
+                                  size_t first_record, size_t num_records, Mesh &mesh)
+    {
+        const std::vector<Property> &props = elem.properties;
+        const bool is_vertex = (elem.name == "vertex");
+
+        // map properties to mesh attributes
+        // (vertex: x, y, z, nx, ny, nz, red, green, blue; face: vertex indices)
+        static const char* attr_names[9] = { "x", "y", "z", "nx", "ny", "nz", "red", "green", "blue" };
+        std::vector<int> prop_attrs(props.size(), -1);
+        int attr_found[9] = { 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+        bool has_indices = false;
+        for (size_t p = 0; p < props.size(); ++p)
+        {
+            if (is_vertex)
+            {
+                for (int a = 0; a < 9; ++a)
+                {
+                    if (props[p].count_type == Invalid && props[p].name == attr_names[a])
+                    {
+                        prop_attrs[p] = a;
+                        attr_found[a] = 1;
+                    }
+                }
+            }
+            else if (!has_indices && props[p].count_type != Invalid &&
+                     (props[p].name == "vertex_indices" || props[p].name == "vertex_index"))
+            {
+                prop_attrs[p] = 0;
+                has_indices = true;
+            }
+        }
+        const bool has_normals = !mesh.normals.empty();
+        const bool has_colors = !mesh.colors.empty();
+        if (is_vertex)
+        {
+            // all components of an attribute must be present, colors must be integers
+            if (!attr_found[0] || !attr_found[1] || !attr_found[2] ||
+                    has_normals != (attr_found[3] && attr_found[4] && attr_found[5]) ||
+                    has_colors != (attr_found[6] && attr_found[7] && attr_found[8]))
+                return false;
+            for (size_t p = 0; p < props.size(); ++p)
+            {
+                if (prop_attrs[p] >= 6 && (props[p].type == Float32 || props[p].type == Float64))
+                    return false;
+            }
+        }
+        else if (!has_indices)
+        {
+            return false;
+        }
+
+        const char* ptr = begin;
+        double vals[9] = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+        for (size_t r = 0; r < num_records; ++r)
+        {
+            if (ptr >= end)
+                return false;
+            const char* eol = static_cast<const char*>(std::memchr(ptr, '\n', static_cast<size_t>(end - ptr)));
+            const char* line_end = eol ? eol : end;
+            const size_t idx = first_record + r;
+
+            for (size_t p = 0; p < props.size(); ++p)
+            {
+                const Property &prop = props[p];
+                if (prop.count_type == Invalid)
+                {
+                    // scalar property
+                    double val;
+                    if (!parseValue(ptr, line_end, prop.type, val))
+                        return false;
+                    if (prop_attrs[p] >= 0)
+                        vals[prop_attrs[p]] = val;
+                    continue;
+                }
+
+                // list property
+                int64_t count;
+                if (!parseInt(ptr, line_end, count) || count < 0 || !isInRange(count, prop.count_type))
+                    return false;
+                if (!is_vertex && prop_attrs[p] == 0)
+                {
+                    // only triangle meshes are parsed natively
+                    if (count != 3 || prop.type == Float32 || prop.type == Float64)
+                        return false;
+                    Vec3ui &face = mesh.face_vertices[idx];
+                    for (int t = 0; t < 3; ++t)
+                    {
+                        int64_t vert_idx;
+                        if (!parseInt(ptr, line_end, vert_idx) || !isInRange(vert_idx, prop.type))
+                            return false;
+                        face[t] = static_cast<unsigned int>(vert_idx);
+                    }
+                }
+                else
+                {
+                    for (int64_t i = 0; i < count; ++i)
+                    {
+                        double val;
+                        if (!parseValue(ptr, line_end, prop.type, val))
+                            return false;
+                    }
+                }
+            }
+
+            if (is_vertex)
+            {
+                mesh.vertices[idx] = (Vec3(vals[0], vals[1], vals[2]) - mesh.origin).cast<float>();
+                if (has_normals)
+                    mesh.normals[idx] = Vec3f(static_cast<float>(vals[3]), static_cast<float>(vals[4]),
+                                              static_cast<float>(vals[5]));
+                if (has_colors)
+                    mesh.colors[idx] = Vec3b(static_cast<unsigned char>(vals[6]),
+                                             static_cast<unsigned char>(vals[7]),
+                                             static_cast<unsigned char>(vals[8]));
+            }
+            ptr = line_end + 1;
+        }
+
+        return true;
+    }
+
+
+    void PlyIO::findLineOffsets(const char* data, size_t size,
+                                const std::vector<size_t> &lines, std::vector<size_t> &offsets)
+    {
+        // count line breaks of chunks in parallel
+        const size_t num_chunks = std::max<size_t>(1, std::min(numThreads() * 4, size / 65536));
+        std::vector<size_t> chunk_lines(num_chunks + 1, 0);
+        parallelFor(0, num_chunks, [&](size_t c0, size_t c1)
+        {
+            for (size_t c = c0; c < c1; ++c)
+            {
+                const char* ptr = data + c * size / num_chunks;
+                const char* end = data + (c + 1) * size / num_chunks;
+                size_t n = 0;
+                while ((ptr = static_cast<const char*>(std::memchr(ptr, '\n', static_cast<size_t>(end - ptr)))))
+                {
+                    ++n;
+                    ++ptr;
+                }
+                chunk_lines[c + 1] = n;
+            }
+        }, num_chunks);
+        // number of line breaks before each chunk
+        for (size_t c = 0; c < num_chunks; ++c)
+            chunk_lines[c + 1] += chunk_lines[c];
+
+        // locate the line starts (after the n-th line break)
+        offsets.resize(lines.size());
+        parallelFor(0, lines.size(), [&](size_t i0, size_t i1)
+        {
+            for (size_t i = i0; i < i1; ++i)
+            {
+                const size_t line = lines[i];
+                if (line == 0)
+                {
+                    offsets[i] = 0;
+                    continue;
+                }
+                if (line > chunk_lines[num_chunks])
+                {
+                    offsets[i] = size;
+                    continue;
+                }
+                size_t c = static_cast<size_t>(std::lower_bound(chunk_lines.begin(), chunk_lines.end(), line) -
+                                               chunk_lines.begin()) - 1;
+                const char* ptr = data + c * size / num_chunks;
+                for (size_t n = chunk_lines[c]; n < line; ++n)
+                    ptr = static_cast<const char*>(std::memchr(ptr, '\n', size - static_cast<size_t>(ptr - data))) + 1;
+                offsets[i] = static_cast<size_t>(ptr - data);
+            }
+        });
+    }
+
+
+    bool PlyIO::parseValue(const char* &ptr, const char* end, Type type, double &value)
+    {
+        if (type == Float32 || type == Float64)
+            return parseReal(ptr, end, type == Float32, value);
+
+        int64_t val;
+        if (!parseInt(ptr, end, val))
+            return false;
+        if (type == Int8 || type == UInt8)
+        {
+            // 8 bit values are read as int and then converted (as in happly)
+            if (val < std::numeric_limits<int32_t>::min() || val > std::numeric_limits<int32_t>::max())
+                return false;
+            if (type == Int8)
+                value = static_cast<int8_t>(val);
+            else
+                value = static_cast<uint8_t>(val);
+            return true;
+        }
+        if (!isInRange(val, type))
+            return false;
+        value = static_cast<double>(val);
+        return true;
+    }
+
+
+    bool PlyIO::parseReal(const char* &ptr, const char* end, bool single_precision, double &value)
+    {
+        // powers of ten that are exactly representable as double
+        static const double pow10[23] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                          1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+        while (ptr < end && (*ptr == ' ' || *ptr == '\t' || *ptr == '\r'))
+            ++ptr;
+        const char* token = ptr;
+        const char* p = ptr;
+        bool negative = false;
+        if (p < end && (*p == '-' || *p == '+'))
+        {
+            negative = (*p == '-');
+            ++p;
+        }
+
+        // accumulate up to 19 significant digits of the mantissa
+        uint64_t mantissa = 0;
+        int num_digits = 0;
+        int exponent = 0;
+        bool has_digits = false;
+        bool truncated = false;
+        for (; p < end && *p >= '0' && *p <= '9'; ++p)
+        {
+            has_digits = true;
+            if (num_digits < 19)
+            {
+                mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+                if (mantissa > 0)
+                    ++num_digits;
+            }
+            else
+            {
+                ++exponent;
+                truncated = truncated || (*p != '0');
+            }
+        }
+        if (p < end && *p == '.')
+        {
+            for (++p; p < end && *p >= '0' && *p <= '9'; ++p)
+            {
+                has_digits = true;
+                if (num_digits < 19)
+                {
+                    mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+                    if (mantissa > 0)
+                        ++num_digits;
+                    --exponent;
+                }
+                else
+                {
+                    truncated = truncated || (*p != '0');
+                }
+            }
+        }
+        if (!has_digits)
+            return false;
+        if (p < end && (*p == 'e' || *p == 'E'))
+        {
+            ++p;
+            bool exp_negative = false;
+            if (p < end && (*p == '-' || *p == '+'))
+            {
+                exp_negative = (*p == '-');
+                ++p;
+            }
+            if (p >= end || *p < '0' || *p > '9')
+                return false;
+            int exp = 0;
+            for (; p < end && *p >= '0' && *p <= '9'; ++p)
+            {
+                if (exp < 100000)
+                    exp = exp * 10 + (*p - '0');
+            }
+            exponent += exp_negative ? -exp : exp;
+        }
+        // token must be terminated by whitespace
+        if (p < end && *p != ' ' && *p != '\t' && *p != '\r')
+            return false;
+        ptr = p;
+
+        if (!truncated && mantissa <= (1ull << 53) && exponent >= -22 && exponent <= 22)
+        {
+            // exact mantissa and power of ten give a correctly rounded double
+            double d = static_cast<double>(mantissa);
+            d = exponent < 0 ? d / pow10[-exponent] : d * pow10[exponent];
+            if (negative)
+                d = -d;
+            if (!single_precision)
+            {
+                value = d;
+                return true;
+            }
+
+            // rounding to float is exact unless the double lies on a rounding midpoint
+            const double abs_d = std::fabs(d);
+            uint64_t bits;
+            std::memcpy(&bits, &d, sizeof(bits));
+            const uint64_t low_bits = bits & ((1ull << 29) - 1);
+            if (abs_d == 0.0 || (abs_d >= std::numeric_limits<float>::min() &&
+                                 abs_d <= std::numeric_limits<float>::max() && low_bits != (1ull << 28)))
+            {
+                value = static_cast<float>(d);
+                return true;
+            }
+        }
+
+        // slow path using the classic locale
+        std::istringstream iss(std::string(token, p));
+        iss.imbue(std::locale::classic());
+        if (single_precision)
+        {
+            float f;
+            iss >> f;
+            value = f;
+        }
+        else
+        {
+            iss >> value;
+        }
+        return !iss.fail();
+    }
+
+
+    bool PlyIO::parseInt(const char* &ptr, const char* end, int64_t &value)
+    {
+        while (ptr < end && (*ptr == ' ' || *ptr == '\t' || *ptr == '\r'))
+            ++ptr;
+        const char* p = ptr;
+        bool negative = false;
+        if (p < end && (*p == '-' || *p == '+'))
+        {
+            negative = (*p == '-');
+            ++p;
+        }
+        if (p >= end || *p < '0' || *p > '9')
+            return false;
+        int64_t val = 0;
+        for (; p < end && *p >= '0' && *p <= '9'; ++p)
+        {
+            if (val > 100000000000000000ll)
+                return false;
+            val = val * 10 + (*p - '0');
+        }
+        // token must be terminated by whitespace
+        if (p < end && *p != ' ' && *p != '\t' && *p != '\r')
+            return false;
+        ptr = p;
+        value = negative ? -val : val;
+        return true;
+    }
+
+
+    bool PlyIO::isInRange(int64_t value, Type type)
+    {
+        switch (type)
+        {
+        case Int8:
+            return value >= std::numeric_limits<int8_t>::min() && value <= std::numeric_limits<int8_t>::max();
+        case UInt8:
+            return value >= 0 && value <= std::numeric_limits<uint8_t>::max();
+        case Int16:
+            return value >= std::numeric_limits<int16_t>::min() && value <= std::numeric_limits<int16_t>::max();
+        case UInt16:
+            return value >= 0 && value <= std::numeric_limits<uint16_t>::max();
+        case Int32:
+            return value >= std::numeric_limits<int32_t>::min() && value <= std::numeric_limits<int32_t>::max();
+        case UInt32:
+            return value >= 0 && value <= std::numeric_limits<uint32_t>::max();
+        default:
             return false;
+        }
+    }
 
+
+    bool PlyIO::loadHapply(const std::string &filename, Mesh &mesh)
+    {
         try
         {
             // load ply file using happly
@@ -49,10 +927,15 @@ namespace menderer
 
             // vertex positions
             mesh.vertices.resize(vert_positions.size());
+            if (!vert_positions.empty())
+            {
+                const auto& v = vert_positions[0];
+                mesh.origin = originShift(Vec3(v[0], v[1], v[2]));
+            }
             for (size_t i = 0; i < vert_positions.size(); ++i)
             {
                 const auto& v = vert_positions[i];
-                mesh.vertices[i] = Vec3(v[0], v[1], v[2]);
+                mesh.vertices[i] = (Vec3(v[0], v[1], v[2]) - mesh.origin).cast<float>();
             }
 
             // vertex colors
@@ -68,7 +951,7 @@ namespace menderer
             for (size_t i = 0; i < vert_normals.size(); ++i)
             {
                 const auto& n = vert_normals[i];
-                mesh.normals[i] = Vec3(n[0], n[1], n[2]);
+                mesh.normals[i] = Vec3(n[0], n[1], n[2]).cast<float>();
             }
 
             // faces
@@ -120,6 +1003,9 @@ namespace menderer
         if (filename.empty())
             return false;
 
+        if (format_binary)
+            return saveBinary(filename, mesh);
+
         try
         {
             // output containers
@@ -133,7 +1019,7 @@ namespace menderer
             mesh_verts_out.resize(mesh.vertices.size());
             for (size_t i = 0; i < mesh.vertices.size(); ++i)
             {
-                const auto& v = mesh.vertices[i];
+                const Vec3 v = mesh.origin + mesh.vertices[i].cast<double>();
                 std::array<double, 3> v_out;
                 v_out[0] = v[0];
                 v_out[1] = v[1];
@@ -171,8 +1057,7 @@ namespace menderer
             ply_out.addVertexPositions(mesh_verts_out);
             ply_out.addVertexColors(mesh_colors_out);
             ply_out.addFaceIndices(mesh_faces_out);
-            happly::DataFormat fmt = format_binary ? happly::DataFormat::Binary : happly::DataFormat::ASCII;
-            ply_out.write(filename, fmt);
+            ply_out.write(filename, happly::DataFormat::ASCII);
         }
         catch (...)
         {
@@ -182,4 +1067,109 @@ namespace menderer
         return true;
     }
 
+
+    bool PlyIO::saveBinary(const std::string &filename, const Mesh &mesh)
+    {
+        std::ofstream out_file(filename.c_str(), std::ios::binary);
+        if (!out_file.is_open())
+            return false;
+        if (!save(out_file, mesh))
+            return false;
+        out_file.close();
+        return !out_file.fail();
+    }
+
+
+    bool PlyIO::save(std::ostream &out_file, const Mesh &mesh)
+    {
+        const size_t num_vertices = mesh.vertices.size();
+        const size_t num_faces = mesh.face_vertices.size();
+        const bool has_normals = !mesh.normals.empty() && mesh.normals.size() == num_vertices;
+        const bool has_colors = !mesh.colors.empty() && mesh.colors.size() == num_vertices;
+        if (num_vertices > std::numeric_limits<uint32_t>::max())
+            return false;
+
+        // write header (values are written in native byte order)
+        const uint16_t endian_probe = 1;
+        const bool little_endian = *reinterpret_cast<const uint8_t*>(&endian_probe) == 1;
+        std::ostringstream header;
+        header.imbue(std::locale::classic());
+        header << "ply\n";
+        header << "format " << (little_endian ? "binary_little_endian" : "binary_big_endian") << " 1.0\n";
+        header << "element vertex " << num_vertices << "\n";
+        header << "property double x\nproperty double y\nproperty double z\n";
+        if (has_normals)
+            header << "property float nx\nproperty float ny\nproperty float nz\n";
+        if (has_colors)
+            header << "property uchar red\nproperty uchar green\nproperty uchar blue\n";
+        header << "element face " << num_faces << "\n";
+        header << "property list uchar uint vertex_indices\n";
+        header << "end_header\n";
+        const std::string header_str = header.str();
+        out_file.write(header_str.data(), static_cast<std::streamsize>(header_str.size()));
+
+        // stream vertex and face records through a fixed-size block buffer
+        const size_t vertex_size = 3 * sizeof(double) + (has_normals ? 3 * sizeof(float) : 0) +
+                (has_colors ? 3 : 0);
+        const size_t face_size = 1 + 3 * sizeof(uint32_t);
+        std::vector<char> buffer(std::max(static_cast<size_t>(1 << 20), vertex_size + face_size));
+        char* const buf_begin = buffer.data();
+        char* const buf_end = buf_begin + buffer.size();
+        char* ptr = buf_begin;
+
+        for (size_t i = 0; i < num_vertices; ++i)
+        {
+            if (ptr + vertex_size > buf_end)
+            {
+                out_file.write(buf_begin, ptr - buf_begin);
+                ptr = buf_begin;
+            }
+            const Vec3 v = mesh.origin + mesh.vertices[i].cast<double>();
+            const double pos[3] = { v[0], v[1], v[2] };
+            std::memcpy(ptr, pos, sizeof(pos));
+            ptr += sizeof(pos);
+            if (has_normals)
+            {
+                const Vec3f &n = mesh.normals[i];
+                std::memcpy(ptr, n.data(), 3 * sizeof(float));
+                ptr += 3 * sizeof(float);
+            }
+            if (has_colors)
+            {
+                const Vec3b &c = mesh.colors[i];
+                ptr[0] = static_cast<char>(c[0]);
+                ptr[1] = static_cast<char>(c[1]);
+                ptr[2] = static_cast<char>(c[2]);
+                ptr += 3;
+            }
+        }
+
+        for (size_t i = 0; i < num_faces; ++i)
+        {
+            if (ptr + face_size > buf_end)
+            {
+                out_file.write(buf_begin, ptr - buf_begin);
+                ptr = buf_begin;
+            }
+            const Vec3ui &f = mesh.face_vertices[i];
+            const uint32_t ind[3] = { f[0], f[1], f[2] };
+            *ptr++ = 3;
+            std::memcpy(ptr, ind, sizeof(ind));
+            ptr += sizeof(ind);
+        }
+
+        out_file.write(buf_begin, ptr - buf_begin);
+        return !out_file.fail();
+    }
+
+
+    Vec3 PlyIO::originShift(const Vec3 &first_vertex)
+    {
+        // single precision keeps sub-0.1mm accuracy within 1km around the origin
+        const double max_coord = 1000.0;
+        if (first_vertex.cwiseAbs().maxCoeff() < max_coord)
+            return Vec3::Zero();
+        return Vec3(std::round(first_vertex[0]), std::round(first_vertex[1]), std::round(first_vertex[2]));
+    }
+
 } // namespace menderer
@@ -20,10 +20,9 @@
 
 #include <menderer/scene.h>
 
+#include <algorithm>
 #include <iostream>
 
-#include <menderer/ogl/render_context.h>
-
 
 namespace menderer
 {
@@ -32,59 +31,316 @@ namespace menderer
         camera_(camera),
         tex_color_(),
         tex_depth_(),
+        tex_linear_depth_(),
+        tex_vertex_map_(),
+        tex_normal_map_(),
+        tex_face_ids_(),
+        tex_barycentrics_(),
         fb_(),
-        mesh_renderer_(renderer_cfg)
+        tex_color_batch_(),
+        tex_depth_batch_(),
+        tex_linear_depth_batch_(),
+        fb_batch_(),
+        readback_(),
+        mesh_renderer_(renderer_cfg),
+        origin_(Vec3::Zero())
     {
         // set up frame buffer and textures
         tex_depth_.createDepth(camera_.width(), camera_.height());
         fb_.attach(tex_depth_);
-        tex_color_.createBGR(ogl::Texture::UByte, camera_.width(), camera_.height());
-        fb_.attach(tex_color_);
+        // (no color attachment for depth-only rendering)
+        if (!mesh_renderer_.config().depth_only)
+        {
+            tex_color_.createBGR(ogl::Texture::UByte, camera_.width(), camera_.height());
+            fb_.attach(tex_color_);
+        }
+        const bool geometry = mesh_renderer_.writesGeometryBuffers();
+        if (mesh_renderer_.writesLinearDepth())
+        {
+            // metric depth as second color attachment
+            tex_linear_depth_.createFloat(camera_.width(), camera_.height());
+            fb_.attach(tex_linear_depth_);
+        }
+        if (geometry)
+        {
+            // geometry buffers as further color attachments (in the order of the draw buffers)
+            tex_vertex_map_.createFloatRGB(camera_.width(), camera_.height());
+            fb_.attach(tex_vertex_map_);
+            tex_normal_map_.createFloatRGB(camera_.width(), camera_.height());
+            fb_.attach(tex_normal_map_);
+            tex_face_ids_.createInt(camera_.width(), camera_.height());
+            fb_.attach(tex_face_ids_);
+            tex_barycentrics_.createFloatRGB(camera_.width(), camera_.height());
+            fb_.attach(tex_barycentrics_);
+        }
     }
 
 
     Scene::~Scene()
     {
+        fb_batch_.clear();
         fb_.clear();
     }
 
 
     bool Scene::upload(const Mesh& mesh)
+    {
+        return upload(mesh.view());
+    }
+
+
+    bool Scene::upload(const MeshView& mesh)
     {
         // upload mesh to GPU
         mesh_renderer_.update(mesh);
+        origin_ = mesh.origin;
         return true;
     }
 
 
     bool Scene::render(const Mat4& pose_world_to_view, cv::Mat& color_out, cv::Mat &depth_out)
+    {
+        // render the mesh
+        ogl::RenderContext render_ctx;
+        draw(pose_world_to_view, render_ctx);
+
+        // download target textures (no color for depth-only rendering)
+        if (!tex_color_.empty())
+            tex_color_.download(color_out);
+        else
+            color_out.release();
+        if (!tex_linear_depth_.empty())
+        {
+            tex_linear_depth_.download(depth_out);
+        }
+        else
+        {
+            // scale depth buffer values to metric units
+            tex_depth_.download(depth_out);
+            render_ctx.convertDepthBufferToMetric(depth_out);
+        }
+
+        return true;
+    }
+
+
+    bool Scene::render(const Mat4& pose_world_to_view, FramePool::Frame &frame)
+    {
+        if (frame.depth.cols != camera_.width() || frame.depth.rows != camera_.height())
+        {
+            std::cerr << "frame size does not match the camera!" << std::endl;
+            return false;
+        }
+
+        return render(pose_world_to_view, frame.color, frame.depth);
+    }
+
+
+    bool Scene::writesGeometryBuffers() const
+    {
+        return !tex_vertex_map_.empty();
+    }
+
+
+    bool Scene::render(const Mat4& pose_world_to_view, cv::Mat& color_out, cv::Mat &depth_out,
+                       GeometryBuffers &geometry_out)
+    {
+        if (tex_vertex_map_.empty())
+        {
+            std::cerr << "geometry buffers are not enabled!" << std::endl;
+            return false;
+        }
+
+        // render color, depth and geometry buffers in one pass
+        if (!render(pose_world_to_view, color_out, depth_out))
+            return false;
+
+        // download geometry buffers
+        tex_vertex_map_.download(geometry_out.vertex_map);
+        tex_normal_map_.download(geometry_out.normal_map);
+        tex_face_ids_.download(geometry_out.face_ids);
+        tex_barycentrics_.download(geometry_out.barycentrics);
+
+        return true;
+    }
+
+
+    bool Scene::renderAsync(const Mat4& pose_world_to_view, size_t frame, const FrameCallback &callback)
+    {
+        // complete the oldest frame if all pixel buffers are in flight
+        if (readback_.full() && !completeFrame(true, callback))
+            return false;
+
+        // render the mesh and start the readback
+        ogl::RenderContext render_ctx;
+        draw(pose_world_to_view, render_ctx);
+        std::vector<ogl::Texture*> textures;
+        if (!tex_color_.empty())
+            textures.push_back(&tex_color_);
+        textures.push_back(tex_linear_depth_.empty() ? &tex_depth_ : &tex_linear_depth_);
+        if (!readback_.push(textures, frame))
+            return false;
+
+        // pass on frames with completed readbacks
+        while (completeFrame(false, callback)) {}
+        return true;
+    }
+
+
+    bool Scene::flush(const FrameCallback &callback)
+    {
+        while (!readback_.empty())
+        {
+            if (!completeFrame(true, callback))
+                return false;
+        }
+        return true;
+    }
+
+
+    bool Scene::completeFrame(bool wait, const FrameCallback &callback)
+    {
+        std::vector<cv::Mat> images;
+        size_t frame = 0;
+        if (!readback_.pop(images, frame, wait))
+            return false;
+
+        // (depth is the last image, there is no color for depth-only rendering)
+        cv::Mat color = images.size() > 1 ? images[0] : cv::Mat();
+        cv::Mat depth = images.back();
+        if (tex_linear_depth_.empty())
+        {
+            // scale depth buffer values to metric units
+            ogl::RenderContext render_ctx;
+            setupRenderContext(Mat4::Identity(), render_ctx);
+            render_ctx.convertDepthBufferToMetric(depth);
+        }
+
+        callback(frame, color, depth);
+        return true;
+    }
+
+
+    void Scene::draw(const Mat4& pose_world_to_view, ogl::RenderContext &render_ctx)
     {
         // set up framebuffer rendering
+        fb_.bind();
         fb_.drawBuffers();
 
         // configure render context
-        ogl::RenderContext render_ctx;
-        render_ctx.setPinholeProjection(camera_.width(), camera_.height(), camera_.intrinsics());
-        render_ctx.setModelViewMatrix(pose_world_to_view);
-        render_ctx.setViewport(0, 0, camera_.width(), camera_.height());
-        // apply render context
-        render_ctx.apply();
+        setupRenderContext(pose_world_to_view, render_ctx);
+        // apply render context (core profile: matrices are passed as shader uniforms)
+        const bool core_profile = mesh_renderer_.config().core_profile;
+        if (core_profile)
+        {
+            render_ctx.applyViewport();
+        }
+        else
+        {
+            render_ctx.store();
+            render_ctx.apply();
+        }
+        // select level of detail for pose
+        mesh_renderer_.setView(render_ctx);
 
-        // render the mesh
-        mesh_renderer_.draw();
-
-        // download target textures
-        tex_color_.download(color_out);
-        tex_depth_.download(depth_out);
+        // render the mesh (depth target is used for occlusion culling)
+        mesh_renderer_.draw(&tex_depth_);
 
         // restore projection and model view matrices
-        render_ctx.restore();
+        if (!core_profile)
+            render_ctx.restore();
+    }
 
-        // scale depth buffer values to metric units
-        render_ctx.convertDepthBufferToMetric(depth_out);
 
-        return true;
+    bool Scene::renderBatch(const std::vector<Mat4>& poses_world_to_view,
+                            std::vector<cv::Mat>& colors_out, std::vector<cv::Mat> &depths_out)
+    {
+        // single poses are rendered with culling and levels of detail
+        if (poses_world_to_view.size() <= 1 || !mesh_renderer_.supportsBatch())
+            return Renderer::renderBatch(poses_world_to_view, colors_out, depths_out);
+
+        // number of layers per pass is limited by the array texture size
+        const size_t num_poses = poses_world_to_view.size();
+        GLint max_layers = 0;
+        glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &max_layers);
+        const size_t batch_size = std::min(num_poses, static_cast<size_t>(std::max(max_layers, 1)));
+
+        colors_out.assign(num_poses, cv::Mat());
+        depths_out.resize(num_poses);
+        const bool depth_only = mesh_renderer_.config().depth_only;
+        const int w = camera_.width();
+        const int h = camera_.height();
+        bool ok = true;
+        for (size_t first = 0; first < num_poses && ok; first += batch_size)
+        {
+            const int num_layers = static_cast<int>(std::min(batch_size, num_poses - first));
+            if (tex_depth_batch_.empty() || tex_depth_batch_.layers() != num_layers)
+            {
+                // (re)create layered render targets for the batch size
+                fb_batch_.clear();
+                tex_depth_batch_.createDepthArray(w, h, num_layers);
+                fb_batch_.attach(tex_depth_batch_);
+                if (!depth_only)
+                {
+                    tex_color_batch_.createBGRArray(ogl::Texture::UByte, w, h, num_layers);
+                    fb_batch_.attach(tex_color_batch_);
+                }
+                // (batch shaders always write metric depth)
+                tex_linear_depth_batch_.createFloatArray(w, h, num_layers);
+                fb_batch_.attach(tex_linear_depth_batch_);
+            }
+            fb_batch_.bind();
+            if (!fb_batch_.drawBuffers())
+            {
+                std::cerr << "layered framebuffer for batch rendering is incomplete!" << std::endl;
+                ok = false;
+                break;
+            }
+
+            // model view matrices of the poses (with a shared projection)
+            ogl::RenderContext render_ctx;
+            std::vector<Mat4> modelviews(static_cast<size_t>(num_layers));
+            for (size_t i = 0; i < modelviews.size(); ++i)
+            {
+                setupRenderContext(poses_world_to_view[first + i], render_ctx);
+                modelviews[i] = render_ctx.modelViewMatrix();
+            }
+            render_ctx.applyViewport();
+
+            // render all poses into the layers
+            ok = mesh_renderer_.drawBatch(render_ctx, modelviews);
+            if (!ok)
+                break;
+
+            // download all layers at once (layers are stacked vertically)
+            cv::Mat colors, depths;
+            if (!depth_only)
+                tex_color_batch_.download(colors);
+            tex_linear_depth_batch_.download(depths);
+
+            // split into images of the poses (without copying)
+            for (int i = 0; i < num_layers; ++i)
+            {
+                if (!depth_only)
+                    colors_out[first + static_cast<size_t>(i)] = colors.rowRange(i * h, (i + 1) * h);
+                depths_out[first + static_cast<size_t>(i)] = depths.rowRange(i * h, (i + 1) * h);
+            }
+        }
+
+        // single poses are rendered into the default targets
+        fb_.bind();
+        return ok;
     }
 
 
+    void Scene::setupRenderContext(const Mat4& pose_world_to_view, ogl::RenderContext &render_ctx) const
+    {
+        render_ctx.setPinholeProjection(camera_.width(), camera_.height(), camera_.intrinsics());
+        // (mesh vertices are stored relative to the mesh origin)
+        Mat4 pose_mesh_to_view = pose_world_to_view;
+        pose_mesh_to_view.topRightCorner<3, 1>() += pose_world_to_view.topLeftCorner<3, 3>() * origin_;
+        render_ctx.setModelViewMatrix(pose_mesh_to_view);
+        render_ctx.setViewport(0, 0, camera_.width(), camera_.height());
+    }
+
 } // namespace menderer